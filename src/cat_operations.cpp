@@ -108,32 +108,36 @@ void ComputeMergeStats(MergeStats& r, CatalogPtr po, CatalogPtr refcat)
 }
 
 
-MergeResult MergeCatalogWithReferencePO(POCatalogPtr catalog, POCatalogPtr ref)
+MergeResult MergeCatalogWithReferencePO(POCatalogPtr catalog, POCatalogPtr ref, MergeStats *stats)
 {
     if (!catalog || !ref)
         return {};
 
-    if (!catalog->UpdateFromPOT(ref))
+    // merging PO files computes the stats as a by-product, POT files are just replaced:
+    if (stats && catalog->GetFileType() != Catalog::Type::PO)
+        ComputeMergeStats(*stats, catalog, ref);
+
+    if (!catalog->UpdateFromPOT(ref, /*replace_header=*/false, stats))
         return {};
 
     return {catalog};
 }
 
 
-MergeResult MergeCatalogWithReferenceRaw(CatalogPtr catalog, CatalogPtr reference)
+MergeResult MergeCatalogWithReferenceRaw(CatalogPtr catalog, CatalogPtr reference, MergeStats *stats)
 {
     auto po_catalog = std::dynamic_pointer_cast<POCatalog>(catalog);
     auto po_ref = std::dynamic_pointer_cast<POCatalog>(reference);
 
-    return MergeCatalogWithReferencePO(po_catalog, po_ref);
+    return MergeCatalogWithReferencePO(po_catalog, po_ref, stats);
 }
 
 
-MergeResult MergeCatalogWithReference(CatalogPtr catalog, CatalogPtr reference)
+MergeResult MergeCatalogWithReference(CatalogPtr catalog, CatalogPtr reference, MergeStats *stats)
 {
     auto sideloaded = catalog->GetSideloadedSourceData();
 
-    auto r = MergeCatalogWithReferenceRaw(catalog, reference);
+    auto r = MergeCatalogWithReferenceRaw(catalog, reference, stats);
 
     if (sideloaded && r.updated_catalog)
     {
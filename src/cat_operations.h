@@ -93,12 +93,15 @@ extern void ComputeMergeStats(MergeStats& r, CatalogPtr catalog, CatalogPtr refe
     Merges catalog with a reference catalog, updating catalog with new strings
     present in @a reference and removing strings that are no longer present there.
 
+    If @a stats is provided, it is filled with the same data ComputeMergeStats()
+    would compute, but more efficiently.
+
     @note The returned updated_catalog may be the same as @a catalog, but it may also be
           a new object, possibly also @a reference. Don't make assumptions about it and
           always treat it as an entirely new object.
 
     @warning The @a reference object cannot be used after being passed to this function!
  */
-extern MergeResult MergeCatalogWithReference(CatalogPtr catalog, CatalogPtr reference);
+extern MergeResult MergeCatalogWithReference(CatalogPtr catalog, CatalogPtr reference, MergeStats *stats = nullptr);
 
 #endif // Poedit_cat_operations_h
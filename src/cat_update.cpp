@@ -208,6 +208,7 @@ struct InterimResults
 {
     CatalogPtr reference;
     ParsedGettextErrors errors;
+    ExtractionCacheStats cacheStats;
 };
 
 
@@ -251,6 +252,7 @@ InterimResults ExtractPOTFromSources(CatalogPtr catalog)
         try
         {
             output.errors = result.errors;
+            output.cacheStats = result.cache_stats;
             output.reference = POCatalog::Create(result.pot_file, Catalog::CreationFlag_IgnoreHeader);
             return output;
         }
@@ -380,17 +382,9 @@ dispatch::future<CatalogPtr> DoPerformUpdateWithUI(wxWindow *parent,
         stats.errors = data.errors;
 
         {
-            Progress subtask(1, p, (100 - timeCostObtainPOT) / 2);
-            subtask.message(_(L"Determining differences…"));
-            ComputeMergeStats(stats, catalog, data.reference);
-        }
-
-        cancellation->throw_if_cancelled();
-
-        {
-            Progress subtask(1, p, (100 - timeCostObtainPOT) / 2);
+            Progress subtask(1, p, 100 - timeCostObtainPOT);
             subtask.message(_(L"Merging differences…"));
-            *merge_result = MergeCatalogWithReference(catalog, data.reference);
+            *merge_result = MergeCatalogWithReference(catalog, data.reference, &stats);
             if (!(*merge_result))
                 BOOST_THROW_EXCEPTION( BackgroundTaskException(_("Failed to load file with extracted translations.")) );
 
@@ -415,6 +409,16 @@ dispatch::future<CatalogPtr> DoPerformUpdateWithUI(wxWindow *parent,
             bg.details.emplace_back(_("Removed strings (no longer used):"), wxNumberFormatter::ToString((long)stats.removed.size()));
         }
 
+        if (data.cacheStats)
+        {
+            bg.details.emplace_back(_("Unchanged source files (not scanned again):"),
+                                    // TRANSLATORS: e.g. "950 of 1,000 (95 %)", the number of unchanged source files out of all of them
+                                    wxString::Format(_("%s of %s (%d %%)"),
+                                                     wxNumberFormatter::ToString((long)data.cacheStats.hits),
+                                                     wxNumberFormatter::ToString((long)data.cacheStats.files),
+                                                     data.cacheStats.hits * 100 / data.cacheStats.files));
+        }
+
         return bg;
     },
     [progress,promise,merge_result](bool ok)
@@ -56,6 +56,9 @@
 #include <algorithm>
 #include <set>
 #include <regex>
+#include <string_view>
+
+#include <boost/functional/hash.hpp>
 
 
 // ----------------------------------------------------------------------
@@ -540,16 +543,10 @@ CatalogItemPtr Catalog::FindItemByLine(int lineno)
 
 int Catalog::FindItemIndexByLine(int lineno)
 {
-    int last = -1;
-
-    for (auto& i: m_items)
-    {
-        if (i->GetLineNumber() > lineno)
-            return last;
-        last++;
-    }
-
-    return last;
+    // items are stored in the order of line numbers, find the last one starting at or before lineno:
+    auto next = std::upper_bound(m_items.begin(), m_items.end(), lineno,
+                                 [](int line, const CatalogItemPtr& i){ return line < i->GetLineNumber(); });
+    return int(next - m_items.begin()) - 1;
 }
 
 
@@ -1031,27 +1028,133 @@ wxString CatalogItem::GetOldMsgid() const
 }
 
 
-Catalog::ValidationResults Catalog::Validate(const wxString& /*fileWithSameContent*/)
+namespace
 {
-    ValidationResults res;
 
-    for (auto& i: m_items)
-        i->ClearIssue();
-    res.errors = 0;
+inline void HashCombineString(size_t& seed, const wxString& s)
+{
+    const auto buf = s.wc_str(); // no copy in wchar_t builds
+    const wchar_t *data = buf;
+    boost::hash_combine(seed, std::hash<std::wstring_view>()(std::wstring_view(data)));
+}
+
+} // anonymous namespace
+
+
+size_t CatalogItem::GetValidationHash() const
+{
+    size_t hash = 0;
+
+    HashCombineString(hash, GetString());
+    HashCombineString(hash, GetRawString());
+    boost::hash_combine(hash, m_hasPlural);
+    if (m_hasPlural)
+    {
+        HashCombineString(hash, GetPluralString());
+        HashCombineString(hash, GetRawPluralString());
+    }
+    boost::hash_combine(hash, m_hasContext);
+    if (m_hasContext)
+        HashCombineString(hash, m_context);
+
+    boost::hash_combine(hash, m_translations.size());
+    for (auto& t: m_translations)
+        HashCombineString(hash, t);
+
+    HashCombineString(hash, GetFlags());
+
+    return hash;
+}
+
+
+size_t Catalog::GetValidationContextHash() const
+{
+    size_t hash = 0;
+
+    boost::hash_combine(hash, static_cast<int>(m_fileType));
+    boost::hash_combine(hash, GetLanguage().Code());
+    boost::hash_combine(hash, GetSourceLanguage().Code());
+    boost::hash_combine(hash, UsesSymbolicIDsForSource());
+    HashCombineString(hash, m_header.GetHeader("Plural-Forms"));
+#if wxUSE_GUI
+    boost::hash_combine(hash, Config::ShowWarnings());
+#endif
+
+    return hash;
+}
+
+
+Catalog::ValidationResults Catalog::Validate(const wxString& fileWithSameContent)
+{
+    ValidationResults res;
 
     if (!HasCapability(Catalog::Cap::Translations))
+    {
+        for (auto& i: m_items)
+            i->ClearIssue();
         return res; // no errors in POT files
+    }
 
+    // catalog-wide changes (language, plural forms, settings) invalidate all cached results:
+    const size_t contextHash = GetValidationContextHash();
+    const bool contextChanged = (contextHash != m_validationContextHash);
+    m_validationContextHash = contextHash;
+
+    CatalogItemArray dirty;
+    for (auto& i: m_items)
+    {
+        const size_t hash = i->GetValidationHash();
+        if (!contextChanged && i->m_isValidated && i->m_validatedHash == hash)
+        {
+            i->SetIssue(i->m_validatedIssue);
+        }
+        else
+        {
+            i->ClearIssue();
+            i->m_isValidated = false;
+            i->m_validatedHash = hash;
+            dirty.push_back(i);
+        }
+    }
+
+    if (!dirty.empty())
+        ValidateItems(dirty, fileWithSameContent);
+
+    for (auto& i: dirty)
+    {
+        i->m_validatedIssue = i->GetIssue();
+        i->m_isValidated = true;
+    }
+
+    ValidateCatalogWide();
+
+    for (auto& i: m_items)
+    {
+        if (i->HasError())
+            res.errors++;
+        else if (i->HasIssue())
+            res.warnings++;
+    }
+    res.rechecked = (int)dirty.size();
+
+    wxLogTrace("poedit", "validation: rechecked %d of %d items", res.rechecked, (int)m_items.size());
+
+    return res;
+}
+
+
+void Catalog::ValidateItems(const CatalogItemArray& items, const wxString& /*fileWithSameContent*/)
+{
 #if wxUSE_GUI
     if (Config::ShowWarnings())
     {
         // TODO: _some_ checks (e.g. plurals) do make sense even with symbolic IDs
         if (!UsesSymbolicIDsForSource())
-            res.warnings = QAChecker::GetFor(*this)->Check(*this);
+            QAChecker::GetFor(*this)->Check(items);
     }
+#else
+    (void)items;
 #endif
-
-    return res;
 }
 
 
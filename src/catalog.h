@@ -253,6 +253,14 @@ class CatalogItem
         void AttachSideloadedData(const std::shared_ptr<SideloadedItemData>& d) { m_sideloaded = d; }
         void ClearSideloadedData() { m_sideloaded.reset(); }
 
+        /**
+            Returns hash of the item's content that affects validation results
+            (source text, plural, context, translations and flags).
+
+            Used by Catalog::Validate() to recheck only modified items.
+         */
+        size_t GetValidationHash() const;
+
     protected:
         // API for subclasses:
         virtual void UpdateInternalRepresentation() = 0;
@@ -318,6 +326,14 @@ class CatalogItem
 
         std::shared_ptr<Issue> m_issue;
         std::shared_ptr<SideloadedItemData> m_sideloaded;
+
+        // cached result of the last validation, valid only for content with
+        // m_validatedHash hash (see Catalog::Validate()):
+        bool m_isValidated = false;
+        size_t m_validatedHash = 0;
+        std::shared_ptr<Issue> m_validatedIssue;
+
+        friend class Catalog;
 };
 
 
@@ -433,9 +449,11 @@ class Catalog
 
         struct ValidationResults
         {
-            ValidationResults() : errors(0), warnings(0) {}
+            ValidationResults() : errors(0), warnings(0), rechecked(0) {}
             int errors;
             int warnings;
+            /// Number of items actually checked; others reused cached results
+            int rechecked;
         };
 
         /// Default ctor. Creates empty catalog, you have to call Load.
@@ -585,9 +603,16 @@ class Catalog
         int FindItemIndexByLine(int lineno);
 
 
-        /// Validates correctness of the translation by running msgfmt
-        /// Returns number of errors (i.e. 0 if no errors).
-        virtual ValidationResults Validate(const wxString& fileWithSameContent = wxString());
+        /**
+            Validates correctness of the translation (format strings, plurals
+            etc.) and runs QA checks. Returns number of errors (i.e. 0 if no errors).
+
+            Results are cached per item and only items whose content changed
+            since the previous call are rechecked (see ValidationResults::rechecked).
+            The cache is discarded if anything catalog-wide that affects
+            validation, such as language or Plural-Forms, changes.
+         */
+        ValidationResults Validate(const wxString& fileWithSameContent = wxString());
 
         void AttachCloudSync(std::shared_ptr<CloudSyncDestination> c) { m_cloudSync = c; }
         std::shared_ptr<CloudSyncDestination> GetCloudSync() const { return m_cloudSync; }
@@ -617,6 +642,27 @@ class Catalog
         /// Perform post-creation processing to e.g. fixup issues, detect missing language etc.
         virtual void PostCreation();
 
+        /**
+            Checks @a items for errors and warnings and sets their issues.
+
+            Called by Validate() with only the items that need rechecking; their
+            issues were already cleared. Derived classes may extend it with
+            format-specific checks, @a fileWithSameContent is as in Validate().
+         */
+        virtual void ValidateItems(const CatalogItemArray& items, const wxString& fileWithSameContent);
+
+        /**
+            Checks catalog-wide problems (e.g. in the header) that are reported
+            on individual items.
+
+            Called by Validate() after ValidateItems(), on every validation,
+            because its results depend on all items and so aren't cached.
+         */
+        virtual void ValidateCatalogWide() {}
+
+        /// Hash of catalog-wide settings that affect validation results
+        size_t GetValidationContextHash() const;
+
     protected:
         CatalogItemArray m_items;
 
@@ -628,6 +674,9 @@ class Catalog
 
         std::shared_ptr<CloudSyncDestination> m_cloudSync;
         std::shared_ptr<SideloadedCatalogData> m_sideloaded;
+
+    private:
+        size_t m_validationContextHash = 0;
 };
 
 #endif // Poedit_catalog_h
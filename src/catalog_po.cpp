@@ -25,6 +25,8 @@
 
 #include "catalog_po.h"
 
+#include "cat_operations.h"
+#include "concurrency.h"
 #include "configuration.h"
 #include "errors.h"
 #include "extractors/extractor.h"
@@ -33,6 +35,9 @@
 #include "utility.h"
 #include "version.h"
 #include "language.h"
+#include "mo_writer.h"
+#include "po_validator.h"
+#include "po_writer.h"
 
 #include <stdio.h>
 #include <wx/utils.h>
@@ -42,13 +47,16 @@
 #include <wx/datetime.h>
 #include <wx/config.h>
 #include <wx/textfile.h>
-#include <wx/scopeguard.h>
 #include <wx/stdpaths.h>
 #include <wx/strconv.h>
-#include <wx/memtext.h>
 #include <wx/filename.h>
+#include <wx/file.h>
 
+#include <bitset>
+#include <cstdint>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <algorithm>
 
 #ifdef __WXOSX__
@@ -67,35 +75,38 @@
 namespace
 {
 
+inline bool IsSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
 // If input begins with pattern, fill output with end of input (without
 // pattern; strips trailing spaces) and return true.  Return false otherwise
 // and don't touch output. Is permissive about whitespace in the input:
 // a space (' ') in pattern will match any number of any whitespace characters
 // on that position in input.
-bool ReadParam(const wxString& input, const wxString& pattern, wxString& output, bool preserveWhitespace = false)
+bool ReadParam(std::string_view input, std::string_view pattern, std::string_view& output, bool preserveWhitespace = false)
 {
     if (input.size() < pattern.size())
         return false;
 
-    unsigned in_pos = 0;
-    unsigned pat_pos = 0;
+    size_t in_pos = 0;
+    size_t pat_pos = 0;
     while (pat_pos < pattern.size() && in_pos < input.size())
     {
-        const wxChar pat = pattern[pat_pos++];
+        const char pat = pattern[pat_pos++];
 
-        if (pat == _T(' '))
+        if (pat == ' ')
         {
-            if (!wxIsspace(input[in_pos++]))
+            if (!IsSpace(input[in_pos++]))
                 return false;
 
             if (!preserveWhitespace)
             {
-                while (wxIsspace(input[in_pos]))
-                {
+                while (in_pos < input.size() && IsSpace(input[in_pos]))
                     in_pos++;
-                    if (in_pos == input.size())
-                        return false;
-                }
+                if (in_pos == input.size())
+                    return false;
             }
         }
         else
@@ -109,70 +120,213 @@ bool ReadParam(const wxString& input, const wxString& pattern, wxString& output,
     if (pat_pos < pattern.size()) // pattern not fully matched
         return false;
 
-    output = input.Mid(in_pos);
+    output = input.substr(in_pos);
     if (!preserveWhitespace)
-        output.Trim(true); // trailing whitespace
+    {
+        while (!output.empty() && IsSpace(output.back()))
+            output.remove_suffix(1); // trailing whitespace
+    }
     return true;
 }
 
 
-// Checks if the file was loaded correctly, i.e. that non-empty lines
-// ended up non-empty in memory, after doing charset conversion in
-// wxTextFile. This detects for example files that claim they are in UTF-8
-// while in fact they are not.
-bool VerifyFileCharset(const wxTextFile& f, const wxString& filename,
-                       const wxString& charset)
+// Appends unescaped C string to output, with the same semantics as UnescapeCString()
+void AppendUnescapedCString(std::string& output, std::string_view str)
 {
-    wxTextFile f2;
+    size_t pos = 0;
+    for (;;)
+    {
+        const size_t backslash = str.find('\\', pos);
+        if (backslash == std::string_view::npos)
+        {
+            output.append(str.data() + pos, str.size() - pos);
+            return;
+        }
 
-    if (!f2.Open(filename, wxConvISO8859_1))
-        return false;
+        output.append(str.data() + pos, backslash - pos);
+        if (backslash + 1 == str.size())
+        {
+            output += '\\';
+            return;
+        }
+
+        const char c = str[backslash + 1];
+        switch (c)
+        {
+            case 'a': output += '\a'; break;
+            case 'b': output += '\b'; break;
+            case 'f': output += '\f'; break;
+            case 'n': output += '\n'; break;
+            case 'r': output += '\r'; break;
+            case 't': output += '\t'; break;
+            case 'v': output += '\v'; break;
+            case '\\':
+            case '"':
+            case '\'':
+            case '?':
+                output += c;
+                break;
+            default:
+                output += '\\';
+                output += c;
+                break;
+        }
+        pos = backslash + 2;
+    }
+}
+
+
+// Number of Unicode characters in UTF-8 string
+inline size_t UTF8Length(std::string_view str)
+{
+    size_t len = 0;
+    for (auto c: str)
+    {
+        if ((c & 0xC0) != 0x80)
+            len++;
+    }
+    return len;
+}
+
+
+// Returns length of the longest valid UTF-8 prefix of the string
+size_t ValidUTF8PrefixLength(std::string_view str)
+{
+    static const uint32_t minCodePoint[] = { 0, 0, 0x80, 0x800, 0x10000 };
 
-    if (f.GetLineCount() != f2.GetLineCount())
+    auto p = reinterpret_cast<const unsigned char*>(str.data());
+    const size_t len = str.size();
+    size_t i = 0;
+    while (i < len)
     {
-        int linesCount = (int)f2.GetLineCount() - (int)f.GetLineCount();
-        wxLogError(wxPLURAL(L"%i line of file “%s” was not loaded correctly.",
-                            L"%i lines of file “%s” were not loaded correctly.",
-                            linesCount),
-                   linesCount,
-                   filename.c_str());
+        const unsigned char c = p[i];
+        if (c < 0x80)
+        {
+            i++;
+            continue;
+        }
+
+        size_t seqlen;
+        uint32_t cp;
+        if ((c & 0xE0) == 0xC0)
+            { seqlen = 2; cp = c & 0x1F; }
+        else if ((c & 0xF0) == 0xE0)
+            { seqlen = 3; cp = c & 0x0F; }
+        else if ((c & 0xF8) == 0xF0)
+            { seqlen = 4; cp = c & 0x07; }
+        else
+            return i;
+
+        if (i + seqlen > len)
+            return i;
+        for (size_t k = 1; k < seqlen; k++)
+        {
+            if ((p[i + k] & 0xC0) != 0x80)
+                return i;
+            cp = (cp << 6) | (p[i + k] & 0x3F);
+        }
+        if (cp < minCodePoint[seqlen] || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+            return i;
+
+        i += seqlen;
+    }
+
+    return len;
+}
+
+
+// Reads entire file into memory at once.
+bool ReadFileContent(const wxString& filename, std::string& data)
+{
+    wxFile f;
+    if (!f.Open(filename, wxFile::read))
         return false;
+
+    const wxFileOffset len = f.Length();
+    if (len == wxInvalidOffset)
+        return false;
+
+    data.resize(size_t(len));
+    if (len == 0)
+        return true;
+
+    return size_t(f.Read(&data[0], data.size())) == data.size();
+}
+
+
+// Ensures that the data are in UTF-8, converting them from given charset if
+// needed. Lines that are not valid in the charset are blanked out (but kept,
+// so that line numbers are preserved). This detects for example files that
+// claim they are in UTF-8 while in fact they are not.
+bool ConvertFileContentToUTF8(std::string& data, const wxString& filename, const wxString& charset)
+{
+    const bool isUTF8 = charset.CmpNoCase("UTF-8") == 0 || charset.CmpNoCase("UTF8") == 0;
+
+    // Fast path for the overwhelmingly common case of valid UTF-8 file:
+    if (isUTF8 && ValidUTF8PrefixLength(data) == data.size())
+        return true;
+
+    std::unique_ptr<wxCSConv> conv;
+    std::string converted;
+    if (!isUTF8)
+    {
+        conv.reset(new wxCSConv(charset));
+        converted.reserve(data.size() + data.size() / 4);
     }
 
     bool ok = true;
-    size_t cnt = f.GetLineCount();
-    for (size_t i = 0; i < cnt; i++)
+    int lineNumber = 0;
+    size_t pos = 0;
+    while (pos < data.size())
     {
-        if (f[i].empty() && !f2[i].empty()) // wxMBConv conversion failed
+        lineNumber++;
+
+        size_t eol = data.find_first_of("\r\n", pos);
+        if (eol == std::string::npos)
+            eol = data.size();
+        size_t next = eol;
+        if (next < data.size())
+            next += (data[next] == '\r' && next + 1 < data.size() && data[next + 1] == '\n') ? 2 : 1;
+
+        const std::string_view line(data.data() + pos, eol - pos);
+        bool valid = true;
+        if (isUTF8)
+        {
+            valid = ValidUTF8PrefixLength(line) == line.size();
+            if (!valid)
+                std::fill(data.begin() + pos, data.begin() + eol, ' ');
+        }
+        else
+        {
+            if (!line.empty())
+            {
+                wxString s(line.data(), *conv, line.size());
+                if (s.empty()) // wxMBConv conversion failed
+                    valid = false;
+                else
+                    converted += str::to_utf8(s);
+            }
+            converted.append(data, eol, next - eol);
+        }
+
+        if (!valid)
         {
             wxLogError(
                 _(L"Line %d of file “%s” is corrupted (not valid %s data)."),
-                int(i), filename.c_str(), charset.c_str());
+                lineNumber, filename.c_str(), charset.c_str());
             ok = false;
         }
+
+        pos = next;
     }
 
+    if (!isUTF8)
+        data.swap(converted);
+
     return ok;
 }
 
 
-wxTextFileType GetFileCRLFFormat(wxTextFile& po_file)
-{
-    wxLogNull null;
-    auto crlf = po_file.GuessType();
-
-    // Discard any unsupported setting. In particular, we ignore "Mac"
-    // line endings, because the ancient OS 9 systems aren't used anymore,
-    // OSX uses Unix ending *and* "Mac" endings break gettext tools. So if
-    // we encounter a catalog with "Mac" line endings, we silently convert
-    // it into Unix endings (i.e. the modern Mac).
-    if (crlf == wxTextFileType_Mac)
-        crlf = wxTextFileType_Unix;
-    if (crlf != wxTextFileType_Dos && crlf != wxTextFileType_Unix)
-        crlf = wxTextFileType_None;
-    return crlf;
-}
-
 wxTextFileType GetDesiredCRLFFormat(wxTextFileType existingCRLF)
 {
     if (existingCRLF != wxTextFileType_None && wxConfigBase::Get()->ReadBool("keep_crlf", true))
@@ -223,129 +377,197 @@ unsigned GetCountFromPluralFormsHeader(const Catalog::HeaderData& header)
 
 bool POCatalogParser::Parse()
 {
-    static const wxString prefix_flags(wxS("#, "));
-    static const wxString prefix_autocomments(wxS("#. "));
-    static const wxString prefix_autocomments2(wxS("#.")); // account for empty auto comments
-    static const wxString prefix_references(wxS("#: "));
-    static const wxString prefix_prev_msgid(wxS("#| "));
-    static const wxString prefix_msgctxt(wxS("msgctxt \""));
-    static const wxString prefix_msgid(wxS("msgid \""));
-    static const wxString prefix_msgid_plural(wxS("msgid_plural \""));
-    static const wxString prefix_msgstr(wxS("msgstr \""));
-    static const wxString prefix_msgstr_plural(wxS("msgstr["));
-    static const wxString prefix_deleted(wxS("#~"));
-    static const wxString prefix_deleted_msgid(wxS("#~ msgid"));
-
-    if (m_textFile->GetLineCount() == 0)
+    static const std::string_view prefix_flags("#, ");
+    static const std::string_view prefix_autocomments("#. ");
+    static const std::string_view prefix_autocomments2("#."); // account for empty auto comments
+    static const std::string_view prefix_references("#: ");
+    static const std::string_view prefix_prev_msgid("#| ");
+    static const std::string_view prefix_msgctxt("msgctxt \"");
+    static const std::string_view prefix_msgid("msgid \"");
+    static const std::string_view prefix_msgid_plural("msgid_plural \"");
+    static const std::string_view prefix_msgstr("msgstr \"");
+    static const std::string_view prefix_msgstr_plural("msgstr[");
+    static const std::string_view prefix_deleted("#~");
+    static const std::string_view prefix_deleted_msgid("#~ msgid");
+
+    if (m_data.empty())
         return false;
 
-    wxString line, dummy;
-    wxString mflags, mstr, msgid_plural, mcomment;
-    wxArrayString mrefs, mextractedcomments, mtranslations;
-    wxArrayString msgid_old;
+    std::string_view line, dummy;
+    std::string mflags, mstr, msgid_plural, mcomment;
+    std::vector<std::string> mrefs, mextractedcomments, mtranslations;
+    std::vector<std::string> msgid_old;
     bool has_plural = false;
     bool has_context = false;
-    wxString msgctxt;
+    std::string msgctxt;
     unsigned mlinenum = 0;
 
-    line = m_textFile->GetFirstLine();
-    if (line.empty()) line = ReadTextLine();
+    // Appends (unescaped) value of the quoted string that continues on following lines:
+    auto readContinuationLines = [&](std::string& str)
+    {
+        while (!(line = ReadTextLine()).empty())
+        {
+            if (line.front() == '"' && line.back() == '"')
+            {
+                AppendUnescapedCString(str, line.substr(1, line.size() - 2));
+                PossibleWrappedLine();
+            }
+            else
+                break;
+        }
+    };
+
+    // Reads the first line of a quoted value, i.e. the rest of it after the opening quote:
+    auto readValue = [&](std::string& str)
+    {
+        str.clear();
+        if (!dummy.empty())
+            AppendUnescapedCString(str, dummy.substr(0, dummy.size() - 1));
+        readContinuationLines(str);
+    };
+
+    auto resetEntry = [&]
+    {
+        mcomment.clear();
+        mstr.clear();
+        msgid_plural.clear();
+        mflags.clear();
+        has_plural = false;
+        mrefs.clear();
+        mextractedcomments.clear();
+        mtranslations.clear();
+        msgid_old.clear();
+    };
+
+    line = ReadTextLine();
 
     while (!line.empty())
     {
         // ignore empty special tags (except for extracted comments which we
         // DO want to preserve):
-        while (line.length() == 2 && *line.begin() == '#' && (line[1] == ',' || line[1] == ':' || line[1] == '|'))
+        while (line.length() == 2 && line[0] == '#' && (line[1] == ',' || line[1] == ':' || line[1] == '|'))
             line = ReadTextLine();
+        if (line.empty())
+            break;
 
-        // flags:
-        // Can't we have more than one flag, now only the last is kept ...
-        if (ReadParam(line, prefix_flags, dummy))
+        // Dispatch on the line's first bytes; PO syntax keywords are all ASCII.
+        if (line[0] == '#')
         {
-            static wxString prefix_flags_partial(wxS(", "));
-            mflags = prefix_flags_partial + dummy;
-            line = ReadTextLine();
-        }
+            switch (line.size() > 1 ? line[1] : '\0')
+            {
+                // flags:
+                // Can't we have more than one flag, now only the last is kept ...
+                case ',':
+                {
+                    if (ReadParam(line, prefix_flags, dummy))
+                    {
+                        mflags.assign(", ");
+                        mflags.append(dummy);
+                    }
+                    line = ReadTextLine();
+                    continue;
+                }
 
-        // auto comments:
-        if (ReadParam(line, prefix_autocomments, dummy, /*preserveWhitespace=*/true) || ReadParam(line, prefix_autocomments2, dummy, /*preserveWhitespace=*/true))
-        {
-            mextractedcomments.Add(dummy);
-            line = ReadTextLine();
-        }
+                // auto comments:
+                case '.':
+                {
+                    if (ReadParam(line, prefix_autocomments, dummy, /*preserveWhitespace=*/true) || ReadParam(line, prefix_autocomments2, dummy, /*preserveWhitespace=*/true))
+                        mextractedcomments.emplace_back(dummy);
+                    line = ReadTextLine();
+                    continue;
+                }
 
-        // references:
-        else if (ReadParam(line, prefix_references, dummy, /*preserveWhitespace=*/true))
-        {
-            // Just store the references unmodified, we don't modify this
-            // data anywhere.
-            mrefs.push_back(dummy);
-            line = ReadTextLine();
-        }
+                // references:
+                case ':':
+                {
+                    // Just store the references unmodified, we don't modify this
+                    // data anywhere.
+                    if (ReadParam(line, prefix_references, dummy, /*preserveWhitespace=*/true))
+                        mrefs.emplace_back(dummy);
+                    line = ReadTextLine();
+                    continue;
+                }
 
-        // previous msgid value:
-        else if (ReadParam(line, prefix_prev_msgid, dummy))
-        {
-            msgid_old.Add(dummy);
-            line = ReadTextLine();
+                // deleted lines:
+                case '~':
+                {
+                    std::vector<std::string> deletedLines;
+                    deletedLines.emplace_back(line);
+                    mlinenum = m_lineNumber;
+                    while (!(line = ReadTextLine()).empty())
+                    {
+                        // if line does not start with "#~" anymore, stop reading
+                        if (!ReadParam(line, prefix_deleted, dummy))
+                            break;
+                        // if the line starts with "#~ msgid", we skipped an empty line
+                        // and it's a new entry, so stop reading too (see bug #329)
+                        if (ReadParam(line, prefix_deleted_msgid, dummy))
+                            break;
+
+                        deletedLines.emplace_back(line);
+                    }
+
+                    if (!m_ignoreTranslations)
+                    {
+                        if (!OnDeletedEntry(ToArrayString(deletedLines),
+                                            ToString(mflags), ToArrayString(mrefs), ToString(mcomment), ToArrayString(mextractedcomments),
+                                            mlinenum))
+                        {
+                            return false;
+                        }
+                    }
+
+                    resetEntry();
+                    continue;
+                }
+
+                // previous msgid value:
+                case '|':
+                {
+                    if (ReadParam(line, prefix_prev_msgid, dummy))
+                    {
+                        msgid_old.emplace_back(dummy);
+                        line = ReadTextLine();
+                        continue;
+                    }
+                    break; // handle as a comment
+                }
+
+                default:
+                    break;
+            }
+
+            // comment:
+            while (!line.empty() &&
+                    line[0] == '#' &&
+                   (line.length() < 2 || (line[1] != ',' && line[1] != ':' && line[1] != '.' && line[1] != '~' )))
+            {
+                mcomment.append(line);
+                mcomment += '\n';
+                line = ReadTextLine();
+            }
         }
 
         // msgctxt:
         else if (ReadParam(line, prefix_msgctxt, dummy))
         {
             has_context = true;
-            msgctxt = UnescapeCString(dummy.RemoveLast());
-            while (!(line = ReadTextLine()).empty())
-            {
-                if (line[0u] == _T('\t'))
-                    line.Remove(0, 1);
-                if (line[0u] == _T('"') && line.Last() == _T('"'))
-                {
-                    msgctxt += UnescapeCString(line.Mid(1, line.Length() - 2));
-                    PossibleWrappedLine();
-                }
-                else
-                    break;
-            }
+            readValue(msgctxt);
         }
 
         // msgid:
         else if (ReadParam(line, prefix_msgid, dummy))
         {
-            mstr = UnescapeCString(dummy.RemoveLast());
-            mlinenum = unsigned(m_textFile->GetCurrentLine() + 1);
-            while (!(line = ReadTextLine()).empty())
-            {
-                if (line[0u] == wxS('\t'))
-                    line.Remove(0, 1);
-                if (line[0u] == wxS('"') && line.Last() == wxS('"'))
-                {
-                    mstr += UnescapeCString(line.Mid(1, line.Length() - 2));
-                    PossibleWrappedLine();
-                }
-                else
-                    break;
-            }
+            mlinenum = m_lineNumber;
+            readValue(mstr);
         }
 
         // msgid_plural:
         else if (ReadParam(line, prefix_msgid_plural, dummy))
         {
-            msgid_plural = UnescapeCString(dummy.RemoveLast());
             has_plural = true;
-            mlinenum = unsigned(m_textFile->GetCurrentLine() + 1);
-            while (!(line = ReadTextLine()).empty())
-            {
-                if (line[0u] == _T('\t'))
-                    line.Remove(0, 1);
-                if (line[0u] == _T('"') && line.Last() == _T('"'))
-                {
-                    msgid_plural += UnescapeCString(line.Mid(1, line.Length() - 2));
-                    PossibleWrappedLine();
-                }
-                else
-                    break;
-            }
+            mlinenum = m_lineNumber;
+            readValue(msgid_plural);
         }
 
         // msgstr:
@@ -357,20 +579,8 @@ bool POCatalogParser::Parse()
                 return false;
             }
 
-            wxString str = UnescapeCString(dummy.RemoveLast());
-            while (!(line = ReadTextLine()).empty())
-            {
-                if (line[0u] == _T('\t'))
-                    line.Remove(0, 1);
-                if (line[0u] == _T('"') && line.Last() == _T('"'))
-                {
-                    str += UnescapeCString(line.Mid(1, line.Length() - 2));
-                    PossibleWrappedLine();
-                }
-                else
-                    break;
-            }
-            mtranslations.Add(str);
+            mtranslations.emplace_back();
+            readValue(mtranslations.back());
 
             bool shouldIgnore = m_ignoreHeader && (mstr.empty() && !has_context);
             if ( shouldIgnore )
@@ -382,22 +592,19 @@ bool POCatalogParser::Parse()
                 if (!mstr.empty() && m_ignoreTranslations)
                     mtranslations.clear();
 
-                if (!OnEntry(mstr, wxEmptyString, false,
-                             has_context, msgctxt,
-                             mtranslations,
-                             mflags, mrefs, mcomment, mextractedcomments, msgid_old,
+                if (!OnEntry(ToString(mstr), wxEmptyString, false,
+                             has_context, ToString(msgctxt),
+                             ToArrayString(mtranslations),
+                             ToString(mflags), ToArrayString(mrefs), ToString(mcomment), ToArrayString(mextractedcomments), ToArrayString(msgid_old),
                              mlinenum))
                 {
                     return false;
                 }
             }
 
-            mcomment = mstr = msgid_plural = msgctxt = mflags = wxEmptyString;
-            has_plural = has_context = false;
-            mrefs.Clear();
-            mextractedcomments.Clear();
-            mtranslations.Clear();
-            msgid_old.Clear();
+            resetEntry();
+            msgctxt.clear();
+            has_context = false;
         }
 
         // msgstr[i]:
@@ -409,106 +616,39 @@ bool POCatalogParser::Parse()
                 return false;
             }
 
-            wxString idx = dummy.BeforeFirst(wxS(']'));
-            wxString label_prefix = prefix_msgstr_plural + idx + wxS("] \"");
+            std::string label_prefix;
+            auto setLabelPrefix = [&]
+            {
+                label_prefix.assign(prefix_msgstr_plural);
+                label_prefix.append(dummy.substr(0, dummy.find(']')));
+                label_prefix.append("] \"");
+            };
+            setLabelPrefix();
 
             while (ReadParam(line, label_prefix, dummy))
             {
-                wxString str = UnescapeCString(dummy.RemoveLast());
+                mtranslations.emplace_back();
+                readValue(mtranslations.back());
 
-                while (!(line=ReadTextLine()).empty())
-                {
-                    line.Trim(/*fromRight=*/false);
-                    if (line[0u] == wxS('"') && line.Last() == wxS('"'))
-                    {
-                        str += UnescapeCString(line.Mid(1, line.Length() - 2));
-                        PossibleWrappedLine();
-                    }
-                    else
-                    {
-                        if (ReadParam(line, prefix_msgstr_plural, dummy))
-                        {
-                            idx = dummy.BeforeFirst(wxS(']'));
-                            label_prefix = prefix_msgstr_plural + idx + wxS("] \"");
-                        }
-                        break;
-                    }
-                }
-                mtranslations.Add(str);
+                if (!line.empty() && ReadParam(line, prefix_msgstr_plural, dummy))
+                    setLabelPrefix();
             }
 
             if (m_ignoreTranslations)
                 mtranslations.clear();
 
-            if (!OnEntry(mstr, msgid_plural, true,
-                         has_context, msgctxt,
-                         mtranslations,
-                         mflags, mrefs, mcomment, mextractedcomments, msgid_old,
+            if (!OnEntry(ToString(mstr), ToString(msgid_plural), true,
+                         has_context, ToString(msgctxt),
+                         ToArrayString(mtranslations),
+                         ToString(mflags), ToArrayString(mrefs), ToString(mcomment), ToArrayString(mextractedcomments), ToArrayString(msgid_old),
                          mlinenum))
             {
                 return false;
             }
 
-            mcomment = mstr = msgid_plural = msgctxt = mflags = wxEmptyString;
-            has_plural = has_context = false;
-            mrefs.Clear();
-            mextractedcomments.Clear();
-            mtranslations.Clear();
-            msgid_old.Clear();
-        }
-
-        // deleted lines:
-        else if (ReadParam(line, prefix_deleted, dummy))
-        {
-            wxArrayString deletedLines;
-            deletedLines.Add(line);
-            mlinenum = unsigned(m_textFile->GetCurrentLine() + 1);
-            while (!(line = ReadTextLine()).empty())
-            {
-                // if line does not start with "#~" anymore, stop reading
-                if (!ReadParam(line, prefix_deleted, dummy))
-                    break;
-                // if the line starts with "#~ msgid", we skipped an empty line
-                // and it's a new entry, so stop reading too (see bug #329)
-                if (ReadParam(line, prefix_deleted_msgid, dummy))
-                    break;
-
-                deletedLines.Add(line);
-            }
-
-            if (!m_ignoreTranslations)
-            {
-                if (!OnDeletedEntry(deletedLines,
-                                    mflags, mrefs, mcomment, mextractedcomments, mlinenum))
-                {
-                    return false;
-                }
-            }
-
-            mcomment = mstr = msgid_plural = mflags = wxEmptyString;
-            has_plural = false;
-            mrefs.Clear();
-            mextractedcomments.Clear();
-            mtranslations.Clear();
-            msgid_old.Clear();
-        }
-
-        // comment:
-        else if (line[0u] == wxS('#'))
-        {
-            bool readNewLine = false;
-
-            while (!line.empty() &&
-                    line[0u] == wxS('#') &&
-                   (line.Length() < 2 || (line[1u] != wxS(',') && line[1u] != wxS(':') && line[1u] != wxS('.') && line[1u] != wxS('~') )))
-            {
-                mcomment << line << wxS('\n');
-                readNewLine = true;
-                line = ReadTextLine();
-            }
-
-            if (!readNewLine)
-                line = ReadTextLine();
+            resetEntry();
+            msgctxt.clear();
+            has_context = false;
         }
 
         else
@@ -521,29 +661,58 @@ bool POCatalogParser::Parse()
 }
 
 
-wxString POCatalogParser::ReadTextLine()
+std::string_view POCatalogParser::ReadTextLine()
 {
     m_previousLineHardWrapped = m_lastLineHardWrapped;
     m_lastLineHardWrapped = false;
 
-    static const wxString msgid_alone(wxS("msgid \"\""));
-    static const wxString msgstr_alone(wxS("msgstr \"\""));
+    static const std::string_view msgid_alone("msgid \"\"");
+    static const std::string_view msgstr_alone("msgstr \"\"");
+
+    const char *data = m_data.data();
+    const size_t length = m_data.size();
 
     for (;;)
     {
-        if (m_textFile->Eof())
-            return wxString();
+        if (m_pos >= length)
+            return std::string_view();
+
+        // find the end of the line, accepting all of Unix, DOS and Mac line endings:
+        size_t eol = m_pos;
+        while (eol < length && data[eol] != '\n' && data[eol] != '\r')
+            eol++;
+
+        std::string_view ln(data + m_pos, eol - m_pos);
+        m_lineNumber++;
+
+        m_pos = eol;
+        if (m_pos < length)
+        {
+            if (data[m_pos] == '\n')
+            {
+                m_endingsUnix++;
+                m_pos++;
+            }
+            else if (m_pos + 1 < length && data[m_pos + 1] == '\n')
+            {
+                m_endingsDos++;
+                m_pos += 2;
+            }
+            else
+            {
+                m_endingsMac++;
+                m_pos++;
+            }
+        }
 
-        // read next line and strip insignificant whitespace from it:
-        const auto& ln = m_textFile->GetNextLine();
         if (ln.empty())
             continue;
 
         // gettext tools don't include (extracted) comments in wrapping, so they can't
         // be reliably used to detect file's wrapping either; just skip them.
-        if (!ln.starts_with(wxS("#. ")) && !ln.starts_with(wxS("# ")))
+        if (ln.compare(0, 3, "#. ") != 0 && ln.compare(0, 2, "# ") != 0)
         {
-            if (ln.ends_with(wxS("\\n\"")))
+            if (ln.size() >= 3 && ln.compare(ln.size() - 3, 3, "\\n\"") == 0)
             {
                 // Similarly, lines ending with \n are always wrapped, so skip that too.
                 m_lastLineHardWrapped = true;
@@ -559,26 +728,28 @@ wxString POCatalogParser::ReadTextLine()
                 // That "2" is to account for unwrappable comment lines: "#: somethinglong"
                 // See https://github.com/vslavik/poedit/issues/135
                 auto space = ln.find_last_of(' ');
-                if (space != wxString::npos && space > 2)
+                if (space != std::string_view::npos && space > 2)
                 {
-                    m_detectedLineWidth = std::max(m_detectedLineWidth, (int)ln.size());
+                    m_detectedLineWidth = std::max(m_detectedLineWidth, (int)UTF8Length(ln));
                 }
             }
         }
 
-        if (wxIsspace(ln[0]) || wxIsspace(ln.Last()))
+        // strip insignificant whitespace:
+        if (IsSpace(ln.front()) || IsSpace(ln.back()))
         {
-            auto s = ln.Strip(wxString::both);
-            if (!s.empty())
-                return s;
+            while (!ln.empty() && IsSpace(ln.front()))
+                ln.remove_prefix(1);
+            while (!ln.empty() && IsSpace(ln.back()))
+                ln.remove_suffix(1);
+            if (!ln.empty())
+                return ln;
         }
         else
         {
             return ln;
         }
     }
-
-    return wxString();
 }
 
 int POCatalogParser::GetWrappingWidth() const
@@ -589,13 +760,47 @@ int POCatalogParser::GetWrappingWidth() const
     return m_detectedLineWidth;
 }
 
+wxTextFileType POCatalogParser::GetLineEndingsType() const
+{
+    // We ignore "Mac" line endings, because the ancient OS 9 systems aren't
+    // used anymore, OSX uses Unix ending *and* "Mac" endings break gettext
+    // tools. So if we encounter a catalog with "Mac" line endings, we silently
+    // convert it into Unix endings (i.e. the modern Mac).
+    if (m_endingsDos == 0 && m_endingsUnix == 0 && m_endingsMac == 0)
+        return wxTextFileType_None;
+    else if (m_endingsDos > m_endingsUnix + m_endingsMac)
+        return wxTextFileType_Dos;
+    else
+        return wxTextFileType_Unix;
+}
+
+wxString POCatalogParser::ToString(std::string_view s) const
+{
+    if (s.empty())
+        return wxString();
+    if (m_conv)
+        return wxString(s.data(), *m_conv, s.size());
+    else
+        return wxString::FromUTF8Unchecked(s.data(), s.size());
+}
+
+wxArrayString POCatalogParser::ToArrayString(const std::vector<std::string>& a) const
+{
+    wxArrayString out;
+    out.reserve(a.size());
+    for (auto& s: a)
+        out.push_back(ToString(s));
+    return out;
+}
+
 
 
 class POCharsetInfoFinder : public POCatalogParser
 {
     public:
-        POCharsetInfoFinder(wxTextFile *f)
-                : POCatalogParser(f), m_charset("UTF-8") {}
+        // PO syntax and the header are ASCII, so any file can be read as Latin-1 here:
+        POCharsetInfoFinder(std::string_view data)
+                : POCatalogParser(data, &wxConvISO8859_1), m_charset("UTF-8") {}
         wxString GetCharset() const { return m_charset; }
 
     protected:
@@ -633,8 +838,8 @@ class POCharsetInfoFinder : public POCatalogParser
 class POLoadParser : public POCatalogParser
 {
     public:
-        POLoadParser(POCatalog& c, wxTextFile *f)
-              : POCatalogParser(f),
+        POLoadParser(POCatalog& c, std::string_view data)
+              : POCatalogParser(data),
                 FileIsValid(false),
                 m_catalog(c), m_nextId(1), m_seenHeaderAlready(false) {}
 
@@ -910,8 +1115,6 @@ static inline wxString GetCurrentTimeString()
 
 void POCatalog::Load(const wxString& po_file, int flags)
 {
-    wxTextFile f;
-
     Clear();
     m_fileName = po_file;
     m_header.BasePath = wxEmptyString;
@@ -925,31 +1128,31 @@ void POCatalog::Load(const wxString& po_file, int flags)
 
     /* Load the .po file: */
 
-    if (!f.Open(po_file, wxConvISO8859_1))
+    // The file is read into memory only once and parsed from there; it is
+    // only converted if it isn't in UTF-8, which the parser works with.
+    std::string data;
+    if (!ReadFileContent(po_file, data))
     {
         BOOST_THROW_EXCEPTION(Exception(_(L"Couldn’t load the file, it is probably damaged.")));
     }
 
+    // UTF-8 BOM is not part of the content:
+    if (data.compare(0, 3, "\xEF\xBB\xBF") == 0)
+        data.erase(0, 3);
+
     {
         wxLogNull null; // don't report parsing errors from here, report them later
-        POCharsetInfoFinder charsetFinder(&f);
+        POCharsetInfoFinder charsetFinder(data);
         charsetFinder.Parse();
         m_header.Charset = charsetFinder.GetCharset();
     }
 
-    f.Close();
-    wxCSConv encConv(m_header.Charset);
-    if (!f.Open(po_file, encConv))
-    {
-        BOOST_THROW_EXCEPTION(Exception(_(L"Couldn’t load the file, it is probably damaged.")));
-    }
-
-    if (!VerifyFileCharset(f, po_file, m_header.Charset))
+    if (!ConvertFileContentToUTF8(data, po_file, m_header.Charset))
     {
         wxLogError(_("There were errors when loading the file. Some data may be missing or corrupted as the result."));
     }
 
-    POLoadParser parser(*this, &f);
+    POLoadParser parser(*this, data);
     parser.IgnoreHeader(flags & CreationFlag_IgnoreHeader);
     parser.IgnoreTranslations(flags & CreationFlag_IgnoreTranslations);
     if (!parser.Parse())
@@ -959,7 +1162,7 @@ void POCatalog::Load(const wxString& po_file, int flags)
 
     m_sourceLanguage = parser.GetSpecifiedMsgidLanguage();  // may be, and likely will, invalid
 
-    m_fileCRLF = GetFileCRLFFormat(f);
+    m_fileCRLF = parser.GetLineEndingsType();
     m_fileWrappingWidth = parser.GetWrappingWidth();
     wxLogTrace("poedit", "detect line wrapping: %d", m_fileWrappingWidth);
 
@@ -969,8 +1172,6 @@ void POCatalog::Load(const wxString& po_file, int flags)
         BOOST_THROW_EXCEPTION(Exception(_(L"Couldn’t load the file, it is probably damaged.")));
     }
 
-    f.Close();
-
     FixupCommonIssues();
 
     if ( flags & CreationFlag_IgnoreHeader )
@@ -1056,33 +1257,6 @@ void POCatalog::Clear()
 namespace
 {
 
-inline bool CanEncodeStringToCharset(const wxString& s, wxMBConv& conv)
-{
-    if (s.empty())
-        return true;
-    const wxCharBuffer converted(s.mb_str(conv));
-    if ( converted.length() == 0 )
-        return false;
-    return true;
-}
-
-bool CanEncodeToCharset(const wxTextBuffer& f, const wxString& charset)
-{
-    if (charset.Lower() == "utf-8" || charset.Lower() == "utf8")
-        return true;
-
-    wxCSConv conv(charset);
-
-    const size_t lines = f.GetLineCount();
-    for ( size_t i = 0; i < lines; i++ )
-    {
-        if ( !CanEncodeStringToCharset(f.GetLine(i), conv) )
-            return false;
-    }
-
-    return true;
-}
-
 template<typename Func>
 inline void SplitIntoLines(const wxString& text, Func&& f)
 {
@@ -1103,38 +1277,109 @@ inline void SplitIntoLines(const wxString& text, Func&& f)
         f(wxString(last, text.end()), true);
 }
 
-void SaveMultiLines(wxTextBuffer &f, const wxString& text)
+/// Returns line width to use when saving, or NO_WRAPPING
+int GetOutputWrappingWidth(int fileWrappingWidth)
 {
-    SplitIntoLines(text, [&f](wxString&& s, bool)
+    int wrapping = POCatalog::DEFAULT_WRAPPING;
+    if (wxConfig::Get()->ReadBool("keep_crlf", true))
+        wrapping = fileWrappingWidth;
+
+    if (wrapping == POCatalog::DEFAULT_WRAPPING)
     {
-        f.AddLine(s);
-    });
+        if (wxConfig::Get()->ReadBool("wrap_po_files", true))
+            wrapping = (int)wxConfig::Get()->ReadLong("wrap_po_files_width", 79);
+        else
+            wrapping = POCatalog::NO_WRAPPING;
+    }
+
+    return wrapping;
 }
 
-/** Adds \n characters as necessary for good-looking output
- */
-wxString FormatStringForFile(const wxString& text)
+/// Estimates size of the saved file, for preallocating memory
+size_t EstimateOutputSize(const CatalogItemArray& items)
 {
-    wxString s;
-    s.reserve(text.length() + 16);
-
-    static wxString quoted_newline(wxS("\"\n\""));
+    size_t size = 1024;
+    for (auto& i: items)
+        size += 64 + 2 * (i->GetRawString().length() + i->GetTranslation().length());
+    return size;
+}
 
-    SplitIntoLines(text, [&s](wxString&& piece, bool last)
+/// Adds flags from "#," line to the list, skipping duplicates
+void ParseFlags(const wxString& text, std::vector<wxString>& flags)
+{
+    wxStringTokenizer tkn(text, wxS(", \t"), wxTOKEN_STRTOK);
+    while (tkn.HasMoreTokens())
     {
-        if (!s.empty())
-            s += quoted_newline;
-        if (!last)
-            piece += '\n';
-        EscapeCStringInplace(piece);
-        s += piece;
-    });
-
-    return s;
+        auto flag = tkn.GetNextToken();
+        if (std::find(flags.begin(), flags.end(), flag) == flags.end())
+            flags.push_back(flag);
+    }
 }
 
-} // anonymous namespace
-
+/// Reformats saved file with msgcat, for when POWriter couldn't match its output exactly
+bool ReformatWithMsgcat(const wxString& po_file, int wrapping, wxTextFileType crlf, const wxString& charset)
+{
+    TempOutputFileFor po_file_temp_obj(po_file);
+    const wxString po_file_temp = po_file_temp_obj.FileName();
+
+    std::vector<wxString> args { "msgcat", "--force-po" };
+    if (wrapping == POCatalog::NO_WRAPPING)
+        args.push_back("--no-wrap");
+    else
+        args.push_back(wxString::Format("--width=%d", wrapping));
+    args.push_back("-o");
+    args.push_back(CliSafeFileName(po_file_temp));
+    args.push_back(CliSafeFileName(po_file));
+
+    wxLogTrace("poedit", "formatting file %s with msgcat", po_file);
+
+    // errors output is irrelevant here, validation reports any problems with the file
+    if (!GettextRunner().run_sync(args) || !wxFileName::FileExists(po_file_temp))
+        return false;
+
+    // msgcat always outputs Unix line endings, so we need to reformat the file
+    if (crlf == wxTextFileType_Dos)
+    {
+        wxCSConv conv(charset);
+        wxTextFile finalFile(po_file_temp);
+        if (finalFile.Open(conv))
+            finalFile.Write(crlf, conv);
+    }
+
+    return TempOutputFileFor::ReplaceFile(po_file_temp, po_file);
+}
+
+/// Parses raw "#| " lines into (keyword, unescaped value) pairs, so that they can be rewrapped
+bool ParsePreviousMsgid(const wxArrayString& lines, std::vector<std::pair<wxString, wxString>>& out)
+{
+    for (auto& line: lines)
+    {
+        if (line.empty())
+            return false;
+
+        if (line[0] == '"')
+        {
+            if (out.empty() || line.length() < 2 || line.Last() != '"')
+                return false;
+            out.back().second += UnescapeCString(line.Mid(1, line.length() - 2));
+        }
+        else
+        {
+            auto space = line.find(' ');
+            if (space == wxString::npos || line.length() < space + 3 || line[space + 1] != '"' || line.Last() != '"')
+                return false;
+            auto keyword = line.substr(0, space);
+            if (keyword != "msgctxt" && keyword != "msgid" && keyword != "msgid_plural")
+                return false;
+            out.emplace_back(keyword, UnescapeCString(line.Mid(space + 2, line.length() - space - 3)));
+        }
+    }
+
+    return true;
+}
+
+} // anonymous namespace
+
 
 #ifdef __WXOSX__
 
@@ -1188,12 +1433,9 @@ bool POCatalog::Save(const wxString& po_file, bool save_mo,
     TempOutputFileFor po_file_temp_obj(po_file);
     const wxString po_file_temp = po_file_temp_obj.FileName();
 
-    wxTextFileType outputCrlf = GetDesiredCRLFFormat(m_fileCRLF);
-    // Save into Unix line endings first and only if Windows is required,
-    // reformat the file later. This is because msgcat cannot handle DOS
-    // input particularly well.
+    const wxTextFileType outputCrlf = GetDesiredCRLFFormat(m_fileCRLF);
 
-    if ( !DoSaveOnly(po_file_temp, wxTextFileType_Unix) )
+    if ( !DoSaveOnly(po_file_temp, outputCrlf) )
     {
         wxLogError(_(L"Couldn’t save file %s."), po_file.c_str());
         return false;
@@ -1210,88 +1452,12 @@ bool POCatalog::Save(const wxString& po_file, bool save_mo,
         wxLogError("%s", DescribeCurrentException());
     }
 
-    // Now that the file was written, run msgcat to re-format it according
-    // to the usual format. This is a (barely) passable fix for #25 until
-    // proper preservation of formatting is implemented.
-
-    bool msgcat_ok = false;
-    {
-        wxArrayString args { "msgcat", "--force-po" };
-
-        int wrapping = DEFAULT_WRAPPING;
-        if (wxConfig::Get()->ReadBool("keep_crlf", true))
-            wrapping = m_fileWrappingWidth;
-
-        if (wrapping == DEFAULT_WRAPPING)
-        {
-            if (wxConfig::Get()->ReadBool("wrap_po_files", true))
-            {
-                wrapping = (int)wxConfig::Get()->ReadLong("wrap_po_files_width", 79);
-            }
-            else
-            {
-                wrapping = NO_WRAPPING;
-            }
-        }
-
-        if (wrapping == NO_WRAPPING)
-            args.push_back("--no-wrap");
-        else if (wrapping != DEFAULT_WRAPPING)
-            args.push_back(wxString::Format("--width=%d", wrapping));
-
-        TempOutputFileFor po_file_temp2_obj(po_file_temp);
-        const wxString po_file_temp2 = po_file_temp2_obj.FileName();
-
-        args.push_back("-o");
-        args.push_back(po_file_temp2);
-        args.push_back(po_file_temp);
-
-        wxLogTrace("poedit", "formatting file with %s", wxJoin(args, ' '));
-
-        // Ignore msgcat errors output (but not exit code), because it
-        //   a) complains about things DoValidate() already complained above
-        //   b) issues warnings about source-extraction things (e.g. using non-ASCII
-        //      msgids) that, while correct, are not something a *translator* can
-        //      do anything about.
-        GettextRunner runner;
-        msgcat_ok = runner.run_sync(args) && wxFileExists(po_file_temp2);
-
-        // msgcat always outputs Unix line endings, so we need to reformat the file
-        if (msgcat_ok && outputCrlf == wxTextFileType_Dos)
-        {
-            wxCSConv conv(m_header.Charset);
-            wxTextFile finalFile(po_file_temp2);
-            if (finalFile.Open(conv))
-                finalFile.Write(outputCrlf, conv);
-        }
-
-        if (!TempOutputFileFor::ReplaceFile(po_file_temp2, po_file))
-            msgcat_ok = false;
-    }
-
-    if ( msgcat_ok )
+    if ( !po_file_temp_obj.Commit() )
     {
-        wxRemoveFile(po_file_temp);
-    }
-    else
-    {
-        if ( !po_file_temp_obj.Commit() )
-        {
-            wxLogError(_(L"Couldn’t save file %s."), po_file.c_str());
-        }
-        else
-        {
-            // Only shows msgcat's failure warning if we don't also get
-            // validation errors, because if we do, the cause is likely the
-            // same.
-            if ( !validation_results.errors )
-            {
-                wxLogWarning(_("There was a problem formatting the file nicely (but it was saved all right)."));
-            }
-        }
+        wxLogError(_(L"Couldn’t save file %s."), po_file.c_str());
+        return false;
     }
 
-    
     /* If the user wants it, compile .mo file right now: */
 
     bool compileMO = save_mo;
@@ -1304,29 +1470,14 @@ bool POCatalog::Save(const wxString& po_file, bool save_mo,
         TempOutputFileFor mo_file_temp_obj(mo_file);
         const wxString mo_file_temp = mo_file_temp_obj.FileName();
 
-        {
-            // Ignore msgfmt errors output (but not exit code), because it
-            // complains about things DoValidate() already complained above.
-            if (GettextRunner().run_sync("msgfmt", "-o", mo_file_temp, CliSafeFileName(po_file)))
-            {
-                mo_compilation_status = CompilationStatus::Success;
-            }
-            else
-            {
-                // Don't report errors, they were reported as part of validation
-                // step above.  Notice that we run msgfmt *without* the -c flag
-                // here to create the MO file in as many cases as possible, even if
-                // it has some errors.
-                //
-                // Still, msgfmt has the ugly habit of sometimes returning non-zero
-                // exit code, reporting "fatal errors" and *still* producing a usable
-                // .mo file. If this happens, don't pretend the file wasn't created.
-                if (wxFileName::FileExists(mo_file_temp))
-                    mo_compilation_status = CompilationStatus::Success;
-                else
-                    mo_compilation_status = CompilationStatus::Error;
-            }
-        }
+        // Note that the MO file is created even if there are errors in the
+        // catalog (they were reported as part of validation step above), to
+        // produce usable output in as many cases as possible, like msgfmt
+        // without the -c flag would.
+        if (DoCompileMO(mo_file_temp))
+            mo_compilation_status = CompilationStatus::Success;
+        else
+            mo_compilation_status = CompilationStatus::Error;
 
         // Move the MO from temporary location to the final one, if it was created
         if (mo_compilation_status == CompilationStatus::Success)
@@ -1375,30 +1526,10 @@ bool POCatalog::Save(const wxString& po_file, bool save_mo,
 
 std::string POCatalog::SaveToBuffer()
 {
-    class StringSerializer : public wxMemoryText
-    {
-    public:
-        bool OnWrite(wxTextFileType typeNew, const wxMBConv& conv) override
-        {
-            size_t cnt = GetLineCount();
-            for (size_t n = 0; n < cnt; n++)
-            {
-                auto ln = GetLine(n) +
-                          GetEOL(typeNew == wxTextFileType_None ? GetLineType(n) : typeNew);
-                auto buf = ln.mb_str(conv);
-                buffer.append(buf.data(), buf.length());
-            }
-            return true;
-        }
-
-        std::string buffer;
-    };
-
-    StringSerializer f;
-
-    if (!DoSaveOnly(f, wxTextFileType_Unix))
+    std::string output;
+    if (!DoSaveOnly(output, wxTextFileType_Unix))
         return std::string();
-    return f.buffer;
+    return output;
 }
 
 
@@ -1426,17 +1557,7 @@ bool POCatalog::CompileToMO(const wxString& mo_file,
     TempOutputFileFor mo_file_temp_obj(mo_file);
     const wxString mo_file_temp = mo_file_temp_obj.FileName();
 
-    GettextRunner runner;
-    runner.run_sync("msgfmt", "-o", mo_file_temp, po_file_temp);
-
-    // Ignore msgfmt errors output (but not exit code), because it
-    // complains about things DoValidate() already complained above.
-    //
-    // Don't check return code either:
-    // msgfmt has the ugly habit of sometimes returning non-zero
-    // exit code, reporting "fatal errors" and *still* producing a usable
-    // .mo file. If this happens, don't pretend the file wasn't created.
-    if (!wxFileName::FileExists(mo_file_temp))
+    if (!DoCompileMO(mo_file_temp))
     {
         mo_compilation_status = CompilationStatus::Error;
         return false;
@@ -1460,14 +1581,41 @@ bool POCatalog::CompileToMO(const wxString& mo_file,
 
 bool POCatalog::DoSaveOnly(const wxString& po_file, wxTextFileType crlf)
 {
-    wxTextFile f;
-    if (!f.Create(po_file))
+    auto write = [&po_file](const std::string& output)
+    {
+        wxFile f;
+        if (!f.Create(po_file, /*overwrite=*/true))
+            return false;
+        return f.Write(output.data(), output.size()) == output.size() && f.Close();
+    };
+
+    std::string output;
+    bool needsMsgcat = false;
+    if (!DoSaveOnly(output, crlf, &needsMsgcat))
         return false;
 
-    return DoSaveOnly(f, crlf);
+    if (!needsMsgcat)
+        return write(output);
+
+    // Strings in formats whose directives POWriter doesn't recognize had to be
+    // wrapped, possibly differently from gettext, so let msgcat format them.
+    // msgcat is given Unix line endings and ReformatWithMsgcat() restores DOS ones.
+    if (crlf != wxTextFileType_Unix && !DoSaveOnly(output, wxTextFileType_Unix))
+        return false;
+    if (!write(output))
+        return false;
+
+    if (ReformatWithMsgcat(po_file, GetOutputWrappingWidth(m_fileWrappingWidth), crlf, m_header.Charset))
+        return true;
+
+    // the file is still usable, just formatted a bit differently than by gettext:
+    wxLogTrace("poedit", "failed to reformat %s with msgcat", po_file);
+    if (crlf == wxTextFileType_Unix)
+        return true;
+    return DoSaveOnly(output, crlf) && write(output);
 }
 
-bool POCatalog::DoSaveOnly(wxTextBuffer& f, wxTextFileType crlf)
+bool POCatalog::DoSaveOnly(std::string& output, wxTextFileType crlf, bool *needsMsgcat)
 {
     const bool isPOT = m_fileType == Type::POT;
 
@@ -1475,93 +1623,125 @@ bool POCatalog::DoSaveOnly(wxTextBuffer& f, wxTextFileType crlf)
     if (!m_header.Charset || m_header.Charset == "CHARSET")
         m_header.Charset = "UTF-8";
 
-    SaveMultiLines(f, m_header.Comment);
-    if (isPOT)
-        f.AddLine(wxS("#, fuzzy"));
-    f.AddLine(wxS("msgid \"\""));
-    f.AddLine(wxS("msgstr \"\""));
-    wxString pohdr = wxString(wxS("\"")) + m_header.ToString(wxS("\"\n\""));
-    pohdr.RemoveLast();
-    SaveMultiLines(f, pohdr);
-    f.AddLine(wxEmptyString);
+    POWriter f(crlf, GetOutputWrappingWidth(m_fileWrappingWidth), EstimateOutputSize(m_items));
+
+    // Header entry; gettext normalizes the order of its comments:
+    {
+        wxString comments;
+        wxArrayString extractedComments, references;
+        std::vector<wxString> flags;
+        if (isPOT)
+            flags.push_back(wxS("fuzzy"));
+
+        SplitIntoLines(m_header.Comment, [&](wxString&& line, bool)
+        {
+            if (line.starts_with(wxS("#.")))
+                extractedComments.push_back(line);
+            else if (line.starts_with(wxS("#:")))
+                references.push_back(line);
+            else if (line.starts_with(wxS("#,")))
+                ParseFlags(line.Mid(2), flags);
+            else
+                comments << line << '\n';
+        });
+
+        f.AddComment(comments);
+        for (auto& line: extractedComments)
+            f.AddLine(line);
+        for (auto& line: references)
+            f.AddLine(line);
+        f.AddFlags(flags);
+
+        m_header.UpdateDict();
+        wxString header;
+        for (auto& e: m_header.GetAllHeaders())
+            header << e.Key << ": " << e.Value << '\n';
+
+        f.AddString(wxS("msgid"), wxString());
+        f.AddString(wxS("msgstr"), header);
+    }
 
     auto pluralsCount = GetPluralFormsCount();
+    std::vector<wxString> flags;
 
     for (auto& data_: m_items)
     {
         auto data = std::static_pointer_cast<POCatalogItem>(data_);
 
+        f.AddEmptyLine();
+
         data->SetLineNumber(int(f.GetLineCount()+1));
-        SaveMultiLines(f, data->GetComment());
-        for (unsigned i = 0; i < data->GetExtractedComments().GetCount(); i++)
+        f.AddComment(data->GetComment());
+        for (auto& comment: data->GetExtractedComments())
+            f.AddExtractedComment(comment);
+        f.AddReferences(data->GetReferences());
+
+        flags.clear();
+        ParseFlags(data->GetFlags(), flags);
+        // gettext doesn't write the fuzzy flag for untranslated entries:
+        if (data->GetTranslation().empty())
+            flags.erase(std::remove(flags.begin(), flags.end(), wxS("fuzzy")), flags.end());
+        f.AddFlags(flags);
+
+        const bool wrap = std::find(flags.begin(), flags.end(), wxS("no-wrap")) == flags.end();
+        const auto format = POWriter::GetFormatSyntax(flags);
+
+        std::vector<std::pair<wxString, wxString>> oldMsgid;
+        if (ParsePreviousMsgid(data->GetOldMsgidRaw(), oldMsgid))
         {
-            if (data->GetExtractedComments()[i].empty())
-              f.AddLine(wxS("#."));
-            else
-              f.AddLine(wxS("#. ") + data->GetExtractedComments()[i]);
+            for (auto& old: oldMsgid)
+                f.AddString(old.first, old.second, wrap, POWriter::FormatSyntax::None, wxS("#| "));
         }
-        for (unsigned i = 0; i < data->GetRawReferences().GetCount(); i++)
-            f.AddLine(wxS("#: ") + data->GetRawReferences()[i]);
-        wxString dummy = data->GetFlags();
-        if (!dummy.empty())
-            f.AddLine(wxS("#") + dummy);
-        for (unsigned i = 0; i < data->GetOldMsgidRaw().GetCount(); i++)
-            f.AddLine(wxS("#| ") + data->GetOldMsgidRaw()[i]);
-        if ( data->HasContext() )
+        else
         {
-            SaveMultiLines(f, wxS("msgctxt \"") + FormatStringForFile(data->GetContext()) + wxS("\""));
+            for (auto& line: data->GetOldMsgidRaw())
+                f.AddLine(wxS("#| ") + line);
         }
-        dummy = FormatStringForFile(data->GetRawString());
-        SaveMultiLines(f, wxS("msgid \"") + dummy + wxS("\""));
+
+        if ( data->HasContext() )
+            f.AddString(wxS("msgctxt"), data->GetContext(), wrap);
+        f.AddString(wxS("msgid"), data->GetRawString(), wrap, format);
         if (data->HasPlural())
         {
-            dummy = FormatStringForFile(data->GetRawPluralString());
-            SaveMultiLines(f, wxS("msgid_plural \"") + dummy + wxS("\""));
+            f.AddString(wxS("msgid_plural"), data->GetRawPluralString(), wrap, format);
 
             for (unsigned i = 0; i < pluralsCount; i++)
-            {
-                dummy = FormatStringForFile(data->GetTranslation(i));
-                wxString hdr = wxString::Format(wxS("msgstr[%u] \""), i);
-                SaveMultiLines(f, hdr + dummy + wxS("\""));
-            }
+                f.AddString(wxString::Format(wxS("msgstr[%u]"), i), data->GetTranslation(i), wrap, format);
         }
         else
         {
-            if (isPOT)
-            {
-                f.AddLine(wxS("msgstr \"\""));
-            }
-            else
-            {
-                dummy = FormatStringForFile(data->GetTranslation());
-                SaveMultiLines(f, wxS("msgstr \"") + dummy + wxS("\""));
-            }
+            f.AddString(wxS("msgstr"), isPOT ? wxString() : data->GetTranslation(), wrap, format);
         }
-        f.AddLine(wxEmptyString);
     }
 
     // Write back deleted items in the file so that they're not lost
-    for (unsigned itemIdx = 0; itemIdx < m_deletedItems.size(); itemIdx++)
+    for (auto& deletedItem: m_deletedItems)
     {
-        if ( itemIdx != 0 )
-            f.AddLine(wxEmptyString);
+        f.AddEmptyLine();
 
-        POCatalogDeletedData& deletedItem = m_deletedItems[itemIdx];
         deletedItem.SetLineNumber(int(f.GetLineCount()+1));
-        SaveMultiLines(f, deletedItem.GetComment());
-        for (unsigned i = 0; i < deletedItem.GetExtractedComments().GetCount(); i++)
-            f.AddLine(wxS("#. ") + deletedItem.GetExtractedComments()[i]);
-        for (unsigned i = 0; i < deletedItem.GetRawReferences().GetCount(); i++)
-            f.AddLine(wxS("#: ") + deletedItem.GetRawReferences()[i]);
-        wxString dummy = deletedItem.GetFlags();
-        if (!dummy.empty())
-            f.AddLine(wxS("#") + dummy);
+        f.AddComment(deletedItem.GetComment());
+        for (auto& comment: deletedItem.GetExtractedComments())
+            f.AddExtractedComment(comment);
+        flags.clear();
+        ParseFlags(deletedItem.GetFlags(), flags);
+        f.AddFlags(flags);
+
+        for (auto& line: deletedItem.GetDeletedLines())
+            f.AddLine(line);
+    }
+
+    if (needsMsgcat)
+        *needsMsgcat = f.HasUnrecognizedWrapping();
 
-        for (size_t j = 0; j < deletedItem.GetDeletedLines().GetCount(); j++)
-            f.AddLine(deletedItem.GetDeletedLines()[j]);
+    if (m_header.Charset.Lower() == "utf-8" || m_header.Charset.Lower() == "utf8")
+    {
+        output = str::to_utf8(f.GetText());
+        return true;
     }
 
-    if (!CanEncodeToCharset(f, m_header.Charset))
+    const wxCharBuffer converted(f.GetText().mb_str(wxCSConv(m_header.Charset)));
+    if (converted.length() == 0)
     {
 #if wxUSE_GUI
         wxString msg;
@@ -1573,12 +1753,63 @@ bool POCatalog::DoSaveOnly(wxTextBuffer& f, wxTextFileType crlf)
         m_header.Charset = "UTF-8";
 
         // Re-do the save again because we modified a header:
-        f.Clear();
-        return DoSaveOnly(f, crlf);
+        return DoSaveOnly(output, crlf, needsMsgcat);
     }
 
     // Otherwise everything can be safely saved:
-    return f.Write(crlf, wxCSConv(m_header.Charset));
+    output.assign(converted.data(), converted.length());
+    return true;
+}
+
+bool POCatalog::DoCompileMO(const wxString& mo_file)
+{
+    // Like msgfmt, store the strings in the PO file's charset, not converted:
+    const bool isUTF8 = m_header.Charset.Lower() == "utf-8" || m_header.Charset.Lower() == "utf8";
+    wxCSConv conv(m_header.Charset);
+
+    auto encode = [&](const wxString& s) -> std::string
+    {
+        if (isUTF8)
+            return str::to_utf8(s);
+        const wxCharBuffer buf = s.mb_str(conv);
+        return std::string(buf.data(), buf.length());
+    };
+
+    MOWriter mo;
+
+    m_header.UpdateDict();
+    wxString header;
+    for (auto& e: m_header.GetAllHeaders())
+        header << e.Key << ": " << e.Value << '\n';
+    mo.AddMessage(false, std::string(), std::string(), false, std::string(), {encode(header)});
+
+    const unsigned pluralsCount = GetPluralFormsCount();
+    std::vector<std::string> translations;
+
+    for (auto& item: m_items)
+    {
+        // msgfmt doesn't include fuzzy and untranslated entries:
+        if (item->IsFuzzy() || item->GetTranslation().empty())
+            continue;
+
+        translations.clear();
+        if (item->HasPlural())
+        {
+            for (unsigned i = 0; i < pluralsCount; i++)
+                translations.push_back(encode(item->GetTranslation(i)));
+        }
+        else
+        {
+            translations.push_back(encode(item->GetTranslation()));
+        }
+
+        mo.AddMessage(item->HasContext(), encode(item->GetContext()),
+                      encode(item->GetRawString()),
+                      item->HasPlural(), encode(item->GetRawPluralString()),
+                      translations);
+    }
+
+    return mo.Write(mo_file);
 }
 
 void POCatalog::SetLanguage(Language lang)
@@ -1659,49 +1890,60 @@ bool POCatalog::FixDuplicateItems()
 }
 
 
-Catalog::ValidationResults POCatalog::Validate(const wxString& fileWithSameContent)
+void POCatalog::ValidateItems(const CatalogItemArray& items, const wxString& fileWithSameContent)
 {
-    ValidationResults res = Catalog::Validate(fileWithSameContent);
+    Catalog::ValidateItems(items, fileWithSameContent);
 
-    if (!HasCapability(Catalog::Cap::Translations))
-        return res;  // no errors in POT files
+    POValidator(*this).Check(items);
+
+    // Format strings not understood by POValidator still need to be checked by msgfmt:
+    auto needsMsgfmt = std::any_of(items.begin(), items.end(),
+                                   [](const CatalogItemPtr& i){ return POValidator::NeedsExternalCheck(*i); });
+    if (!needsMsgfmt)
+        return;
 
     if (!fileWithSameContent.empty())
     {
-        ValidateWithMsgfmt(res, fileWithSameContent);
+        ValidateWithMsgfmt(items, fileWithSameContent);
     }
     else
     {
         TempDirectory tmpdir;
         if ( !tmpdir.IsOk() )
-            return res;
+            return;
 
         wxString tmp_po = tmpdir.CreateFileName("validated.po");
         if ( !DoSaveOnly(tmp_po, wxTextFileType_Unix) )
-            return res;
+            return;
 
-        ValidateWithMsgfmt(res, tmp_po);
+        ValidateWithMsgfmt(items, tmp_po);
     }
+}
 
-    return res;
+void POCatalog::ValidateCatalogWide()
+{
+    POValidator(*this).CheckHeader(m_items);
 }
 
-void POCatalog::ValidateWithMsgfmt(Catalog::ValidationResults& res, const wxString& po_file)
+void POCatalog::ValidateWithMsgfmt(const CatalogItemArray& items, const wxString& po_file)
 {
     GettextRunner gtr;
     auto output = gtr.run_sync("msgfmt", "-o", "/dev/null", "-c", CliSafeFileName(po_file));
     auto errors = gtr.parse_stderr(output);
 
+    // only items being validated may be updated, the rest have cached results
+    std::set<CatalogItem*> checked;
+    for (auto& i: items)
+        checked.insert(i.get());
+
     for (auto& i: errors.items)
     {
         if (i.has_location())
         {
+            // other items were already checked by POValidator
             auto item = FindItemByLine(i.line);
-            if (item)
-            {
-                res.errors++;
+            if (item && checked.count(item.get()) && POValidator::NeedsExternalCheck(*item) && !item->HasError())
                 item->SetIssue(CatalogItem::Issue::Error, i.text);
-            }
         }
         // else: ignore msgfmt output w/o a location because msgfmt outputs status information
         //       (e.g. "N errors found") to stderr too
@@ -1723,13 +1965,13 @@ bool POCatalog::UpdateFromPOT(const wxString& pot_file, bool replace_header)
     }
 }
 
-bool POCatalog::UpdateFromPOT(POCatalogPtr pot, bool replace_header)
+bool POCatalog::UpdateFromPOT(POCatalogPtr pot, bool replace_header, MergeStats *stats)
 {
     switch (m_fileType)
     {
         case Type::PO:
         {
-            if (!Merge(pot))
+            if (!Merge(pot, stats))
                 return false;
             break;
         }
@@ -1762,51 +2004,740 @@ POCatalogPtr POCatalog::CreateFromPOT(POCatalogPtr pot)
         return nullptr;
 }
 
-bool POCatalog::Merge(const POCatalogPtr& refcat)
+POCatalogPtr POCatalog::Concatenate(const std::vector<POCatalogPtr>& catalogs)
 {
-    wxString oldname = m_fileName;
-    wxON_BLOCK_EXIT_SET(m_fileName, oldname);
+    POCatalogPtr c(new POCatalog(Type::POT));
+    if (catalogs.empty())
+    {
+        c->CreateNewHeader();
+        return c;
+    }
 
-    TempDirectory tmpdir;
-    if ( !tmpdir.IsOk() )
-        return false;
+    // Header: use the first one, but with the latest creation date and any
+    // headers missing from it taken from the other catalogs
+    c->m_header = catalogs.front()->m_header;
+    wxDateTime creationDate;
+    for (auto& cat: catalogs)
+    {
+        auto& hdr = cat->m_header;
+        if (c->m_header.Comment.empty())
+            c->m_header.Comment = hdr.Comment;
+
+        for (auto& e: hdr.GetAllHeaders())
+        {
+            if (!c->m_header.HasHeader(e.Key))
+                c->m_header.SetHeader(e.Key, e.Value);
+        }
+
+        wxDateTime date;
+        if (date.ParseFormat(hdr.CreationDate, "%Y-%m-%d %H:%M%z") && (!creationDate.IsValid() || date > creationDate))
+        {
+            creationDate = date;
+            c->m_header.SetHeader("POT-Creation-Date", hdr.CreationDate);
+        }
+    }
+    c->m_header.ParseDict();
+    // all catalogs were converted to Unicode when loading
+    c->m_header.Charset = "UTF-8";
 
-    wxString tmp1 = tmpdir.CreateFileName("ref.pot");
-    wxString tmp2 = tmpdir.CreateFileName("input.po");
-    wxString tmp3 = tmpdir.CreateFileName("output.po");
+    c->m_sourceLanguage = catalogs.front()->m_sourceLanguage;
+    c->m_fileWrappingWidth = catalogs.front()->m_fileWrappingWidth;
 
-    refcat->DoSaveOnly(tmp1, wxTextFileType_Unix);
-    DoSaveOnly(tmp2, wxTextFileType_Unix);
+    std::unordered_map<std::wstring, POCatalogItemPtr> seen;
+    std::vector<wxString> flags;
+    int id = 0;
 
-    std::vector<wxString> args { "msgmerge", "-q", "--force-po", "--previous" };
-    if (Config::MergeBehavior() == Merge_None)
+    for (auto& cat: catalogs)
     {
-        args.push_back("--no-fuzzy-matching");
+        for (auto& i: cat->m_items)
+        {
+            auto item = std::static_pointer_cast<POCatalogItem>(i);
+
+            // same key as in MO files: msgctxt EOT msgid
+            std::wstring key;
+            if (item->HasContext())
+            {
+                key = item->GetContext().ToStdWstring();
+                key += L'\x04';
+            }
+            key += item->GetRawString().ToStdWstring();
+
+            auto inserted = seen.emplace(std::move(key), item);
+            if (inserted.second)
+            {
+                item->SetId(++id);
+                c->m_items.push_back(item);
+                if (item->HasPlural())
+                    c->m_hasPluralItems = true;
+                continue;
+            }
+
+            // merge into the first occurrence, taking translation from it as --use-first does:
+            auto& first = inserted.first->second;
+
+            auto refs = first->GetReferences();
+            for (auto& r: item->GetReferences())
+            {
+                if (refs.Index(r) == wxNOT_FOUND)
+                    refs.push_back(r);
+            }
+            first->SetRawReferences(refs);
+
+            for (auto& comment: item->GetExtractedComments())
+            {
+                if (first->GetExtractedComments().Index(comment) == wxNOT_FOUND)
+                    first->AddExtractedComments(comment);
+            }
+
+            if (!item->GetFlags().empty())
+            {
+                flags.clear();
+                ParseFlags(first->GetFlags(), flags);
+                ParseFlags(item->GetFlags(), flags);
+                wxString merged;
+                for (auto& f: flags)
+                    merged << wxS(", ") << f;
+                first->SetFlags(merged);
+            }
+
+            if (first->GetComment().empty() && item->HasComment())
+                first->SetComment(item->GetComment());
+
+            if (!first->HasPlural() && item->HasPlural())
+            {
+                first->SetPluralString(item->GetRawPluralString());
+                first->SetTranslations(item->GetTranslations());
+                c->m_hasPluralItems = true;
+            }
+        }
     }
 
-    args.push_back("-o");
-    args.push_back(tmp3);
-    args.push_back(tmp2);
-    args.push_back(tmp1);
+    return c;
+}
 
-    GettextRunner runner;
-    auto output = runner.run_sync(args);
-    // FIXME: Don't do that here, report as part of return value instead
-    runner.parse_stderr(output).log_errors();
+namespace
+{
+
+// Minimal similarity of strings for fuzzy matching, same as msgmerge's
+const double FUZZY_THRESHOLD = 0.6;
 
-    if (output)
+// Maximum number of most promising candidates to compare in full
+const size_t MAX_FUZZY_CANDIDATES = 16;
+
+/// Key identifying a message, i.e. its context and msgid
+inline std::wstring MakeMergeKey(const CatalogItem& item)
+{
+    std::wstring key;
+    if (item.HasContext())
     {
-        const wxString charset = m_header.Charset;
+        key = item.GetContext().ToStdWstring();
+        key += L'\x04';
+    }
+    key += item.GetRawString().ToStdWstring();
+    return key;
+}
+
+/// Key identifying a message including its plural form, as MergeStats does
+inline std::wstring MakeFullMergeKey(const CatalogItem& item)
+{
+    auto key = MakeMergeKey(item);
+    key += L'\0';
+    key += item.GetRawPluralString().ToStdWstring();
+    return key;
+}
 
-        Load(tmp3);
-        m_fileName = oldname;
-        PostCreation();
+inline MergeStats::Key MakeStatsKey(const CatalogItem& item)
+{
+    return {item.GetRawString(), item.GetRawPluralString(), item.GetContext(), item.GetRawSymbolicId()};
+}
 
-        // msgmerge doesn't always preserve the charset, it tends to pick
-        // the most generic one of the charsets used, so if we are merging with
-        // UTF-8 catalog, it will become UTF-8. Some people hate this.
-        m_header.Charset = charset;
+inline bool HasAnyTranslation(const CatalogItem& item)
+{
+    for (auto& t: item.GetTranslations())
+    {
+        if (!t.empty())
+            return true;
+    }
+    return false;
+}
+
+// Similarity of two strings, computed the same way as gettext's fstrcmp(),
+// i.e. as 2*LCS/(len(a)+len(b)), using bit-parallel LCS algorithm.
+double StringSimilarity(const std::wstring& a, const std::wstring& b)
+{
+    if (a.empty() || b.empty())
+        return (a.empty() && b.empty()) ? 1.0 : 0.0;
+
+    const size_t words = (a.size() + 63) / 64;
+    std::unordered_map<wchar_t, std::vector<uint64_t>> masks;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        auto& m = masks[a[i]];
+        if (m.empty())
+            m.resize(words, 0);
+        m[i / 64] |= uint64_t(1) << (i % 64);
+    }
+
+    std::vector<uint64_t> v(words, ~uint64_t(0));
+    for (auto c: b)
+    {
+        auto found = masks.find(c);
+        if (found == masks.end())
+            continue;  // v doesn't change for characters not present in a
+        auto& m = found->second;
+        uint64_t carry = 0;
+        for (size_t w = 0; w < words; w++)
+        {
+            const uint64_t u = v[w] & m[w];
+            const uint64_t sum1 = v[w] + u;
+            const uint64_t sum2 = sum1 + carry;
+            carry = (sum1 < v[w]) || (sum2 < sum1);
+            v[w] = sum2 | (v[w] & ~m[w]);
+        }
+    }
+
+    size_t lcs = 0;
+    for (size_t w = 0; w < words; w++)
+    {
+        uint64_t bits = ~v[w];
+        if (w == words - 1 && a.size() % 64)
+            bits &= (uint64_t(1) << (a.size() % 64)) - 1;
+        lcs += std::bitset<64>(bits).count();
+    }
+
+    return 2.0 * lcs / (a.size() + b.size());
+}
+
+
+/// Returns sorted unique trigrams of @a str, including its start and end
+std::vector<uint64_t> GetTrigrams(const std::wstring& str)
+{
+    std::wstring padded;
+    padded.reserve(str.size() + 2);
+    padded += L'\x02';
+    padded += str;
+    padded += L'\x03';
+
+    std::vector<uint64_t> out;
+    out.reserve(padded.size());
+    for (size_t i = 0; i + 2 < padded.size(); i++)
+    {
+        out.push_back((uint64_t(padded[i] & 0x1FFFFF) << 42) |
+                      (uint64_t(padded[i+1] & 0x1FFFFF) << 21) |
+                       uint64_t(padded[i+2] & 0x1FFFFF));
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+
+/**
+    Finds the most similar translated message for fuzzy matching.
+
+    Like msgmerge, only messages with the same context are considered and
+    the one with the highest similarity above FUZZY_THRESHOLD is used.
+    To avoid comparing every pair of messages, candidates are found using an
+    index of their trigrams and only the most promising ones are compared.
+ */
+class FuzzyMatcher
+{
+public:
+    explicit FuzzyMatcher(const CatalogItemArray& items)
+    {
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            auto& item = *items[i];
+            if (!HasAnyTranslation(item))
+                continue;
+
+            const uint32_t id = (uint32_t)m_candidates.size();
+            m_candidates.push_back({i, item.GetContext().ToStdWstring(), item.GetRawString().ToStdWstring()});
+            for (auto g: GetTrigrams(m_candidates.back().msgid))
+                m_index[g].push_back(id);
+        }
+
+        // very common trigrams are poor discriminators and expensive to use
+        m_maxPostings = std::max<size_t>(1000, m_candidates.size() / 20);
+    }
+
+    /// Returns index of the best matching item or -1 if there's none
+    int FindBest(const CatalogItem& item) const
+    {
+        if (m_candidates.empty())
+            return -1;
+
+        const auto context = item.GetContext().ToStdWstring();
+        const auto msgid = item.GetRawString().ToStdWstring();
+
+        std::vector<const std::vector<uint32_t>*> postings;
+        for (auto g: GetTrigrams(msgid))
+        {
+            auto i = m_index.find(g);
+            if (i != m_index.end())
+                postings.push_back(&i->second);
+        }
+        if (postings.empty())
+            return -1;
+
+        std::sort(postings.begin(), postings.end(), [](auto a, auto b){ return a->size() < b->size(); });
+
+        std::unordered_map<uint32_t, uint32_t> shared;
+        for (auto p: postings)
+        {
+            // always use the rarest trigram, so that there are some candidates
+            if (p->size() > m_maxPostings && !shared.empty())
+                break;
+            for (auto c: *p)
+                shared[c]++;
+        }
+
+        std::vector<std::pair<uint32_t, uint32_t>> ranked;
+        ranked.reserve(shared.size());
+        for (auto& s: shared)
+        {
+            auto& c = m_candidates[s.first];
+            if (c.context != context)
+                continue;
+            // similarity can't exceed 2*min(len)/(len1+len2):
+            const size_t minLen = std::min(c.msgid.size(), msgid.size());
+            if (2.0 * minLen / (c.msgid.size() + msgid.size()) <= FUZZY_THRESHOLD)
+                continue;
+            ranked.emplace_back(s.second, s.first);
+        }
+
+        const size_t count = std::min(ranked.size(), MAX_FUZZY_CANDIDATES);
+        std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(), [](auto& a, auto& b)
+        {
+            return a.first > b.first || (a.first == b.first && a.second < b.second);
+        });
+
+        double bestSimilarity = FUZZY_THRESHOLD;
+        int best = -1;
+        for (size_t i = 0; i < count; i++)
+        {
+            auto& c = m_candidates[ranked[i].second];
+            const double similarity = StringSimilarity(c.msgid, msgid);
+            // prefer earlier message in case of ties, as msgmerge does:
+            if (similarity > bestSimilarity || (similarity == bestSimilarity && best != -1 && (int)c.index < best))
+            {
+                bestSimilarity = similarity;
+                best = (int)c.index;
+            }
+        }
+
+        return best;
+    }
+
+private:
+    struct Candidate
+    {
+        size_t index;
+        std::wstring context, msgid;
+    };
+
+    std::vector<Candidate> m_candidates;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> m_index;
+    size_t m_maxPostings;
+};
+
+
+/// Returns raw "#| " lines with source text of @a item
+wxArrayString MakePreviousMsgid(const CatalogItem& item)
+{
+    wxArrayString lines;
+    if (item.HasContext())
+        lines.push_back(wxS("msgctxt \"") + EscapeCString(item.GetContext()) + wxS("\""));
+    lines.push_back(wxS("msgid \"") + EscapeCString(item.GetRawString()) + wxS("\""));
+    if (item.HasPlural())
+        lines.push_back(wxS("msgid_plural \"") + EscapeCString(item.GetRawPluralString()) + wxS("\""));
+    return lines;
+}
+
+
+/// Items parsed from obsolete entries, see ParseObsoleteItems()
+struct ObsoleteItems
+{
+    CatalogItemArray items;
+    /// Range of obsolete entries (first, end) each item was parsed from
+    std::vector<std::pair<size_t, size_t>> origins;
+};
+
+/// Parses obsolete entries back into items, so that their translations can be reused
+ObsoleteItems ParseObsoleteItems(const POCatalogDeletedDataArray& deleted)
+{
+    ObsoleteItems out;
+    if (deleted.empty())
+        return out;
+
+    // Convert the entries into regular PO file content, remembering where
+    // each of them starts:
+    std::string data;
+    unsigned lineNumber = 1;
+    std::vector<unsigned> starts;
+    std::vector<std::pair<size_t, size_t>> ranges;
+
+    auto addLine = [&](const wxString& line)
+    {
+        data += line.utf8_string();
+        data += '\n';
+        lineNumber++;
+    };
+
+    for (size_t i = 0; i < deleted.size(); )
+    {
+        starts.push_back(lineNumber);
+        const size_t first = i;
+
+        // The parser splits obsolete entries in parts before every line
+        // starting with "#~ msgid" (including msgid_plural), so join the
+        // parts back until the entry has its translation:
+        bool hasMsgstr = false;
+        do
+        {
+            auto& d = deleted[i++];
+            SplitIntoLines(d.GetComment(), [&](wxString&& line, bool)
+            {
+                if (!line.empty())
+                    addLine(line);
+            });
+            if (!d.GetFlags().empty())
+                addLine(wxS("#") + d.GetFlags());
+
+            for (auto& line: d.GetDeletedLines())
+            {
+                if (!line.StartsWith(wxS("#~")))
+                    continue;
+                if (line.StartsWith(wxS("#~ msgstr")))
+                    hasMsgstr = true;
+                wxString rest = line.Mid(2);
+                if (rest.StartsWith(wxS("|")))
+                    addLine(wxS("#") + rest);
+                else
+                    addLine(rest.Trim(/*fromRight=*/false));
+            }
+        }
+        // parts with comments or flags are always separate entries:
+        while (!hasMsgstr && i < deleted.size() &&
+               deleted[i].GetComment().empty() && deleted[i].GetFlags().empty());
+
+        ranges.emplace_back(first, i);
+        addLine(wxString());
+    }
+
+    auto parsed = POCatalog::Create(Catalog::Type::PO);
+    {
+        wxLogNull null; // malformed obsolete entries are simply not reused
+        POLoadParser parser(*parsed, data);
+        if (!parser.Parse())
+            return out;
+    }
+
+    for (auto& item: parsed->items())
+    {
+        const auto pos = std::upper_bound(starts.begin(), starts.end(), (unsigned)item->GetLineNumber()) - starts.begin();
+        if (pos == 0)
+            continue;
+        out.items.push_back(item);
+        out.origins.push_back(ranges[pos - 1]);
+    }
+
+    return out;
+}
+
+} // anonymous namespace
+
+
+POCatalogItemPtr POCatalog::CreateMergedItem(const POCatalogItem& ref, const CatalogItem *old, bool exact, unsigned pluralsCount)
+{
+    if (!ref.HasPlural())
+        pluralsCount = 1;
+
+    auto item = std::make_shared<POCatalogItem>();
+    item->SetString(ref.GetRawString());
+    if (ref.HasPlural())
+        item->SetPluralString(ref.GetRawPluralString());
+    if (ref.HasContext())
+        item->SetContext(ref.GetContext());
+    item->SetRawReferences(ref.GetRawReferences());
+    for (auto& c: ref.GetExtractedComments())
+        item->AddExtractedComments(c);
+    // format flags etc. come from the source code, except for fuzziness:
+    item->SetFlags(ref.GetFlags());
+    item->SetFuzzy(false);
+
+    if (!old)
+    {
+        wxArrayString empty;
+        empty.Add(wxString(), pluralsCount);
+        item->SetTranslations(empty);
+        return item;
+    }
+
+    wxArrayString translations;
+    bool changed = !exact;
+    if (ref.HasPlural() && !old->HasPlural())
+    {
+        // use singular translation for all plural forms:
+        translations.Add(old->GetTranslation(), pluralsCount);
+        changed = true;
+    }
+    else if (!ref.HasPlural() && old->HasPlural())
+    {
+        translations.push_back(old->GetTranslation());
+        changed = true;
+    }
+    else
+    {
+        translations = old->GetTranslations();
+        if (ref.GetRawPluralString() != old->GetRawPluralString())
+            changed = true;
+    }
+
+    item->SetTranslations(translations);
+    item->SetComment(old->GetComment());
+
+    if (!HasAnyTranslation(*item))
+        return item;
+
+    if (changed)
+    {
+        item->SetFuzzy(true);
+        item->SetOldMsgid(MakePreviousMsgid(*old));
+    }
+    else
+    {
+        item->SetPreTranslated(old->IsPreTranslated());
+        if (old->IsFuzzy())
+        {
+            item->SetFuzzy(true);
+            item->SetOldMsgid(old->GetOldMsgidRaw());
+        }
+    }
+
+    return item;
+}
+
+
+POCatalogDeletedData POCatalog::CreateObsoleteItem(const CatalogItem& item, int wrappingWidth)
+{
+    std::vector<wxString> flags;
+    ParseFlags(item.GetFlags(), flags);
+    const bool wrap = std::find(flags.begin(), flags.end(), wxS("no-wrap")) == flags.end();
+    const auto format = POWriter::GetFormatSyntax(flags);
+
+    POWriter f(wxTextFileType_Unix, wrappingWidth);
+
+    std::vector<std::pair<wxString, wxString>> oldMsgid;
+    if (item.IsFuzzy() && ParsePreviousMsgid(item.GetOldMsgidRaw(), oldMsgid))
+    {
+        for (auto& old: oldMsgid)
+            f.AddString(old.first, old.second, wrap, POWriter::FormatSyntax::None, wxS("#~| "));
+    }
+
+    if (item.HasContext())
+        f.AddString(wxS("msgctxt"), item.GetContext(), wrap, POWriter::FormatSyntax::None, wxS("#~ "));
+    f.AddString(wxS("msgid"), item.GetRawString(), wrap, format, wxS("#~ "));
+    if (item.HasPlural())
+    {
+        f.AddString(wxS("msgid_plural"), item.GetRawPluralString(), wrap, format, wxS("#~ "));
+        for (unsigned i = 0; i < item.GetNumberOfTranslations(); i++)
+            f.AddString(wxString::Format(wxS("msgstr[%u]"), i), item.GetTranslation(i), wrap, format, wxS("#~ "));
+    }
+    else
+    {
+        f.AddString(wxS("msgstr"), item.GetTranslation(), wrap, format, wxS("#~ "));
+    }
+
+    wxArrayString lines;
+    SplitIntoLines(f.GetText(), [&](wxString&& line, bool)
+    {
+        if (!line.empty())
+            lines.push_back(line);
+    });
+
+    POCatalogDeletedData d(lines);
+    d.SetComment(item.GetComment());
+    if (item.IsFuzzy())
+        d.SetFlags(wxS(", fuzzy"));
+    return d;
+}
+
+
+bool POCatalog::Merge(const POCatalogPtr& refcat, MergeStats *stats)
+{
+    const bool fuzzyMatching = Config::MergeBehavior() != Merge_None;
+    const unsigned pluralsCount = GetPluralFormsCount();
+
+    auto& refItems = refcat->m_items;
+
+    // Like msgmerge, translations of obsolete messages are reused too, but
+    // only if there's no match among current ones. They follow current
+    // messages in the candidates array.
+    auto obsoleteItems = ParseObsoleteItems(m_deletedItems);
+    CatalogItemArray candidates(m_items);
+    candidates.insert(candidates.end(), obsoleteItems.items.begin(), obsoleteItems.items.end());
+    const int currentCount = (int)m_items.size();
+    auto isObsolete = [currentCount](int i){ return i >= currentCount; };
+
+    // Existing messages, for exact matching; current ones take precedence:
+    std::unordered_map<std::wstring, size_t> existing;
+    existing.reserve(candidates.size());
+    for (size_t i = 0; i < candidates.size(); i++)
+    {
+        if (isObsolete((int)i) && !HasAnyTranslation(*candidates[i]))
+            continue;
+        existing.emplace(MakeMergeKey(*candidates[i]), i);
+    }
+
+    std::vector<bool> used(candidates.size(), false);
+    std::vector<int> matches(refItems.size(), -1);
+    std::vector<size_t> unmatched;
+
+    // Messages present in both catalogs with the same plural form, for MergeStats:
+    std::unordered_set<std::wstring> kept;
+    if (stats)
+    {
+        stats->added.clear();
+        stats->removed.clear();
     }
 
-    return (bool)output;
+    for (size_t i = 0; i < refItems.size(); i++)
+    {
+        auto& ref = *refItems[i];
+        auto found = existing.find(MakeMergeKey(ref));
+        if (found != existing.end())
+        {
+            matches[i] = (int)found->second;
+            used[found->second] = true;
+
+            if (stats)
+            {
+                if (!isObsolete(matches[i]) && ref.GetRawPluralString() == m_items[found->second]->GetRawPluralString())
+                    kept.insert(MakeFullMergeKey(ref));
+                else
+                    stats->added.push_back(MakeStatsKey(ref));
+            }
+        }
+        else
+        {
+            unmatched.push_back(i);
+            if (stats)
+                stats->added.push_back(MakeStatsKey(ref));
+        }
+    }
+
+    std::vector<int> fuzzyMatches(unmatched.size(), -1);
+    if (fuzzyMatching && !unmatched.empty())
+    {
+        FuzzyMatcher matcher(m_items);
+        std::unique_ptr<FuzzyMatcher> obsoleteMatcher;
+        if (!obsoleteItems.items.empty())
+            obsoleteMatcher.reset(new FuzzyMatcher(obsoleteItems.items));
+
+        dispatch::parallel_for(unmatched.size(), [&](size_t i)
+        {
+            auto& ref = *refItems[unmatched[i]];
+            fuzzyMatches[i] = matcher.FindBest(ref);
+            if (fuzzyMatches[i] == -1 && obsoleteMatcher)
+            {
+                const int best = obsoleteMatcher->FindBest(ref);
+                if (best != -1)
+                    fuzzyMatches[i] = currentCount + best;
+            }
+        }, /*chunkSize=*/16);
+
+        for (auto m: fuzzyMatches)
+        {
+            if (m != -1)
+                used[m] = true;
+        }
+    }
+
+    CatalogItemArray merged;
+    merged.reserve(refItems.size());
+    int revived = 0;
+    {
+        size_t nextUnmatched = 0;
+        for (size_t i = 0; i < refItems.size(); i++)
+        {
+            auto& ref = static_cast<const POCatalogItem&>(*refItems[i]);
+            POCatalogItemPtr item;
+            int old;
+            if (matches[i] != -1)
+            {
+                old = matches[i];
+                item = CreateMergedItem(ref, candidates[old].get(), /*exact=*/true, pluralsCount);
+            }
+            else
+            {
+                old = fuzzyMatches[nextUnmatched++];
+                item = CreateMergedItem(ref, old != -1 ? candidates[old].get() : nullptr, /*exact=*/false, pluralsCount);
+            }
+            // revived obsolete translations need review, as in msgmerge:
+            if (old != -1 && isObsolete(old) && HasAnyTranslation(*item))
+            {
+                item->SetFuzzy(true);
+                revived++;
+            }
+            item->SetId(int(merged.size() + 1));
+            merged.push_back(item);
+        }
+    }
+
+    // Messages that are no longer used become obsolete, unless they were
+    // never translated. They are put in front of previously obsolete ones,
+    // which are kept unless they were reused.
+    const int wrappingWidth = GetOutputWrappingWidth(m_fileWrappingWidth);
+    POCatalogDeletedDataArray obsolete;
+    for (size_t i = 0; i < m_items.size(); i++)
+    {
+        auto& item = *m_items[i];
+        if (stats && kept.find(MakeFullMergeKey(item)) == kept.end())
+            stats->removed.push_back(MakeStatsKey(item));
+        if (!used[i] && HasAnyTranslation(item))
+            obsolete.push_back(CreateObsoleteItem(item, wrappingWidth));
+    }
+    const int obsoleted = (int)obsolete.size();
+
+    std::vector<bool> reused(m_deletedItems.size(), false);
+    for (size_t i = 0; i < obsoleteItems.items.size(); i++)
+    {
+        if (!used[currentCount + i])
+            continue;
+        auto& origin = obsoleteItems.origins[i];
+        std::fill(reused.begin() + origin.first, reused.begin() + origin.second, true);
+    }
+    for (size_t i = 0; i < m_deletedItems.size(); i++)
+    {
+        if (!reused[i])
+            obsolete.push_back(m_deletedItems[i]);
+    }
+    m_deletedItems = std::move(obsolete);
+
+    m_items = std::move(merged);
+    m_hasPluralItems = std::any_of(m_items.begin(), m_items.end(), [](auto& i){ return i->HasPlural(); });
+
+    // like msgmerge, take creation date from the reference:
+    if (!refcat->m_header.CreationDate.empty())
+        m_header.CreationDate = refcat->m_header.CreationDate;
+
+    if (stats)
+    {
+        // keep the same order as ComputeMergeStats() would:
+        for (auto list: {&stats->added, &stats->removed})
+        {
+            std::sort(list->begin(), list->end());
+            list->erase(std::unique(list->begin(), list->end(),
+                                    [](auto& a, auto& b){ return !(a < b) && !(b < a); }),
+                        list->end());
+        }
+    }
+
+    wxLogTrace("poedit", "merged %d messages with %d reference ones: %d fuzzy matched, %d revived, %d obsoleted",
+               currentCount, (int)refItems.size(),
+               (int)std::count_if(fuzzyMatches.begin(), fuzzyMatches.end(), [](int m){ return m != -1; }),
+               revived, obsoleted);
+
+    return true;
 }
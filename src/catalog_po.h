@@ -28,8 +28,12 @@
 
 #include "catalog.h"
 
+#include <string>
+#include <string_view>
+
 class POCatalogItem;
 class POCatalog;
+struct MergeStats;
 typedef std::shared_ptr<POCatalogItem> POCatalogItemPtr;
 typedef std::shared_ptr<POCatalog> POCatalogPtr;
 
@@ -189,8 +193,6 @@ public:
 
     std::string SaveToBuffer() override;
 
-    ValidationResults Validate(const wxString& fileWithSameContent) override;
-
     /// Compiles the catalog into binary MO file.
     bool CompileToMO(const wxString& mo_file,
                      ValidationResults& validation_results,
@@ -215,11 +217,29 @@ public:
     void RemoveDeletedItems() override
         { m_deletedItems.clear(); }
 
-    /// Updates the catalog from POT file.
+    /**
+        Updates the catalog from POT file.
+
+        If @a stats is provided, it is filled with information about added
+        and removed strings.
+     */
     bool UpdateFromPOT(const wxString& pot_file, bool replace_header = false);
-    bool UpdateFromPOT(POCatalogPtr pot, bool replace_header = false);
+    bool UpdateFromPOT(POCatalogPtr pot, bool replace_header = false, MergeStats *stats = nullptr);
     static POCatalogPtr CreateFromPOT(POCatalogPtr pot);
 
+    /**
+        Concatenates POT @a catalogs into a new one, like `msgcat --use-first`.
+
+        Messages are ordered by their first appearance and duplicates (with
+        the same context and msgid) are merged into the first occurrence,
+        combining their references, extracted comments and flags. The header
+        is taken from the first catalog, with POT-Creation-Date set to the
+        latest one.
+
+        Note that items are shared with, and merged items modified in, @a catalogs.
+     */
+    static POCatalogPtr Concatenate(const std::vector<POCatalogPtr>& catalogs);
+
 protected:
     /** Loads catalog from .po file.
         If file named po_file ".poedit" (e.g. "cs.po.poedit") exists,
@@ -248,19 +268,36 @@ protected:
     /// Fix commonly encountered fixable problems with loaded files
     void FixupCommonIssues();
 
-    void ValidateWithMsgfmt(ValidationResults& res, const wxString& po_file);
+    void ValidateItems(const CatalogItemArray& items, const wxString& fileWithSameContent) override;
+    void ValidateCatalogWide() override;
+
+    /// Checks those of @a items that POValidator can't check fully by running msgfmt on @a po_file.
+    void ValidateWithMsgfmt(const CatalogItemArray& items, const wxString& po_file);
     bool DoSaveOnly(const wxString& po_file, wxTextFileType crlf);
-    bool DoSaveOnly(wxTextBuffer& f, wxTextFileType crlf);
+    bool DoSaveOnly(std::string& output, wxTextFileType crlf, bool *needsMsgcat = nullptr);
+
+    /// Writes MO file compiled from current content, as msgfmt would.
+    bool DoCompileMO(const wxString& mo_file);
 
     /** Merges the catalog with reference catalog
         (in the sense of msgmerge -- this catalog is old one with
         translations, \a refcat is reference catalog created by Update().)
 
+        The merge is done in memory, following the semantics of msgmerge
+        --previous. If @a stats is provided, it is filled with information
+        about added and removed strings.
+
         \return true if the merge was successful, false otherwise.
                 Note that if it returns false, the catalog was
                 \em not modified!
      */
-    bool Merge(const POCatalogPtr& refcat);
+    bool Merge(const POCatalogPtr& refcat, MergeStats *stats = nullptr);
+
+    /// Creates merged item for @a ref, with translation taken from @a old (if not null).
+    static POCatalogItemPtr CreateMergedItem(const POCatalogItem& ref, const CatalogItem *old, bool exact, unsigned pluralsCount);
+
+    /// Creates obsolete ("#~") entry from @a item.
+    static POCatalogDeletedData CreateObsoleteItem(const CatalogItem& item, int wrappingWidth);
 
 protected:
     POCatalogDeletedDataArray m_deletedItems;
@@ -278,8 +315,19 @@ protected:
 class POCatalogParser
 {
 public:
-    POCatalogParser(wxTextFile *f)
-        : m_textFile(f),
+    /**
+        Creates parser for PO file content in @a data.
+
+        The data is expected to be in UTF-8, which is what POCatalog::Load()
+        converts files to. The only exception is charset detection, which
+        looks just at the header and can pass a different @a conv to read
+        data of unknown encoding. The parser doesn't copy @a data.
+     */
+    POCatalogParser(std::string_view data, const wxMBConv *conv = nullptr)
+        : m_data(data),
+          m_pos(0),
+          m_lineNumber(0),
+          m_conv(conv),
           m_detectedLineWidth(0),
           m_detectedWrappedLines(false),
           m_lastLineHardWrapped(true), m_previousLineHardWrapped(true),
@@ -304,9 +352,13 @@ public:
 
     int GetWrappingWidth() const;
 
+    /// Returns line endings type used in the parsed part of the file.
+    wxTextFileType GetLineEndingsType() const;
+
 protected:
-    // Read one line from file, remove all \r and \n characters, ignore empty lines:
-    wxString ReadTextLine();
+    // Read one line from data, without line endings and surrounding whitespace;
+    // empty lines are skipped and empty return value means end of data:
+    std::string_view ReadTextLine();
 
     void PossibleWrappedLine()
     {
@@ -314,6 +366,10 @@ protected:
             m_detectedWrappedLines = true;
     }
 
+    // Converts parsed text to wxString:
+    wxString ToString(std::string_view s) const;
+    wxArrayString ToArrayString(const std::vector<std::string>& a) const;
+
     /** Called when new entry was parsed. Parsing continues
         if returned value is true and is cancelled if it
         is false.
@@ -347,8 +403,17 @@ protected:
 
     virtual void OnIgnoredEntry() {}
 
-    /// Textfile being parsed.
-    wxTextFile *m_textFile;
+    /// Data being parsed and current position in it.
+    std::string_view m_data;
+    size_t m_pos;
+    /// 1-based number of the line last returned by ReadTextLine().
+    unsigned m_lineNumber;
+    /// Conversion to use for the data; UTF-8 if nullptr.
+    const wxMBConv *m_conv;
+
+    /// Line endings seen so far, used to detect file's format.
+    size_t m_endingsUnix = 0, m_endingsDos = 0, m_endingsMac = 0;
+
     int m_detectedLineWidth;
     bool m_detectedWrappedLines;
     bool m_lastLineHardWrapped, m_previousLineHardWrapped;
@@ -71,9 +71,15 @@
     #endif
 #endif
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <memory>
 #include <mutex>
+#include <thread>
 #include <type_traits>
 
 #include <wx/app.h>
@@ -653,6 +659,81 @@ inline auto on_main(F&& f) -> future<typename detail::future_unwrapper<typename
 
 
 
+/**
+    Calls @a f(i) for every i in [0, count) in parallel and waits for all
+    calls to finish.
+
+    The work is split into chunks of @a chunkSize consecutive indices that are
+    picked up by background threads as well as by the calling thread itself,
+    so it is safe to call this function from a background task, too.
+
+    If any call throws, the first exception is rethrown in the calling thread
+    after the other chunks completed.
+ */
+template<typename F>
+void parallel_for(size_t count, F&& f, size_t chunkSize = 64)
+{
+    const size_t chunks = (count + chunkSize - 1) / chunkSize;
+    if (chunks <= 1)
+    {
+        for (size_t i = 0; i < count; i++)
+            f(i);
+        return;
+    }
+
+    struct state
+    {
+        std::atomic<size_t> next{0};
+        std::mutex mutex;
+        std::condition_variable cv;
+        size_t done = 0;
+        std::exception_ptr error;
+    };
+    auto st = std::make_shared<state>();
+
+    // Note that helper tasks may start running only after this function
+    // returned; they won't touch f then, because all chunks were taken.
+    auto process = [st, chunks, count, chunkSize, &f]
+    {
+        for (;;)
+        {
+            const size_t chunk = st->next.fetch_add(1);
+            if (chunk >= chunks)
+                return;
+
+            std::exception_ptr error;
+            try
+            {
+                const size_t end = std::min(count, (chunk + 1) * chunkSize);
+                for (size_t i = chunk * chunkSize; i < end; i++)
+                    f(i);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(st->mutex);
+            if (error && !st->error)
+                st->error = error;
+            if (++st->done == chunks)
+                st->cv.notify_all();
+        }
+    };
+
+    const size_t helpers = std::min<size_t>(chunks, std::max(2u, std::thread::hardware_concurrency())) - 1;
+    for (size_t i = 0; i < helpers; i++)
+        detail::background_queue_executor::get().submit(process);
+
+    process();
+
+    std::unique_lock<std::mutex> lock(st->mutex);
+    st->cv.wait(lock, [&st, chunks]{ return st->done == chunks; });
+    if (st->error)
+        std::rethrow_exception(st->error);
+}
+
+
 /// Helper exception for when the task was cancelled via cancellation_token
 class cancellation_exception : public std::exception
 {
@@ -692,6 +773,103 @@ private:
 typedef std::shared_ptr<cancellation_token> cancellation_token_ptr;
 
 
+/**
+    Passes results of work split into numbered batches from a bounded number
+    of worker tasks to a single consumer.
+
+    Workers pick batches to process in order and are blocked if too many
+    results weren't consumed yet, so that they don't run ahead of the consumer
+    and memory use doesn't grow with the total amount of work.
+ */
+template<typename T>
+class bounded_pipeline
+{
+public:
+    bounded_pipeline(size_t batchesCount, size_t maxPending)
+        : m_batchesCount(batchesCount), m_maxPending(maxPending)
+    {}
+
+    /// Returns index of the next batch to process or false if there's none
+    bool next_batch(size_t& batch)
+    {
+        batch = m_nextBatch.fetch_add(1);
+        return batch < m_batchesCount && !is_stopped();
+    }
+
+    /// Called by workers; returns false if the pipeline was stopped
+    bool push(T&& results)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this]{ return m_stopped || m_completed.size() < m_maxPending; });
+        if (m_stopped)
+            return false;
+        m_completed.push_back(std::move(results));
+        m_cv.notify_all();
+        return true;
+    }
+
+    /**
+        Waits for results of another batch, in order of completion.
+
+        Returns false if cancelled, rethrows workers' exceptions.
+     */
+    bool pop(T& results, const cancellation_token& cancellationToken)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            // cancellation_token can't notify us, so poll it periodically
+            if (cancellationToken.is_cancelled())
+                return false;
+            if (m_cv.wait_for(lock, std::chrono::milliseconds(100), [this]{ return m_stopped || !m_completed.empty(); }))
+                break;
+        }
+        if (m_error)
+            std::rethrow_exception(m_error);
+        if (m_completed.empty())
+            return false;
+        results = std::move(m_completed.front());
+        m_completed.pop_front();
+        m_cv.notify_all();
+        return true;
+    }
+
+    /// Stops the pipeline on error, pop() will rethrow the exception
+    void fail(std::exception_ptr e)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_error)
+            m_error = e;
+        m_stopped = true;
+        m_cv.notify_all();
+    }
+
+    /// Tells workers to finish, e.g. because the consumer was cancelled
+    void stop()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopped = true;
+        m_cv.notify_all();
+    }
+
+private:
+    bool is_stopped()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stopped;
+    }
+
+    const size_t m_batchesCount, m_maxPending;
+    std::atomic<size_t> m_nextBatch{0};
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<T> m_completed;
+    bool m_stopped = false;
+    std::exception_ptr m_error;
+};
+
+
 
 
 
@@ -70,6 +70,15 @@ public:
     static bool ShowWarnings() { return Read("/show_warnings", true); }
     static void ShowWarnings(bool show) { Write("/show_warnings", show); }
 
+    /// Whether TM index segments are merged in background threads (no UI)
+    static bool TMConcurrentMerges() { return Read("/tm_concurrent_merges", true); }
+    /// Max. time, in seconds, TM changes are kept uncommitted after saving a file (no UI)
+    static long TMCommitDelay() { return Read("/tm_commit_delay", (long)5); }
+
+    /// Version of TM documents' format that all documents were upgraded to
+    static long TMFormatVersion() { return Read("/tm_format_version", (long)0); }
+    static void TMFormatVersion(long version) { Write("/tm_format_version", version); }
+
     static std::string CloudLastProject() { return Read("/cloud_last_project", std::string()); }
     static void CloudLastProject(const std::string& prj) { return Write("/cloud_last_project", prj); }
 
@@ -2698,9 +2698,10 @@ void PoeditFrame::WriteCatalog(const wxString& catalog, TFunctor completionHandl
         tmUpdateThread = dispatch::async([=]{
             try
             {
-                // Commit pending writes made in OnNewTranslationEntered():
+                // Commit pending writes made in OnNewTranslationEntered(). This
+                // is done in the background, so that saving isn't slowed down:
                 auto tm = TranslationMemory::Get().GetWriter();
-                tm->Commit();
+                tm->ScheduleCommit();
             }
             catch ( const Exception& e )
             {
@@ -0,0 +1,858 @@
+/*
+ *  This file is part of Poedit (https://poedit.net)
+ *
+ *  Copyright (C) 2025 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "extraction_cache.h"
+
+#include "edapp.h"
+#include "version.h"
+
+#include <wx/file.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+#include <wx/log.h>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+
+namespace
+{
+
+// First line of cache files, changed whenever the format changes
+const char CACHE_FILE_SIGNATURE[] = "# Poedit extraction cache, version 1";
+
+// Unicode isolation marks used by xgettext around file names with spaces
+const char FSI[] = "\xE2\x81\xA8";
+const char PDI[] = "\xE2\x81\xA9";
+
+
+typedef uint64_t Hash;
+
+// 64-bit FNV-1a hash, only used to detect changes, not for security
+class Hasher
+{
+public:
+    void Update(const void *data, size_t size)
+    {
+        auto bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            m_value ^= bytes[i];
+            m_value *= 0x100000001b3ULL;
+        }
+    }
+
+    void Update(const wxString& s)
+    {
+        auto utf8 = s.utf8_string();
+        Update(utf8.data(), utf8.size() + 1); // including separating NUL
+    }
+
+    Hash Value() const { return m_value; }
+
+private:
+    Hash m_value = 0xcbf29ce484222325ULL;
+};
+
+
+inline bool starts_with(std::string_view s, std::string_view prefix)
+{
+    return s.substr(0, prefix.size()) == prefix;
+}
+
+bool read_file(const wxString& path, std::string& data)
+{
+    wxLogNull null;
+    wxFile f;
+    if (!f.Open(path))
+        return false;
+    const wxFileOffset len = f.Length();
+    if (len < 0)
+        return false;
+    data.resize(size_t(len));
+    return len == 0 || f.Read(&data[0], size_t(len)) == len;
+}
+
+bool write_file(const wxString& path, const std::string& data)
+{
+    wxFile f;
+    if (!f.Create(path, /*overwrite=*/true))
+        return false;
+    return f.Write(data.data(), data.size()) && f.Close();
+}
+
+Hash hash_file(const wxString& path)
+{
+    std::string data;
+    if (!read_file(path, data))
+        return 0;
+    Hasher h;
+    h.Update(data.data(), data.size());
+    return h.Value();
+}
+
+
+// Entry of a POT file, kept as raw text lines. Only the parts that need to be
+// combined when the same string is extracted from several files are parsed.
+struct PotEntry
+{
+    std::string key;                      // msgctxt and msgid lines
+    std::vector<std::string> comments;    // extracted comments ("#." lines)
+    std::vector<std::string> references;  // individual references ("file:line")
+    std::vector<std::string> flags;       // individual flags from "#," lines
+    std::vector<std::string> body;        // all other lines, i.e. the strings
+    bool hasPlural = false;
+};
+
+typedef std::vector<PotEntry> PotEntries;
+
+
+// Splits content of "#:" line into individual references. File names with
+// spaces are enclosed in isolation marks by xgettext, they are kept together.
+void split_references(std::string_view line, std::vector<std::string>& out)
+{
+    std::string ref;
+    size_t start = 0;
+    while (start < line.size())
+    {
+        size_t end = line.find(' ', start);
+        if (end == std::string_view::npos)
+            end = line.size();
+        auto token = line.substr(start, end - start);
+        start = end + 1;
+
+        if (ref.empty())
+        {
+            if (token.empty())
+                continue;
+        }
+        else
+        {
+            ref += ' ';
+        }
+        ref += token;
+
+        if (ref.find(FSI) != std::string::npos && ref.find(PDI) == std::string::npos)
+            continue; // inside file name with spaces
+
+        out.push_back(std::move(ref));
+        ref.clear();
+    }
+
+    if (!ref.empty())
+        out.push_back(std::move(ref));
+}
+
+void split_flags(std::string_view line, std::vector<std::string>& out)
+{
+    size_t start = 0;
+    while (start < line.size())
+    {
+        size_t end = line.find(',', start);
+        if (end == std::string_view::npos)
+            end = line.size();
+        auto flag = line.substr(start, end - start);
+        start = end + 1;
+
+        while (!flag.empty() && flag.front() == ' ')
+            flag.remove_prefix(1);
+        while (!flag.empty() && flag.back() == ' ')
+            flag.remove_suffix(1);
+        if (!flag.empty())
+            out.emplace_back(flag);
+    }
+}
+
+// Returns the file part of "file:line" reference
+std::string reference_file(const std::string& ref)
+{
+    std::string file;
+    file.reserve(ref.size());
+    for (size_t i = 0; i < ref.size(); )
+    {
+        if (ref.compare(i, sizeof(FSI) - 1, FSI) == 0 || ref.compare(i, sizeof(PDI) - 1, PDI) == 0)
+        {
+            i += sizeof(FSI) - 1;
+            continue;
+        }
+        file += ref[i++];
+    }
+
+    auto colon = file.rfind(':');
+    if (colon != std::string::npos && colon + 1 < file.size() &&
+        std::all_of(file.begin() + colon + 1, file.end(), [](char c){ return c >= '0' && c <= '9'; }))
+    {
+        file.resize(colon);
+    }
+    return file;
+}
+
+// Parses content of a POT file into entries. The header is not included,
+// only its charset is returned in @a charset, if not null.
+PotEntries parse_pot(std::string_view data, std::string *charset = nullptr)
+{
+    PotEntries entries;
+    PotEntry e;
+    bool hasMsg = false, inKey = false, seenMsgstr = false;
+
+    auto finish = [&]
+    {
+        if (hasMsg)
+        {
+            if (e.key == "msgid \"\"\n")
+            {
+                if (charset)
+                {
+                    std::string header;
+                    for (auto& line: e.body)
+                        header += line;
+                    auto pos = header.find("charset=");
+                    if (pos != std::string::npos)
+                    {
+                        pos += 8;
+                        auto end = header.find_first_of("\\\"; ", pos);
+                        *charset = header.substr(pos, end == std::string::npos ? end : end - pos);
+                    }
+                }
+            }
+            else
+            {
+                entries.push_back(std::move(e));
+            }
+        }
+        e = PotEntry();
+        hasMsg = inKey = seenMsgstr = false;
+    };
+
+    size_t pos = 0;
+    while (pos < data.size())
+    {
+        size_t eol = data.find('\n', pos);
+        if (eol == std::string_view::npos)
+            eol = data.size();
+        auto line = data.substr(pos, eol - pos);
+        pos = eol + 1;
+
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        if (line.empty())
+        {
+            finish();
+            continue;
+        }
+
+        // comments always start a new entry, even without separating blank line
+        if (line[0] == '#' && hasMsg)
+            finish();
+
+        if (starts_with(line, "#."))
+        {
+            e.comments.emplace_back(line);
+        }
+        else if (starts_with(line, "#:"))
+        {
+            split_references(line.substr(2), e.references);
+        }
+        else if (starts_with(line, "#,"))
+        {
+            split_flags(line.substr(2), e.flags);
+        }
+        else
+        {
+            if (starts_with(line, "msgctxt") || starts_with(line, "msgid "))
+            {
+                if (seenMsgstr)
+                    finish();
+                hasMsg = inKey = true;
+            }
+            else if (starts_with(line, "msgid_plural"))
+            {
+                e.hasPlural = true;
+                inKey = false;
+            }
+            else if (starts_with(line, "msgstr"))
+            {
+                seenMsgstr = true;
+                inKey = false;
+            }
+
+            if (inKey)
+            {
+                e.key += line;
+                e.key += '\n';
+            }
+            e.body.emplace_back(line);
+        }
+    }
+
+    finish();
+    return entries;
+}
+
+
+void write_entry(std::string& out, const PotEntry& e)
+{
+    for (auto& c: e.comments)
+    {
+        out += c;
+        out += '\n';
+    }
+
+    if (!e.references.empty())
+    {
+        out += "#:";
+        for (auto& r: e.references)
+        {
+            out += ' ';
+            out += r;
+        }
+        out += '\n';
+    }
+
+    if (!e.flags.empty())
+    {
+        out += "#,";
+        for (size_t i = 0; i < e.flags.size(); i++)
+        {
+            out += i ? ", " : " ";
+            out += e.flags[i];
+        }
+        out += '\n';
+    }
+
+    for (auto& line: e.body)
+    {
+        out += line;
+        out += '\n';
+    }
+
+    out += '\n';
+}
+
+
+void append_unique(std::vector<std::string>& into, const std::vector<std::string>& items)
+{
+    for (auto& i: items)
+    {
+        if (std::find(into.begin(), into.end(), i) == into.end())
+            into.push_back(i);
+    }
+}
+
+// Merges another occurrence of the same string into @a into, as xgettext does
+void merge_entry(PotEntry& into, const PotEntry& e)
+{
+    append_unique(into.comments, e.comments);
+    append_unique(into.references, e.references);
+    append_unique(into.flags, e.flags);
+
+    if (!into.hasPlural && e.hasPlural)
+    {
+        into.body = e.body;
+        into.hasPlural = true;
+    }
+}
+
+
+struct FileStat
+{
+    wxFileOffset size = -1;
+    time_t mtime = 0;
+};
+
+bool get_file_stat(const wxString& path, FileStat& st)
+{
+    wxStructStat s;
+    if (wxStat(path, &s) != 0)
+        return false;
+    st.size = s.st_size;
+    st.mtime = s.st_mtime;
+    return true;
+}
+
+} // anonymous namespace
+
+
+class ExtractionCache::impl
+{
+public:
+    impl(const SourceCodeSpec& sourceSpec, const Extractor::ExtractorsList& extractors)
+        : m_basePath(sourceSpec.BasePath), m_usable(true)
+    {
+        // Everything that affects extraction, except for the files themselves:
+        Hasher config;
+        config.Update(POEDIT_VERSION);
+        config.Update(sourceSpec.BasePath);
+        config.Update(sourceSpec.Charset);
+        for (auto& k: sourceSpec.Keywords)
+            config.Update(k);
+        for (auto& m: sourceSpec.TypeMapping)
+        {
+            config.Update(m.first);
+            config.Update(m.second);
+        }
+        for (auto& h: sourceSpec.XHeaders)
+        {
+            config.Update(h.first);
+            config.Update(h.second);
+        }
+        for (auto& ex: extractors)
+            config.Update(ex->GetConfigurationKey());
+
+        m_filename = PoeditApp::GetCacheDir("Extraction") + wxFILE_SEP_PATH +
+                     wxString::Format("%016llx.cache", (unsigned long long)config.Value());
+
+        Load();
+    }
+
+    bool IsUsable() const { return m_usable; }
+
+    bool Lookup(const wxString& file, const Extractor& extractor)
+    {
+        const wxString path = m_basePath + file;
+        FileStat st;
+        if (!get_file_stat(path, st))
+            return false;
+
+        auto i = m_files.find(file);
+        if (i == m_files.end() || i->second.extractor != extractor.GetId())
+        {
+            m_pending[file] = st;
+            return false;
+        }
+
+        auto& r = i->second;
+        if (r.stat.size == st.size && r.stat.mtime == st.mtime)
+            return true;
+
+        // touched, but not necessarily modified, e.g. by VCS operations:
+        if (r.stat.size == st.size && r.hash != 0 && hash_file(path) == r.hash)
+        {
+            r.stat.mtime = st.mtime;
+            return true;
+        }
+
+        m_pending[file] = st;
+        return false;
+    }
+
+    void AddAffectedFiles(const Extractor::FilesList& files, const Extractor& extractor, Extractor::FilesList& changed)
+    {
+        // Strings from files that changed or were removed, whose metadata may
+        // have been copied into other files' parts (see Store()):
+        std::unordered_set<std::string> keys;
+        auto collectKeys = [&keys](const FileRecord& r)
+        {
+            for (auto& e: r.entries)
+            {
+                if (!e.comments.empty() || !e.flags.empty() || e.hasPlural)
+                    keys.insert(e.key);
+            }
+        };
+
+        // Note that this only works because the lists are sorted:
+        for (auto& i: m_files)
+        {
+            if (i.second.extractor != extractor.GetId())
+                continue;
+            if (std::binary_search(changed.begin(), changed.end(), i.first) ||
+                !std::binary_search(files.begin(), files.end(), i.first))
+            {
+                collectKeys(i.second);
+            }
+        }
+
+        if (keys.empty())
+            return;
+
+        Extractor::FilesList affected;
+        for (auto& f: files)
+        {
+            if (std::binary_search(changed.begin(), changed.end(), f))
+                continue;
+            auto i = m_files.find(f);
+            if (i == m_files.end())
+                continue;
+            auto& entries = i->second.entries;
+            if (std::any_of(entries.begin(), entries.end(), [&keys](const PotEntry& e){ return keys.count(e.key) != 0; }))
+            {
+                affected.push_back(f);
+                // Lookup() found the file unchanged, i.e. with this stat:
+                m_pending[f] = i->second.stat;
+            }
+        }
+
+        if (affected.empty())
+            return;
+
+        wxLogTrace("poedit.extractor", " .. %d unchanged files share strings with changed ones", (int)affected.size());
+
+        Extractor::FilesList merged;
+        merged.reserve(changed.size() + affected.size());
+        std::merge(changed.begin(), changed.end(), affected.begin(), affected.end(), std::back_inserter(merged));
+        std::swap(changed, merged);
+    }
+
+    bool Store(const ExtractionOutput& output, const Extractor::FilesList& files, const Extractor& extractor)
+    {
+        if (!m_usable)
+            return false;
+
+        PotEntries entries;
+        if (output)
+        {
+            std::string data, charset;
+            if (!read_file(output.pot_file, data))
+                return MarkUnusable("can't read extracted strings");
+            entries = parse_pot(data, &charset);
+            if (!charset.empty() && wxString(charset).Upper() != "UTF-8" && charset != "CHARSET")
+                return MarkUnusable("unsupported charset " + charset);
+        }
+
+        std::map<wxString, FileRecord> records;
+        std::unordered_map<std::string, FileRecord*> byReference;
+        for (auto& f: files)
+        {
+            auto& r = records[f];
+            r.extractor = extractor.GetId();
+            byReference[f.utf8_string()] = &r;
+        }
+
+        // Split entries among files they occur in. Extracted comments, flags
+        // and plural forms can't be attributed to individual occurrences, so
+        // every file gets all of them; they are deduplicated when merged in
+        // Assemble(). This is why AddAffectedFiles() must extract files
+        // sharing strings with changed ones again.
+        std::vector<std::pair<FileRecord*, size_t>> parts;
+        for (auto& e: entries)
+        {
+            if (e.references.empty())
+                return MarkUnusable("extracted strings don't have references");
+
+            parts.clear();
+            for (auto& ref: e.references)
+            {
+                auto ri = byReference.find(reference_file(ref));
+                if (ri == byReference.end())
+                    return MarkUnusable("unexpected reference " + ref);
+
+                auto r = ri->second;
+                auto part = std::find_if(parts.begin(), parts.end(), [=](const auto& p){ return p.first == r; });
+                if (part == parts.end())
+                {
+                    PotEntry copy(e);
+                    copy.references.clear();
+                    r->entries.push_back(std::move(copy));
+                    parts.emplace_back(r, r->entries.size() - 1);
+                    part = parts.end() - 1;
+                }
+                r->entries[part->second].references.push_back(ref);
+            }
+        }
+
+        for (auto& err: output.errors.items)
+        {
+            auto ri = err.has_location() ? byReference.find(err.file.utf8_string()) : byReference.end();
+            if (ri != byReference.end())
+                ri->second->errors.push_back(err);
+            else
+                m_otherErrors.items.push_back(err);
+        }
+
+        for (auto& i: records)
+        {
+            // The stat is the one taken before extraction, in Lookup(). If it
+            // doesn't match after hashing, the file was modified meanwhile and
+            // neither the stat nor the hash necessarily describe the content
+            // the strings were extracted from, so it must be extracted again
+            // next time (the strings are still used now, as without caching).
+            const wxString path = m_basePath + i.first;
+            auto p = m_pending.find(i.first);
+            if (p != m_pending.end())
+                i.second.stat = p->second;
+            else
+                get_file_stat(path, i.second.stat);
+            i.second.hash = hash_file(path);
+
+            FileStat current;
+            if (!get_file_stat(path, current) ||
+                current.size != i.second.stat.size || current.mtime != i.second.stat.mtime)
+            {
+                wxLogTrace("poedit.extractor", "file %s modified during extraction, not caching it", i.first);
+                i.second.stat = FileStat();
+                i.second.hash = 0;
+            }
+
+            m_files[i.first] = std::move(i.second);
+        }
+
+        return true;
+    }
+
+    ExtractionOutput Assemble(TempDirectory& tmpdir, const Extractor::FilesList& files)
+    {
+        ExtractionOutput output;
+        output.errors = m_otherErrors;
+
+        PotEntries merged;
+        std::unordered_map<std::string, size_t> index;
+
+        for (auto& f: files)
+        {
+            auto& r = m_files.at(f);
+            for (auto& e: r.entries)
+            {
+                auto inserted = index.emplace(e.key, merged.size());
+                if (inserted.second)
+                    merged.push_back(e);
+                else
+                    merge_entry(merged[inserted.first->second], e);
+            }
+            output.errors.items.insert(output.errors.items.end(), r.errors.begin(), r.errors.end());
+        }
+
+        std::string data =
+            "msgid \"\"\n"
+            "msgstr \"\"\n"
+            "\"MIME-Version: 1.0\\n\"\n"
+            "\"Content-Type: text/plain; charset=UTF-8\\n\"\n"
+            "\"Content-Transfer-Encoding: 8bit\\n\"\n"
+            "\n";
+        for (auto& e: merged)
+            write_entry(data, e);
+
+        output.pot_file = tmpdir.CreateFileName("cached.pot");
+        if (!write_file(output.pot_file, data))
+            BOOST_THROW_EXCEPTION(ExtractionException(ExtractionError::Unspecified));
+
+        return output;
+    }
+
+    void Save(const Extractor::FilesList& files)
+    {
+        std::string data(CACHE_FILE_SIGNATURE);
+        data += '\n';
+
+        if (!m_usable)
+        {
+            data += "#unusable\n";
+        }
+        else
+        {
+            for (auto& f: files)
+            {
+                auto i = m_files.find(f);
+                if (i == m_files.end())
+                    continue;
+                auto& r = i->second;
+
+                data += "#path " + f.utf8_string() + '\n';
+                data += "#stat " + std::to_string(r.stat.size) + ' ' + std::to_string((long long)r.stat.mtime) + ' ' + std::to_string(r.hash) + '\n';
+                data += "#extractor " + r.extractor.utf8_string() + '\n';
+                for (auto& err: r.errors)
+                {
+                    auto text = err.text.utf8_string();
+                    std::replace(text.begin(), text.end(), '\n', ' ');
+                    data += "#error " + std::to_string((int)err.level) + ' ' + std::to_string(err.line) + ' ' + text + '\n';
+                }
+                for (auto& e: r.entries)
+                    write_entry(data, e);
+            }
+        }
+
+        wxFileName::Mkdir(wxPathOnly(m_filename), wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+        TempOutputFileFor temp(m_filename);
+        if (!write_file(temp.FileName(), data) || !temp.Commit())
+            wxLogTrace("poedit.extractor", "failed to write extraction cache %s", m_filename);
+    }
+
+private:
+    struct FileRecord
+    {
+        wxString extractor;
+        FileStat stat;
+        Hash hash = 0;
+        PotEntries entries;
+        std::vector<ParsedGettextErrors::Item> errors;
+    };
+
+    bool MarkUnusable(const wxString& reason)
+    {
+        wxLogTrace("poedit.extractor", "extraction cache can't be used: %s", reason);
+        m_usable = false;
+        return false;
+    }
+
+    void Load()
+    {
+        std::string data;
+        if (!wxFileExists(m_filename) || !read_file(m_filename, data))
+            return;
+
+        try
+        {
+            DoLoad(data);
+            wxLogTrace("poedit.extractor", "loaded extraction cache %s with %d files", m_filename, (int)m_files.size());
+        }
+        catch (std::exception&)
+        {
+            // corrupted cache is simply discarded
+            m_files.clear();
+            m_usable = true;
+        }
+    }
+
+    void DoLoad(std::string_view data)
+    {
+        FileRecord *current = nullptr;
+        wxString currentPath;
+        size_t currentStart = 0, currentEnd = 0;
+
+        auto finish = [&]
+        {
+            if (current)
+                current->entries = parse_pot(data.substr(currentStart, currentEnd - currentStart));
+            current = nullptr;
+        };
+
+        bool first = true;
+        size_t pos = 0;
+        while (pos < data.size())
+        {
+            size_t eol = data.find('\n', pos);
+            if (eol == std::string_view::npos)
+                eol = data.size();
+            auto line = data.substr(pos, eol - pos);
+            pos = eol + 1;
+
+            if (first)
+            {
+                if (line != CACHE_FILE_SIGNATURE)
+                    return;
+                first = false;
+            }
+            else if (line == "#unusable")
+            {
+                m_usable = false;
+            }
+            else if (starts_with(line, "#path "))
+            {
+                finish();
+                currentPath = wxString::FromUTF8(line.substr(6).data(), line.size() - 6);
+                current = &m_files[currentPath];
+                currentStart = currentEnd = pos;
+            }
+            else if (!current)
+            {
+                throw std::runtime_error("malformed extraction cache");
+            }
+            else if (starts_with(line, "#stat "))
+            {
+                std::string values(line.substr(6));
+                size_t idx;
+                current->stat.size = std::stoll(values, &idx);
+                values.erase(0, idx);
+                current->stat.mtime = (time_t)std::stoll(values, &idx);
+                values.erase(0, idx);
+                current->hash = std::stoull(values);
+                currentStart = currentEnd = pos;
+            }
+            else if (starts_with(line, "#extractor "))
+            {
+                current->extractor = wxString::FromUTF8(line.substr(11).data(), line.size() - 11);
+                currentStart = currentEnd = pos;
+            }
+            else if (starts_with(line, "#error "))
+            {
+                std::string values(line.substr(7));
+                size_t idx;
+                ParsedGettextErrors::Item err;
+                err.level = (ParsedGettextErrors::Level)std::stoi(values, &idx);
+                values.erase(0, idx);
+                err.line = std::stoi(values, &idx);
+                err.text = wxString::FromUTF8(values.substr(idx + 1));
+                err.file = currentPath;
+                current->errors.push_back(err);
+                currentStart = currentEnd = pos;
+            }
+            else
+            {
+                currentEnd = std::min(pos, data.size());
+            }
+        }
+
+        finish();
+    }
+
+    const wxString m_basePath;
+    wxString m_filename;
+    bool m_usable;
+
+    std::map<wxString, FileRecord> m_files;
+    std::map<wxString, FileStat> m_pending;
+    ParsedGettextErrors m_otherErrors;
+};
+
+
+ExtractionCache::ExtractionCache(const SourceCodeSpec& sourceSpec, const Extractor::ExtractorsList& extractors)
+    : m_impl(new impl(sourceSpec, extractors))
+{
+}
+
+ExtractionCache::~ExtractionCache() {}
+
+bool ExtractionCache::IsUsable() const
+{
+    return m_impl->IsUsable();
+}
+
+bool ExtractionCache::Lookup(const wxString& file, const Extractor& extractor)
+{
+    return m_impl->Lookup(file, extractor);
+}
+
+void ExtractionCache::AddAffectedFiles(const Extractor::FilesList& files, const Extractor& extractor, Extractor::FilesList& changed)
+{
+    m_impl->AddAffectedFiles(files, extractor, changed);
+}
+
+bool ExtractionCache::Store(const ExtractionOutput& output, const Extractor::FilesList& files, const Extractor& extractor)
+{
+    return m_impl->Store(output, files, extractor);
+}
+
+ExtractionOutput ExtractionCache::Assemble(TempDirectory& tmpdir, const Extractor::FilesList& files)
+{
+    return m_impl->Assemble(tmpdir, files);
+}
+
+void ExtractionCache::Save(const Extractor::FilesList& files)
+{
+    m_impl->Save(files);
+}
@@ -0,0 +1,99 @@
+/*
+ *  This file is part of Poedit (https://poedit.net)
+ *
+ *  Copyright (C) 2025 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef Poedit_extraction_cache_h
+#define Poedit_extraction_cache_h
+
+#include "extractor.h"
+
+#include <memory>
+
+
+/**
+    Persistent cache of strings extracted from individual source files.
+
+    Extraction is slow with large codebases, yet typically only a few files
+    change between updates. The cache keeps strings extracted from every file
+    together with the file's size, modification time and content hash, so
+    that only new or changed files need to be processed by extractors. The
+    resulting POT file is then assembled from the cached per-file parts.
+
+    The cache is shared by all translation files that use the same source
+    code with the same settings (keywords, extractors etc.), because they
+    extract the same strings from it.
+ */
+class ExtractionCache
+{
+public:
+    /// Opens the cache for given sources; it is empty if it doesn't exist yet.
+    ExtractionCache(const SourceCodeSpec& sourceSpec, const Extractor::ExtractorsList& extractors);
+    ~ExtractionCache();
+
+    ExtractionCache(const ExtractionCache&) = delete;
+
+    /**
+        Returns false if output of extractors in this configuration can't be
+        cached, because it can't be split into parts for individual files
+        (e.g. when xgettext is told not to write references).
+     */
+    bool IsUsable() const;
+
+    /// Returns true if up-to-date strings from @a file, extracted by @a extractor, are cached.
+    bool Lookup(const wxString& file, const Extractor& extractor);
+
+    /**
+        Adds to @a changed (files among @a files that failed Lookup()) other
+        files from @a files that must be extracted again with them, because
+        they share strings with files that changed or were removed, and so
+        their cached parts may contain outdated comments or flags. Both
+        lists must be sorted.
+     */
+    void AddAffectedFiles(const Extractor::FilesList& files, const Extractor& extractor, Extractor::FilesList& changed);
+
+    /**
+        Adds output of extracting @a files by @a extractor to the cache,
+        splitting it into parts for each file by references.
+
+        Returns false, and marks the cache as unusable, if that's not
+        possible.
+     */
+    bool Store(const ExtractionOutput& output, const Extractor::FilesList& files, const Extractor& extractor);
+
+    /**
+        Writes POT file with strings from given @a files, which must all be
+        cached, merging them in the same way xgettext does. Errors reported
+        by extractors for these files are included in the output.
+     */
+    ExtractionOutput Assemble(TempDirectory& tmpdir, const Extractor::FilesList& files);
+
+    /// Writes the cache to disk, keeping only entries for given @a files.
+    void Save(const Extractor::FilesList& files);
+
+private:
+    class impl;
+    std::unique_ptr<impl> m_impl;
+};
+
+#endif // Poedit_extraction_cache_h
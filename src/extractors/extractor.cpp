@@ -25,13 +25,22 @@
 
 #include "extractor.h"
 
+#include "extraction_cache.h"
 #include "extractor_legacy.h"
 
-#include "gexecute.h"
+#include "catalog_po.h"
+#include "concurrency.h"
+#include "errors.h"
 
 #include <wx/dir.h>
+#include <wx/file.h>
 #include <wx/filename.h>
-#include <wx/textfile.h>
+
+#ifndef __WXMSW__
+    #include <dirent.h>
+    #include <errno.h>
+    #include <sys/stat.h>
+#endif
 
 #include <algorithm>
 
@@ -40,43 +49,83 @@ namespace
 
 // Path matching with support for wildcards
 
-struct PathToMatch
-{
-    wxString path;
-    bool isWildcard;
-
-    bool MatchesFile(const wxString& fn) const
-    {
-        if (isWildcard)
-            return wxMatchWild(path, fn);
-        else
-            return fn == path || fn.starts_with(path + "/");
-    }
-};
-
 class PathsToMatch
 {
 public:
     PathsToMatch() {}
     explicit PathsToMatch(const wxArrayString& a)
     {
-        paths.reserve(a.size());
         for (auto& p: a)
-            paths.push_back({p, wxIsWild(p)});
+        {
+            if (wxIsWild(p))
+            {
+                // Literal parts at both ends of the pattern are used to
+                // quickly reject most paths without doing full matching:
+                Wildcard w;
+                w.pattern = p;
+                auto first = p.find_first_of(wxS("*?[{\\"));
+                auto last = p.find_last_of(wxS("*?[]{}\\"));
+                w.prefix = p.substr(0, first);
+                w.suffix = p.substr(last + 1);
+                wildcards.push_back(w);
+            }
+            else
+            {
+                literals.insert(p);
+            }
+        }
     }
 
+    /// Returns true if @a fn or any of its parent directories is matched
     bool MatchesFile(const wxString& fn) const
     {
-        for (auto& p: paths)
+        if (MatchesEntry(fn))
+            return true;
+
+        if (!literals.empty())
         {
-            if (p.MatchesFile(fn))
+            for (auto pos = fn.find('/'); pos != wxString::npos; pos = fn.find('/', pos + 1))
+            {
+                if (literals.find(fn.substr(0, pos)) != literals.end())
+                    return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+        Like MatchesFile(), but doesn't check parent directories of @a fn.
+
+        Used when traversing directories, where excluded directories are
+        skipped entirely.
+     */
+    bool MatchesEntry(const wxString& fn) const
+    {
+        if (literals.find(fn) != literals.end())
+            return true;
+
+        for (auto& w: wildcards)
+        {
+            if (fn.length() >= w.prefix.length() + w.suffix.length() &&
+                fn.starts_with(w.prefix) && fn.ends_with(w.suffix) &&
+                wxMatchWild(w.pattern, fn))
+            {
                 return true;
+            }
         }
+
         return false;
     }
 
 private:
-    std::vector<PathToMatch> paths;
+    struct Wildcard
+    {
+        wxString pattern, prefix, suffix;
+    };
+
+    std::set<wxString> literals;
+    std::vector<Wildcard> wildcards;
 };
 
 inline void CheckReadPermissions(const wxString& basepath, const wxString& path)
@@ -93,59 +142,155 @@ inline bool IsVCSDir(const wxString& d)
 }
 
 
-int FindInDir(const wxString& basepath, const wxString& dirname, const PathsToMatch& excludedPaths,
-              Extractor::FilesList& output)
+/**
+    Lists non-hidden files and subdirectories of @a path, like wxDir does.
+
+    On Unix, file types are taken from directory entries and stat() is only
+    used for symlinks or if the filesystem doesn't provide the type.
+ */
+void ListDir(const wxString& path, std::vector<wxString>& files, std::vector<wxString>& dirs)
 {
-    if (dirname.empty())
-        return 0;
+#ifdef __WXMSW__
+    if (!wxIsReadable(path))
+        BOOST_THROW_EXCEPTION(ExtractionException(ExtractionError::PermissionDenied));
 
-    wxDir dir(basepath + dirname);
+    wxDir dir(path);
+    if (!dir.IsOpened())
+        return;
 
-    CheckReadPermissions(basepath, dirname);
+    wxString name;
+    for (bool cont = dir.GetFirst(&name, wxEmptyString, wxDIR_FILES); cont; cont = dir.GetNext(&name))
+    {
+        // Normally, a file enumerated by wxDir exists, but in one special case, it may
+        // not: if it is a broken symlink. FileExists() follows the symlink to check.
+        if (wxFileName::FileExists(path + wxFILE_SEP_PATH + name))
+            files.push_back(name);
+    }
+    for (bool cont = dir.GetFirst(&name, wxEmptyString, wxDIR_DIRS); cont; cont = dir.GetNext(&name))
+        dirs.push_back(name);
+#else
+    const wxCharBuffer fnpath(path.fn_str());
+    DIR *dir = opendir(fnpath);
+    if (!dir)
+    {
+        if (errno == EACCES)
+            BOOST_THROW_EXCEPTION(ExtractionException(ExtractionError::PermissionDenied));
+        return;
+    }
 
-    if (!dir.IsOpened())
-        return 0;
+    while (auto entry = readdir(dir))
+    {
+        // skip hidden files, as well as "." and ".."
+        if (entry->d_name[0] == '.')
+            continue;
 
-    bool cont;
-    wxString iter;
-    int found = 0;
-    
-    cont = dir.GetFirst(&iter, wxEmptyString, wxDIR_FILES);
-    while (cont)
+        bool isDir = false, isFile = false;
+#ifdef DT_DIR
+        if (entry->d_type == DT_DIR)
+            isDir = true;
+        else if (entry->d_type == DT_REG)
+            isFile = true;
+        else if (entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN)
+#endif
+        {
+            // follow symlinks; broken ones are skipped
+            std::string full(fnpath.data());
+            full += '/';
+            full += entry->d_name;
+            struct stat st;
+            if (stat(full.c_str(), &st) == 0)
+            {
+                isDir = S_ISDIR(st.st_mode);
+                isFile = S_ISREG(st.st_mode);
+            }
+        }
+
+        if (isDir)
+            dirs.emplace_back(entry->d_name, *wxConvFileName);
+        else if (isFile)
+            files.emplace_back(entry->d_name, *wxConvFileName);
+    }
+
+    closedir(dir);
+#endif
+}
+
+
+/// Files and subdirectories found in a single directory
+struct DirContent
+{
+    Extractor::FilesList files;
+    std::vector<wxString> subdirs;
+};
+
+void ScanDir(const wxString& basepath, const wxString& dirname,
+             const PathsToMatch& excludedPaths, const Extractor::ExtractorsList& extractors,
+             DirContent& output)
+{
+    std::vector<wxString> files, dirs;
+    ListDir(basepath + dirname, files, dirs);
+
+    for (auto& filename: files)
     {
-        const wxString filename = iter;
         const wxString fullpath = (dirname == ".") ? filename : dirname + "/" + filename;
-        cont = dir.GetNext(&iter);
 
-        if (excludedPaths.MatchesFile(fullpath))
+        if (excludedPaths.MatchesEntry(fullpath))
             continue;
 
-        // Normally, a file enumerated by wxDir exists, but in one special case, it may
-        // not: if it is a broken symlink. FileExists() follows the symlink to check.
-        if (!wxFileName::FileExists(basepath + fullpath))
+        // Don't collect files that no extractor can handle:
+        if (std::none_of(extractors.begin(), extractors.end(),
+                         [&](const auto& ex){ return ex->IsFileSupported(fullpath); }))
+        {
             continue;
-        
+        }
+
         CheckReadPermissions(basepath, fullpath);
         wxLogTrace("poedit.extractor", "  - %s", fullpath);
-        output.push_back(fullpath);
-        found++;
+        output.files.push_back(fullpath);
     }
 
-    cont = dir.GetFirst(&iter, wxEmptyString, wxDIR_DIRS);
-    while (cont)
+    for (auto& filename: dirs)
     {
-        const wxString filename = iter;
-        const wxString fullpath = (dirname == ".") ? filename : dirname + "/" + filename;
-        cont = dir.GetNext(&iter);
-
         if (IsVCSDir(filename))
             continue;
 
-        if (excludedPaths.MatchesFile(fullpath))
+        const wxString fullpath = (dirname == ".") ? filename : dirname + "/" + filename;
+        if (excludedPaths.MatchesEntry(fullpath))
             continue;
 
-        CheckReadPermissions(basepath, fullpath);
-        found += FindInDir(basepath, fullpath, excludedPaths, output);
+        output.subdirs.push_back(fullpath);
+    }
+}
+
+
+int FindInDir(const wxString& basepath, const wxString& dirname,
+              const PathsToMatch& excludedPaths, const Extractor::ExtractorsList& extractors,
+              Extractor::FilesList& output)
+{
+    if (dirname.empty())
+        return 0;
+
+    // Directories are traversed level by level, scanning all directories
+    // on the same level in parallel; the order of results doesn't matter,
+    // because they are sorted afterwards.
+    std::vector<wxString> level { dirname };
+    int found = 0;
+
+    while (!level.empty())
+    {
+        std::vector<DirContent> contents(level.size());
+        dispatch::parallel_for(level.size(), [&](size_t i)
+        {
+            ScanDir(basepath, level[i], excludedPaths, extractors, contents[i]);
+        }, /*chunkSize=*/4);
+
+        level.clear();
+        for (auto& c: contents)
+        {
+            found += (int)c.files.size();
+            output.insert(output.end(), c.files.begin(), c.files.end());
+            level.insert(level.end(), c.subdirs.begin(), c.subdirs.end());
+        }
     }
 
     return found;
@@ -156,12 +301,11 @@ int FindInDir(const wxString& basepath, const wxString& dirname, const PathsToMa
 
 Extractor::FilesList Extractor::CollectAllFiles(const SourceCodeSpec& sources)
 {
-    // TODO: Only collect files with recognized extensions
-
     wxLogTrace("poedit.extractor", "collecting files:");
 
     const auto basepath = sources.BasePath;
     const auto excludedPaths = PathsToMatch(sources.ExcludedPaths);
+    const auto extractors = CreateAllExtractors(sources);
 
     FilesList output;
 
@@ -180,7 +324,8 @@ Extractor::FilesList Extractor::CollectAllFiles(const SourceCodeSpec& sources)
         }
         else if (wxFileName::DirExists(basepath + path))
         {
-            if (!FindInDir(basepath, path, excludedPaths, output))
+            if (excludedPaths.MatchesFile(path) ||
+                !FindInDir(basepath, path, excludedPaths, extractors, output))
             {
                 wxLogTrace("poedit.extractor", "no files found in '%s'", path);
             }
@@ -206,6 +351,86 @@ Extractor::FilesList Extractor::CollectAllFiles(const SourceCodeSpec& sources)
 ExtractionOutput Extractor::ExtractWithAll(TempDirectory& tmpdir,
                                            const SourceCodeSpec& sourceSpec,
                                            const std::vector<wxString>& files_)
+{
+    auto extractors = CreateAllExtractors(sourceSpec);
+
+    ExtractionCache cache(sourceSpec, extractors);
+    if (!cache.IsUsable())
+        return ExtractWithAllUncached(tmpdir, sourceSpec, files_);
+
+    auto files = files_;
+    wxLogTrace("poedit.extractor", "extracting from %d files, using cache", (int)files.size());
+
+    ExtractionCacheStats stats;
+    FilesList handled;
+
+    for (auto ex: extractors)
+    {
+        const auto ex_files = ex->FilterFiles(files);
+        if (ex_files.empty())
+            continue;
+
+        FilesList changed;
+        for (auto& f: ex_files)
+        {
+            if (!cache.Lookup(f, *ex))
+                changed.push_back(f);
+        }
+        cache.AddAffectedFiles(ex_files, *ex, changed);
+
+        wxLogTrace("poedit.extractor", " .. using extractor '%s' for %d files, %d of them changed",
+                   ex->GetId(), (int)ex_files.size(), (int)changed.size());
+
+        if (!changed.empty())
+        {
+            auto sub = ex->Extract(tmpdir, sourceSpec, changed);
+            if (!cache.Store(sub, changed, *ex))
+            {
+                // remember that the cache can't be used, to not waste time next time
+                cache.Save({});
+                return ExtractWithAllUncached(tmpdir, sourceSpec, files_);
+            }
+        }
+
+        stats.files += (int)ex_files.size();
+        stats.hits += int(ex_files.size() - changed.size());
+        handled.insert(handled.end(), ex_files.begin(), ex_files.end());
+
+        if (files.size() > ex_files.size())
+        {
+            FilesList remaining;
+            remaining.reserve(files.size() - ex_files.size());
+            // Note that this only works because the lists are sorted:
+            std::set_difference(files.begin(), files.end(),
+                                ex_files.begin(), ex_files.end(),
+                                std::inserter(remaining, remaining.begin()));
+            std::swap(files, remaining);
+        }
+        else
+        {
+            files.clear();
+            break; // no more work to do
+        }
+    }
+
+    wxLogTrace("poedit.extractor", "extraction finished with %d unrecognized files, %d of %d files cached",
+               (int)files.size(), stats.hits, stats.files);
+
+    if (handled.empty())
+    {
+        BOOST_THROW_EXCEPTION(ExtractionException(ExtractionError::NoSourcesFound));
+    }
+
+    auto result = cache.Assemble(tmpdir, handled);
+    result.cache_stats = stats;
+    cache.Save(handled);
+    return result;
+}
+
+
+ExtractionOutput Extractor::ExtractWithAllUncached(TempDirectory& tmpdir,
+                                                   const SourceCodeSpec& sourceSpec,
+                                                   const std::vector<wxString>& files_)
 {
     auto files = files_;
     wxLogTrace("poedit.extractor", "extracting from %d files", (int)files.size());
@@ -333,36 +558,30 @@ ExtractionOutput Extractor::ConcatPartials(TempDirectory& tmpdir, const std::vec
     ExtractionOutput result;
     result.pot_file = tmpdir.CreateFileName("concatenated.pot");
 
-    wxTextFile filelist;
-    filelist.Create(tmpdir.CreateFileName("gettext_filelist.txt"));
-    for (auto& p: partials)
+    try
     {
-        auto fn = p.pot_file;
-#ifdef __WXMSW__
-        // Gettext tools can't handle Unicode filenames well (due to using
-        // char* arguments), so work around this by using the short names.
-        if (!fn.IsAscii())
+        std::vector<POCatalogPtr> catalogs;
+        for (auto& p: partials)
         {
-            fn = CliSafeFileName(fn);
-            fn.Replace("\\", "/");
+            catalogs.push_back(POCatalog::Create(p.pot_file));
+            result.errors += p.errors;
+        }
+
+        auto merged = POCatalog::Concatenate(catalogs);
+        auto data = merged->SaveToBuffer();
+
+        wxFile f;
+        if (data.empty() ||
+            !f.Create(result.pot_file, /*overwrite=*/true) ||
+            f.Write(data.data(), data.size()) != data.size() ||
+            !f.Close())
+        {
+            BOOST_THROW_EXCEPTION(Exception(wxString::Format(_(L"Couldn’t save file %s."), result.pot_file)));
         }
-#endif
-        filelist.AddLine(fn);
-        result.errors += p.errors;
     }
-    filelist.Write(wxTextFileType_Unix, wxConvFile);
-
-    GettextRunner gt;
-    auto output = gt.run_sync("msgcat",
-                              "--force-po",
-                              // avoid corrupted content of duplicate "" headers
-                              // FIXME: merge headers intelligently, e.g. pick latest POT-Creation-Date
-                              "--use-first",
-                              "-o", result.pot_file,
-                              "--files-from", filelist.GetName());
-    if (output.failed())
+    catch (...)
     {
-        wxLogError("msgcat: %s", output.std_err);
+        wxLogError("%s", DescribeCurrentException());
         wxLogError(_("Failed to merge gettext catalogs."));
         BOOST_THROW_EXCEPTION(ExtractionException(ExtractionError::Unspecified));
     }
@@ -72,6 +72,19 @@ public:
 };
 
 
+/// Statistics of reusing previously extracted strings, see ExtractionCache.
+struct ExtractionCacheStats
+{
+    /// Number of source files strings were extracted from.
+    int files = 0;
+
+    /// Number of files whose strings were taken from the cache.
+    int hits = 0;
+
+    explicit operator bool() const { return files > 0; }
+};
+
+
 /// Complete result of running an extraction task.
 struct ExtractionOutput
 {
@@ -81,6 +94,9 @@ struct ExtractionOutput
     /// Errors/warnings that occurred during extraction.
     ParsedGettextErrors errors;
 
+    /// Use of the extraction cache, if it was used.
+    ExtractionCacheStats cache_stats;
+
     explicit operator bool() const { return !pot_file.empty(); }
 };
 
@@ -107,8 +123,8 @@ public:
     static ExtractorsList CreateAllExtractors(const SourceCodeSpec& sources);
 
     /**
-        Collects all files from source code, possibly including files that
-        don't contain translations.
+        Collects all source files supported by some extractor, possibly
+        including files that don't contain translations.
 
         The returned list is guaranteed to be sorted by operator<
 
@@ -120,6 +136,9 @@ public:
     /**
         Extracts translations from given source files using all
         available extractors.
+
+        Strings from files that didn't change since the last extraction
+        are reused from ExtractionCache.
      */
     static ExtractionOutput ExtractWithAll(TempDirectory& tmpdir,
                                            const SourceCodeSpec& sourceSpec,
@@ -135,6 +154,14 @@ public:
     /// Returns extractor's symbolic name
     virtual wxString GetId() const = 0;
 
+    /**
+        Returns string identifying extractor's configuration.
+
+        Cached extraction results are discarded when it changes. Default
+        implementation returns GetId().
+     */
+    virtual wxString GetConfigurationKey() const { return GetId(); }
+
     /// Priority value for GetPriority()
     enum class Priority
     {
@@ -179,9 +206,14 @@ protected:
     /// Check if file is supported based on its extension
     bool HasKnownExtension(const wxString& file) const;
 
-    /// Concatenates partial outputs using msgcat
+    /// Concatenates partial outputs, see POCatalog::Concatenate()
     static ExtractionOutput ConcatPartials(TempDirectory& tmpdir, const std::vector<ExtractionOutput>& partials);
 
+    /// Implementation of ExtractWithAll() that doesn't use the cache
+    static ExtractionOutput ExtractWithAllUncached(TempDirectory& tmpdir,
+                                                   const SourceCodeSpec& sourceSpec,
+                                                   const std::vector<wxString>& files);
+
 private:
     Priority m_priority;
     std::set<wxString> m_extensions;
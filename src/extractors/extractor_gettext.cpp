@@ -27,7 +27,12 @@
 
 #include "gexecute.h"
 
+#include <wx/filename.h>
 #include <wx/textfile.h>
+#include <wx/thread.h>
+
+#include <cstdint>
+#include <thread>
 
 namespace
 {
@@ -90,6 +95,50 @@ const char * const GETTEXT_EXTENSIONS[] = {
 };
 
 
+// Minimum number of files worth running a separate xgettext process for;
+// spawning processes isn't free and most source files are small.
+const size_t MIN_FILES_PER_SHARD = 100;
+
+/**
+    Splits @a files into contiguous shards of roughly the same total size.
+
+    Shards keep the original files order, so that concatenating their outputs
+    in order produces the same result as running xgettext on all files.
+ */
+std::vector<std::vector<wxString>> SplitIntoShards(const wxString& basepath, const std::vector<wxString>& files)
+{
+    size_t count = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                    files.size() / MIN_FILES_PER_SHARD);
+    if (count <= 1)
+        return {files};
+
+    std::vector<uint64_t> sizes;
+    sizes.reserve(files.size());
+    uint64_t total = 0;
+    for (auto& fn: files)
+    {
+        // account for per-file overhead too, empty files aren't free to process
+        uint64_t size = 1024;
+        auto fileSize = wxFileName::GetSize(basepath + fn);
+        if (fileSize != wxInvalidSize)
+            size += fileSize.GetValue();
+        sizes.push_back(size);
+        total += size;
+    }
+
+    std::vector<std::vector<wxString>> shards(1);
+    uint64_t accumulated = 0;
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        if (!shards.back().empty() && shards.size() < count && accumulated >= total * shards.size() / count)
+            shards.emplace_back();
+        shards.back().push_back(files[i]);
+        accumulated += sizes[i];
+    }
+
+    return shards;
+}
+
 } // anonymous namespace
 
 
@@ -101,14 +150,81 @@ public:
                              const SourceCodeSpec& sourceSpec,
                              const std::vector<wxString>& files) const override
     {
-        using subprocess::quote_arg;
-
         auto basepath = sourceSpec.BasePath;
 #ifdef __WXMSW__
         basepath = CliSafeFileName(basepath);
         basepath.Replace("\\", "/");
 #endif
 
+        // xgettext is single-threaded, so process large codebases in several
+        // concurrently running instances and merge their outputs afterwards.
+        // This is only possible from a worker thread, because subprocesses are
+        // launched on the main thread.
+        auto shards = wxThread::IsMain()
+                      ? std::vector<std::vector<wxString>>{files}
+                      : SplitIntoShards(sourceSpec.BasePath, files);
+
+        if (shards.size() == 1)
+        {
+            GettextRunner runner;
+            auto outfile = tmpdir.CreateFileName("gettext.pot");
+            auto output = runner.run_command_sync(BuildCommandLine(tmpdir, sourceSpec, basepath, files, outfile));
+            auto err = runner.parse_stderr(output);
+
+            if (output.failed())
+            {
+                err.log_all();
+                BOOST_THROW_EXCEPTION(ExtractionException(ExtractionError::Unspecified));
+            }
+
+            return {outfile, err};
+        }
+
+        wxLogTrace("poedit.extractor", "running xgettext on %d files in %d shards", (int)files.size(), (int)shards.size());
+
+        // GettextRunner keeps per-process state for parse_stderr(), so each
+        // instance needs its own:
+        std::vector<GettextRunner> runners(shards.size());
+        std::vector<ExtractionOutput> partials(shards.size());
+        std::vector<dispatch::future<subprocess::Output>> outputs;
+        for (size_t i = 0; i < shards.size(); i++)
+        {
+            partials[i].pot_file = tmpdir.CreateFileName("gettext.pot");
+            outputs.push_back(runners[i].run_command_async(BuildCommandLine(tmpdir, sourceSpec, basepath, shards[i], partials[i].pot_file)));
+        }
+
+        // wait for all processes to finish before doing anything else, even
+        // if some of them fail, as they write into tmpdir
+        bool failed = false;
+        ParsedGettextErrors err;
+        for (size_t i = 0; i < shards.size(); i++)
+        {
+            auto output = outputs[i].get();
+            partials[i].errors = runners[i].parse_stderr(output);
+            err += partials[i].errors;
+            if (output.failed())
+                failed = true;
+        }
+
+        if (failed)
+        {
+            err.log_all();
+            BOOST_THROW_EXCEPTION(ExtractionException(ExtractionError::Unspecified));
+        }
+
+        // merge in shards order to preserve the order of messages
+        return ConcatPartials(tmpdir, partials);
+    }
+
+private:
+    wxString BuildCommandLine(TempDirectory& tmpdir,
+                              const SourceCodeSpec& sourceSpec,
+                              const wxString& basepath,
+                              const std::vector<wxString>& files,
+                              const wxString& outfile) const
+    {
+        using subprocess::quote_arg;
+
         wxTextFile filelist;
         filelist.Create(tmpdir.CreateFileName("gettext_filelist.txt"));
         for (auto fn: files)
@@ -126,8 +242,6 @@ public:
         }
         filelist.Write(wxTextFileType_Unix, wxConvFile);
 
-        auto outfile = tmpdir.CreateFileName("gettext.pot");
-
         wxString cmdline;
         cmdline.Printf
         (
@@ -160,17 +274,7 @@ public:
         if (!extraFlags.empty())
             cmdline += " " + extraFlags;
 
-        GettextRunner runner;
-        auto output = runner.run_command_sync(cmdline);
-        auto err = runner.parse_stderr(output);
-
-        if (output.failed())
-        {
-            err.log_all();
-            BOOST_THROW_EXCEPTION(ExtractionException(ExtractionError::Unspecified));
-        }
-
-        return {outfile, err};
+        return cmdline;
     }
     
 protected:
@@ -132,6 +132,12 @@ public:
 
     wxString GetId() const override { return m_id; }
 
+    wxString GetConfigurationKey() const override
+    {
+        return m_id + "\n" + m_spec.Command + "\n" + m_spec.KeywordItem + "\n" +
+               m_spec.FileItem + "\n" + m_spec.CharsetItem;
+    }
+
     ExtractionOutput Extract(TempDirectory& tmpdir,
                              const SourceCodeSpec& sourceSpec,
                              const std::vector<wxString>& files) const override;
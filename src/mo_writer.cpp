@@ -0,0 +1,227 @@
+/*
+ *  This file is part of Poedit (https://poedit.net)
+ *
+ *  Copyright (C) 2025 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "mo_writer.h"
+
+#include <wx/file.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+
+namespace
+{
+
+const uint32_t MO_MAGIC = 0x950412de;
+const uint32_t MO_HEADER_SIZE = 7 * sizeof(uint32_t);
+
+// The same hashing function as used by GNU gettext (hashpjw)
+uint32_t gettext_hash(std::string_view str)
+{
+    uint32_t hval = 0;
+    for (auto c: str)
+    {
+        hval <<= 4;
+        hval += (unsigned char)c;
+        uint32_t g = hval & ((uint32_t)0xf << 28);
+        if (g != 0)
+        {
+            hval ^= g >> 24;
+            hval ^= g;
+        }
+    }
+    return hval;
+}
+
+bool is_prime(uint32_t candidate)
+{
+    // no even number and none less than 10 will be passed here
+    uint32_t divn = 3;
+    uint32_t sq = divn * divn;
+    while (sq < candidate && candidate % divn != 0)
+    {
+        ++divn;
+        sq += 4 * divn;
+        ++divn;
+    }
+    return candidate % divn != 0;
+}
+
+uint32_t next_prime(uint32_t seed)
+{
+    seed |= 1;
+    while (!is_prime(seed))
+        seed += 2;
+    return seed;
+}
+
+// The part of the key used for lookups, i.e. without msgid_plural
+inline std::string_view lookup_key(const std::string& key)
+{
+    return std::string_view(key.c_str());
+}
+
+inline void append_uint32(std::string& out, uint32_t value)
+{
+    char buf[sizeof(uint32_t)];
+    memcpy(buf, &value, sizeof(value));
+    out.append(buf, sizeof(buf));
+}
+
+} // anonymous namespace
+
+
+void MOWriter::AddMessage(bool has_context, const std::string& context,
+                          const std::string& msgid,
+                          bool has_plural, const std::string& msgid_plural,
+                          const std::vector<std::string>& translations)
+{
+    Message m;
+
+    if (has_context)
+    {
+        m.key.reserve(context.size() + 1 + msgid.size());
+        m.key.append(context);
+        m.key += '\x04';
+    }
+    m.key.append(msgid);
+    if (has_plural)
+    {
+        m.key += '\0';
+        m.key.append(msgid_plural);
+    }
+
+    for (size_t i = 0; i < translations.size(); i++)
+    {
+        if (i > 0)
+            m.value += '\0';
+        m.value.append(translations[i]);
+    }
+
+    m_messages.push_back(std::move(m));
+}
+
+
+std::string MOWriter::Serialize()
+{
+    // msgfmt sorts messages by msgid, which is required for binary search in
+    // lookups without hash table; keep the first occurrence of duplicates:
+    std::stable_sort(m_messages.begin(), m_messages.end(), [](const Message& a, const Message& b)
+    {
+        return lookup_key(a.key) < lookup_key(b.key);
+    });
+    m_messages.erase(std::unique(m_messages.begin(), m_messages.end(), [](const Message& a, const Message& b)
+                     {
+                         return lookup_key(a.key) == lookup_key(b.key);
+                     }),
+                     m_messages.end());
+
+    const uint32_t count = (uint32_t)m_messages.size();
+
+    // Hash table size and collision resolution are the same as in msgfmt, so
+    // that the output is identical:
+    uint32_t hashSize = next_prime((count * 4) / 3);
+    if (hashSize <= 2)
+        hashSize = 3;
+
+    std::vector<uint32_t> hashTable(hashSize, 0);
+    for (uint32_t j = 0; j < count; j++)
+    {
+        const uint32_t hash = gettext_hash(lookup_key(m_messages[j].key));
+        uint32_t idx = hash % hashSize;
+        if (hashTable[idx] != 0)
+        {
+            const uint32_t incr = 1 + (hash % (hashSize - 2));
+            do
+            {
+                if (idx >= hashSize - incr)
+                    idx -= hashSize - incr;
+                else
+                    idx += incr;
+            }
+            while (hashTable[idx] != 0);
+        }
+        hashTable[idx] = j + 1;
+    }
+
+    const uint32_t origTableOffset = MO_HEADER_SIZE;
+    const uint32_t transTableOffset = origTableOffset + count * 8;
+    const uint32_t hashTableOffset = transTableOffset + count * 8;
+    const uint32_t stringsOffset = hashTableOffset + hashSize * 4;
+
+    size_t stringsSize = 0;
+    for (auto& m: m_messages)
+        stringsSize += m.key.size() + 1 + m.value.size() + 1;
+
+    std::string out;
+    out.reserve(stringsOffset + stringsSize);
+
+    append_uint32(out, MO_MAGIC);
+    append_uint32(out, 0); // revision
+    append_uint32(out, count);
+    append_uint32(out, origTableOffset);
+    append_uint32(out, transTableOffset);
+    append_uint32(out, hashSize);
+    append_uint32(out, hashTableOffset);
+
+    // Original strings are stored first, followed by all translations:
+    uint32_t offset = stringsOffset;
+    for (auto& m: m_messages)
+    {
+        append_uint32(out, (uint32_t)m.key.size());
+        append_uint32(out, offset);
+        offset += (uint32_t)m.key.size() + 1;
+    }
+    for (auto& m: m_messages)
+    {
+        append_uint32(out, (uint32_t)m.value.size());
+        append_uint32(out, offset);
+        offset += (uint32_t)m.value.size() + 1;
+    }
+
+    for (auto h: hashTable)
+        append_uint32(out, h);
+
+    for (auto& m: m_messages)
+        out.append(m.key.c_str(), m.key.size() + 1);
+    for (auto& m: m_messages)
+        out.append(m.value.c_str(), m.value.size() + 1);
+
+    return out;
+}
+
+
+bool MOWriter::Write(const wxString& filename)
+{
+    const std::string data = Serialize();
+
+    wxFile f;
+    if (!f.Create(filename, /*overwrite=*/true))
+        return false;
+
+    return f.Write(data.data(), data.size()) == data.size() && f.Close();
+}
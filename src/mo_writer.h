@@ -0,0 +1,80 @@
+/*
+ *  This file is part of Poedit (https://poedit.net)
+ *
+ *  Copyright (C) 2025 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef Poedit_mo_writer_h
+#define Poedit_mo_writer_h
+
+#include <wx/string.h>
+
+#include <string>
+#include <vector>
+
+
+/**
+    Writes compiled binary MO catalogs.
+
+    This produces the same output as GNU msgfmt would for the same set of
+    messages: revision 0 of the format in native byte order, with strings
+    sorted by msgid and with the hash table used by gettext for lookups.
+
+    Messages are passed in already encoded in catalog's charset, because MO
+    files store them in the same encoding as the source PO file.
+ */
+class MOWriter
+{
+public:
+    /**
+        Adds message to the catalog.
+
+        @param translations  Translations of the message, only one for
+                             messages without plural forms.
+
+        Only the first occurrence of a message is kept if it is added repeatedly.
+     */
+    void AddMessage(bool has_context, const std::string& context,
+                    const std::string& msgid,
+                    bool has_plural, const std::string& msgid_plural,
+                    const std::vector<std::string>& translations);
+
+    /// Number of messages added so far.
+    size_t GetCount() const { return m_messages.size(); }
+
+    /// Returns the content of compiled MO file.
+    std::string Serialize();
+
+    /// Writes compiled MO file to disk, returns false on failure.
+    bool Write(const wxString& filename);
+
+private:
+    struct Message
+    {
+        std::string key;    // msgctxt EOT msgid NUL msgid_plural
+        std::string value;  // translations separated with NULs
+    };
+
+    std::vector<Message> m_messages;
+};
+
+#endif // Poedit_mo_writer_h
@@ -0,0 +1,657 @@
+/*
+ *  This file is part of Poedit (https://poedit.net)
+ *
+ *  Copyright (C) 2025 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "po_validator.h"
+
+#include "concurrency.h"
+#include "str_helpers.h"
+
+#include <wx/intl.h>
+
+#include <atomic>
+#include <map>
+
+
+namespace
+{
+
+enum class FormatKind
+{
+    None,
+    C,
+    ObjC,
+    Python
+};
+
+FormatKind GetFormatKind(std::string format)
+{
+    // msgfmt checks strings that are only possibly format strings too:
+    if (format.compare(0, 9, "possible-") == 0)
+        format.erase(0, 9);
+
+    if (format == "c")
+        return FormatKind::C;
+    else if (format == "objc")
+        return FormatKind::ObjC;
+    else if (format == "python")
+        return FormatKind::Python;
+    else
+        return FormatKind::None;
+}
+
+
+// Arguments used by a format string, described by their types
+struct FormatArgs
+{
+    // positional arguments, in order; empty string for unused ones
+    std::vector<std::string> positional;
+    // named arguments (Python only)
+    std::map<std::wstring, std::string> named;
+};
+
+
+/// Reads "N$" argument number, if present
+bool ReadArgNumber(const std::wstring& s, size_t& i, unsigned& number)
+{
+    size_t j = i;
+    unsigned n = 0;
+    while (j < s.size() && s[j] >= '0' && s[j] <= '9')
+        n = n * 10 + (s[j++] - '0');
+
+    if (j == i || j == s.size() || s[j] != '$')
+        return false;
+
+    number = n;
+    i = j + 1;
+    return true;
+}
+
+inline void SkipDigits(const std::wstring& s, size_t& i)
+{
+    while (i < s.size() && s[i] >= '0' && s[i] <= '9')
+        i++;
+}
+
+
+/// Parses C (or Objective-C) format string the same way gettext does
+bool ParseCFormat(const std::wstring& s, bool objc, FormatArgs& out, wxString& reason)
+{
+    const size_t len = s.size();
+    unsigned directive = 0;
+    unsigned lastUnnumbered = 0;
+    bool usesNumbered = false, usesUnnumbered = false;
+
+    auto argNumber = [&](unsigned explicitNumber, unsigned& number) -> bool
+    {
+        if (explicitNumber)
+        {
+            usesNumbered = true;
+            number = explicitNumber;
+        }
+        else
+        {
+            usesUnnumbered = true;
+            number = ++lastUnnumbered;
+        }
+        if (usesNumbered && usesUnnumbered)
+        {
+            reason = _("The string refers to arguments both through absolute argument numbers and through unnumbered argument specifications.");
+            return false;
+        }
+        return true;
+    };
+
+    auto addArg = [&](unsigned explicitNumber, const std::string& type) -> bool
+    {
+        unsigned number;
+        if (!argNumber(explicitNumber, number))
+            return false;
+
+        if (out.positional.size() < number)
+            out.positional.resize(number);
+        auto& t = out.positional[number - 1];
+        if (!t.empty() && t != type)
+        {
+            reason.Printf(_("The string refers to argument number %u in incompatible ways."), number);
+            return false;
+        }
+        t = type;
+        return true;
+    };
+
+    auto readParamArg = [&](size_t& i) -> bool
+    {
+        // '*' width or precision, possibly with explicit argument number
+        unsigned number = 0;
+        if (ReadArgNumber(s, ++i, number) && number == 0)
+        {
+            reason.Printf(_("In the directive number %u, the argument number 0 is not a positive integer."), directive);
+            return false;
+        }
+        return addArg(number, "int");
+    };
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (s[i] != '%')
+            continue;
+
+        directive++;
+        if (++i == len)
+        {
+            reason = _("The string ends in the middle of a directive.");
+            return false;
+        }
+        if (s[i] == '%')
+            continue;
+
+        unsigned number = 0;
+        if (ReadArgNumber(s, i, number) && number == 0)
+        {
+            reason.Printf(_("In the directive number %u, the argument number 0 is not a positive integer."), directive);
+            return false;
+        }
+
+        // flags:
+        while (i < len && wxStrchr(L"-+ #0'I", s[i]))
+            i++;
+
+        // width:
+        if (i < len && s[i] == '*')
+        {
+            if (!readParamArg(i))
+                return false;
+        }
+        else
+        {
+            SkipDigits(s, i);
+        }
+
+        // precision:
+        if (i < len && s[i] == '.')
+        {
+            if (++i < len && s[i] == '*')
+            {
+                if (!readParamArg(i))
+                    return false;
+            }
+            else
+            {
+                SkipDigits(s, i);
+            }
+        }
+
+        // size:
+        std::string size;
+        while (i < len && wxStrchr(L"hlLqjzZt", s[i]))
+            size += (char)s[i++];
+
+        if (i == len)
+        {
+            reason = _("The string ends in the middle of a directive.");
+            return false;
+        }
+
+        std::string type;
+        switch (s[i])
+        {
+            case 'd': case 'i':
+                type = size + "int";
+                break;
+            case 'o': case 'u': case 'x': case 'X':
+                type = size + "unsigned";
+                break;
+            case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+                type = size + "double";
+                break;
+            case 'c':
+                type = size == "l" ? "wint" : "char";
+                break;
+            case 'C':
+                type = "wint";
+                break;
+            case 's':
+                type = size == "l" ? "wstring" : "string";
+                break;
+            case 'S':
+                type = "wstring";
+                break;
+            case 'p':
+                type = "pointer";
+                break;
+            case 'n':
+                type = size + "count";
+                break;
+            case '<':
+            {
+                // <inttypes.h> macros, e.g. "%<PRIu64>":
+                const size_t end = s.find('>', i);
+                if (end != std::wstring::npos && end - i > 4 && s.compare(i + 1, 3, L"PRI") == 0 && wxStrchr(L"dioxXu", s[i + 4]))
+                {
+                    type = str::to_utf8(s.substr(i + 5, end - i - 5)) + ((s[i + 4] == 'd' || s[i + 4] == 'i') ? "int" : "unsigned");
+                    i = end;
+                }
+                break;
+            }
+            case '@':
+                if (objc)
+                    type = "object";
+                break;
+            default:
+                break;
+        }
+
+        if (type.empty())
+        {
+            reason.Printf(_("In the directive number %u, the character '%c' is not a valid conversion specifier."), directive, s[i]);
+            return false;
+        }
+
+        if (!addArg(number, type))
+            return false;
+    }
+
+    for (size_t k = 0; k < out.positional.size(); k++)
+    {
+        if (out.positional[k].empty())
+        {
+            reason.Printf(_("The string refers to argument number %u but ignores argument number %u."), (unsigned)out.positional.size(), (unsigned)k + 1);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/// Parses Python %-style format string the same way gettext does
+bool ParsePythonFormat(const std::wstring& s, FormatArgs& out, wxString& reason)
+{
+    const size_t len = s.size();
+    unsigned directive = 0;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (s[i] != '%')
+            continue;
+
+        directive++;
+        if (++i == len)
+        {
+            reason = _("The string ends in the middle of a directive.");
+            return false;
+        }
+        if (s[i] == '%')
+            continue;
+
+        std::wstring name;
+        bool named = false;
+        if (s[i] == '(')
+        {
+            named = true;
+            int depth = 1;
+            size_t start = ++i;
+            for (; i < len; i++)
+            {
+                if (s[i] == '(')
+                    depth++;
+                else if (s[i] == ')' && --depth == 0)
+                    break;
+            }
+            if (i == len)
+            {
+                reason = _("The string ends in the middle of a directive.");
+                return false;
+            }
+            name = s.substr(start, i - start);
+            i++;
+        }
+
+        // flags:
+        while (i < len && wxStrchr(L"-+ #0", s[i]))
+            i++;
+
+        // width and precision:
+        for (int part = 0; part < 2 && i < len; part++)
+        {
+            if (part == 1)
+            {
+                if (s[i] != '.')
+                    break;
+                i++;
+            }
+
+            if (i < len && s[i] == '*')
+            {
+                i++;
+                if (named)
+                {
+                    reason = _("The string refers to arguments both through argument names and through unnamed argument specifications.");
+                    return false;
+                }
+                out.positional.push_back("int");
+            }
+            else
+            {
+                SkipDigits(s, i);
+            }
+        }
+
+        // size:
+        while (i < len && wxStrchr(L"hlL", s[i]))
+            i++;
+
+        if (i == len)
+        {
+            reason = _("The string ends in the middle of a directive.");
+            return false;
+        }
+
+        std::string type;
+        switch (s[i])
+        {
+            case 'c':
+                type = "char";
+                break;
+            case 's': case 'r': case 'a':
+                type = "any";
+                break;
+            case 'i': case 'd': case 'u': case 'o': case 'x': case 'X':
+                type = "int";
+                break;
+            case 'e': case 'E': case 'f': case 'F': case 'g': case 'G':
+                type = "float";
+                break;
+            default:
+                break;
+        }
+
+        if (type.empty())
+        {
+            reason.Printf(_("In the directive number %u, the character '%c' is not a valid conversion specifier."), directive, s[i]);
+            return false;
+        }
+
+        if (named)
+        {
+            auto existing = out.named.find(name);
+            if (existing != out.named.end() && existing->second != type)
+            {
+                reason.Printf(_("The string refers to the argument named '%s' in incompatible ways."), wxString(name));
+                return false;
+            }
+            out.named[name] = type;
+        }
+        else
+        {
+            out.positional.push_back(type);
+        }
+    }
+
+    if (!out.named.empty() && !out.positional.empty())
+    {
+        reason = _("The string refers to arguments both through argument names and through unnamed argument specifications.");
+        return false;
+    }
+
+    return true;
+}
+
+
+inline bool ParseFormat(FormatKind kind, const wxString& s, FormatArgs& out, wxString& reason)
+{
+    if (kind == FormatKind::Python)
+        return ParsePythonFormat(s.ToStdWstring(), out, reason);
+    else
+        return ParseCFormat(s.ToStdWstring(), kind == FormatKind::ObjC, out, reason);
+}
+
+
+/**
+    Compares arguments of msgid and msgstr format strings like gettext does.
+
+    If @a strict is false, the translation may omit some arguments (this is
+    used for plural forms such as "One file" for n=1).
+ */
+wxString CompareFormatArgs(const FormatArgs& id, const FormatArgs& str, bool strict, const wxString& idName, const wxString& strName)
+{
+    auto compatible = [strict](const std::string& a, const std::string& b)
+    {
+        return a == b || (!strict && (a == "any" || b == "any"));
+    };
+
+    if (!id.named.empty() && !str.positional.empty())
+        return wxString::Format(_(L"Format specifications in “%s” expect a mapping, those in “%s” expect a tuple."), idName, strName);
+    if (!id.positional.empty() && !str.named.empty())
+        return wxString::Format(_(L"Format specifications in “%s” expect a tuple, those in “%s” expect a mapping."), idName, strName);
+
+    for (auto& a: str.named)
+    {
+        auto i = id.named.find(a.first);
+        if (i == id.named.end())
+            return wxString::Format(_(L"A format specification for argument “%s”, as in “%s”, doesn’t exist in “%s”."), wxString(a.first), strName, idName);
+        if (!compatible(i->second, a.second))
+            return wxString::Format(_(L"Format specifications in “%s” and “%s” for argument “%s” are not the same."), idName, strName, wxString(a.first));
+    }
+    if (strict)
+    {
+        for (auto& a: id.named)
+        {
+            if (str.named.find(a.first) == str.named.end())
+                return wxString::Format(_(L"A format specification for argument “%s” doesn’t exist in “%s”."), wxString(a.first), strName);
+        }
+    }
+
+    const size_t count = std::max(id.positional.size(), str.positional.size());
+    for (size_t k = 0; k < count; k++)
+    {
+        const bool inId = k < id.positional.size();
+        const bool inStr = k < str.positional.size();
+        if (inId && inStr)
+        {
+            if (!compatible(id.positional[k], str.positional[k]))
+                return wxString::Format(_(L"Format specifications in “%s” and “%s” for argument %u are not the same."), idName, strName, unsigned(k + 1));
+        }
+        else if (inStr)
+        {
+            return wxString::Format(_(L"A format specification for argument %u, as in “%s”, doesn’t exist in “%s”."), unsigned(k + 1), strName, idName);
+        }
+        else if (strict)
+        {
+            return wxString::Format(_(L"A format specification for argument %u doesn’t exist in “%s”."), unsigned(k + 1), strName);
+        }
+    }
+
+    return wxString();
+}
+
+
+wxString CheckNewlines(const wxString& id, const wxString& str, const wxString& idName, const wxString& strName)
+{
+    const bool idBegins = !id.empty() && id[0] == '\n';
+    const bool idEnds = !id.empty() && id.Last() == '\n';
+    const bool strBegins = !str.empty() && str[0] == '\n';
+    const bool strEnds = !str.empty() && str.Last() == '\n';
+
+    if (idBegins != strBegins)
+        return wxString::Format(_(L"“%s” and “%s” entries do not both begin with “\\n”."), idName, strName);
+    if (idEnds != strEnds)
+        return wxString::Format(_(L"“%s” and “%s” entries do not both end with “\\n”."), idName, strName);
+    return wxString();
+}
+
+} // anonymous namespace
+
+
+POValidator::POValidator(Catalog& catalog) : m_nplurals(0)
+{
+    auto& header = catalog.Header();
+    if (!header.HasHeader("Plural-Forms"))
+    {
+        m_pluralFormsError = _("Required header Plural-Forms is missing.");
+        return;
+    }
+
+    m_pluralForms = PluralFormsExpr(header.GetHeader("Plural-Forms").utf8_string());
+    if (!m_pluralForms || m_pluralForms.nplurals() <= 0)
+    {
+        m_pluralFormsError.Printf(_("Syntax error in Plural-Forms header (\"%s\")."), m_pluralForms.str());
+        return;
+    }
+
+    // Find out which forms are used for more than one number; the translation
+    // may omit format arguments in the others (e.g. "One file" for n=1):
+    m_nplurals = m_pluralForms.nplurals();
+    std::vector<int> usage(m_nplurals, 0);
+    for (int n = 0; n < 1000; n++)
+    {
+        const int form = m_pluralForms.evaluate_for_n(n);
+        if (form < 0 || form >= m_nplurals)
+        {
+            m_pluralFormsError.Printf(_("Plural-Forms header specifies %d plural forms, but its expression can produce value %d."), m_nplurals, form);
+            m_nplurals = 0;
+            return;
+        }
+        usage[form]++;
+    }
+
+    for (auto u: usage)
+        m_pluralFormStrict.push_back(u > 1);
+}
+
+
+int POValidator::Check(const CatalogItemArray& items) const
+{
+    std::atomic<int> errors(0);
+
+    dispatch::parallel_for(items.size(), [&](size_t i)
+    {
+        if (CheckItem(*items[i]))
+            errors++;
+    });
+
+    return errors;
+}
+
+
+bool POValidator::CheckHeader(const CatalogItemArray& items) const
+{
+    if (m_pluralFormsError.empty())
+        return false;
+
+    // Like msgfmt, report problems with the Plural-Forms header on the first
+    // translated plural entry; they don't matter in files without plurals.
+    for (auto& i: items)
+    {
+        if (i->HasPlural() && !i->IsFuzzy() && !i->GetTranslation().empty())
+        {
+            i->SetIssue(CatalogItem::Issue::Error, m_pluralFormsError);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+bool POValidator::CheckItem(CatalogItem& item) const
+{
+    // msgfmt ignores fuzzy and untranslated entries:
+    if (item.IsFuzzy() || item.GetTranslation().empty())
+        return false;
+
+    const wxString& msgid = item.GetRawString();
+    const auto kind = GetFormatKind(item.GetFormatFlag());
+
+    wxString error;
+    if (!item.HasPlural())
+    {
+        error = CheckNewlines(msgid, item.GetTranslation(), "msgid", "msgstr");
+
+        if (error.empty() && kind != FormatKind::None)
+        {
+            FormatArgs idArgs, strArgs;
+            wxString reason;
+            if (ParseFormat(kind, msgid, idArgs, reason))
+            {
+                if (ParseFormat(kind, item.GetTranslation(), strArgs, reason))
+                    error = CompareFormatArgs(idArgs, strArgs, /*strict=*/true, "msgid", "msgstr");
+                else
+                    error.Printf(_(L"“%s” is not a valid format string, unlike “%s”. Reason: %s"), "msgstr", "msgid", reason);
+            }
+            // else: msgfmt doesn't complain about invalid msgid
+        }
+    }
+    else
+    {
+        const wxString& msgidPlural = item.GetRawPluralString();
+        const unsigned count = item.GetNumberOfTranslations();
+
+        if (m_nplurals > 0 && count > (unsigned)m_nplurals)
+        {
+            error.Printf(_("The translation has %u plural forms, but the Plural-Forms header specifies only %d."), count, m_nplurals);
+        }
+
+        if (error.empty())
+            error = CheckNewlines(msgid, msgidPlural, "msgid", "msgid_plural");
+
+        FormatArgs idArgs;
+        wxString reason;
+        const bool checkFormat = kind != FormatKind::None && ParseFormat(kind, msgidPlural, idArgs, reason);
+
+        for (unsigned i = 0; i < count && error.empty(); i++)
+        {
+            const wxString trans = item.GetTranslation(i);
+            const wxString transName = wxString::Format("msgstr[%u]", i);
+            error = CheckNewlines(msgid, trans, "msgid", transName);
+
+            if (error.empty() && checkFormat)
+            {
+                FormatArgs strArgs;
+                const bool strict = i >= m_pluralFormStrict.size() || m_pluralFormStrict[i];
+                if (ParseFormat(kind, trans, strArgs, reason))
+                    error = CompareFormatArgs(idArgs, strArgs, strict, "msgid_plural", transName);
+                else
+                    error.Printf(_(L"“%s” is not a valid format string, unlike “%s”. Reason: %s"), transName, "msgid_plural", reason);
+            }
+        }
+    }
+
+    if (error.empty())
+        return false;
+
+    item.SetIssue(CatalogItem::Issue::Error, error);
+    return true;
+}
+
+
+bool POValidator::NeedsExternalCheck(const CatalogItem& item)
+{
+    if (item.IsFuzzy() || item.GetTranslation().empty())
+        return false;
+
+    auto format = item.GetFormatFlag();
+    return !format.empty() && format.compare(0, 3, "no-") != 0 && GetFormatKind(format) == FormatKind::None;
+}
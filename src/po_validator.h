@@ -0,0 +1,75 @@
+/*
+ *  This file is part of Poedit (https://poedit.net)
+ *
+ *  Copyright (C) 2025 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef Poedit_po_validator_h
+#define Poedit_po_validator_h
+
+#include "catalog.h"
+#include "language.h"
+
+
+/**
+    Checks translations for errors that "msgfmt -c" reports.
+
+    Covers consistency of leading and trailing newlines, C, Objective-C and
+    Python format strings and plural forms. Works on catalog items directly,
+    without writing the catalog into a file first.
+ */
+class POValidator
+{
+public:
+    explicit POValidator(Catalog& catalog);
+
+    /**
+        Checks all items, in parallel, and sets their issues.
+
+        Returns number of items with errors.
+     */
+    int Check(const CatalogItemArray& items) const;
+
+    /**
+        Reports problems with the Plural-Forms header, if any, on the first
+        translated plural entry of @a items, which must be all items of the
+        catalog. Returns true if there's such problem.
+     */
+    bool CheckHeader(const CatalogItemArray& items) const;
+
+    /// Checks single item and sets its issue; returns true if there's an error.
+    bool CheckItem(CatalogItem& item) const;
+
+    /**
+        Returns true if the item uses format flag that isn't understood by
+        POValidator and must be checked by msgfmt to be fully validated.
+     */
+    static bool NeedsExternalCheck(const CatalogItem& item);
+
+private:
+    PluralFormsExpr m_pluralForms;
+    int m_nplurals;
+    std::vector<bool> m_pluralFormStrict;
+    wxString m_pluralFormsError;
+};
+
+#endif // Poedit_po_validator_h
@@ -0,0 +1,900 @@
+/*
+ *  This file is part of Poedit (https://poedit.net)
+ *
+ *  Copyright (C) 2025 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "po_writer.h"
+
+#include <unicode/uchar.h>
+
+#include <algorithm>
+#include <climits>
+
+
+namespace
+{
+
+// Default page width of gettext tools, used for references even if the
+// strings are not wrapped:
+const int DEFAULT_PAGE_WIDTH = 79;
+
+// Line breaking, done the same way as gettext does it with libunistring's
+// ulc_width_linebreaks(), i.e. using UAX #14 pair table and greedy filling
+// of lines up to the given width.
+
+enum BreakOpportunity : char
+{
+    BREAK_UNDEFINED,
+    BREAK_PROHIBITED,
+    BREAK_POSSIBLE,
+    BREAK_MANDATORY
+};
+
+// Line breaking classes; the order matters, it's used to index the pair table
+enum LineBreakClass
+{
+    LB_OP, LB_CL, LB_CP, LB_QU, LB_GL, LB_NS, LB_EX, LB_SY, LB_IS, LB_PR, LB_PO,
+    LB_NU, LB_AL, LB_ID, LB_IN, LB_HY, LB_BA, LB_BB, LB_B2, LB_ZW, LB_CM, LB_WJ,
+    // classes not in the pair table:
+    LB_SP, LB_BK, LB_HL
+};
+
+// UAX #14 pair table: '_' = direct break, '%' = indirect break (only if
+// separated by spaces), '^', '#', '@' = prohibited (combining marks are
+// handled separately)
+const char *LINE_BREAK_PAIRS[] =
+{
+    // OP CL CP QU GL NS EX SY IS PR PO NU AL ID IN HY BA BB B2 ZW CM WJ
+    "^^^^^^^^^^^^^^^^^^^^@^", // OP
+    "_^^%%^^^^%%____%%__^#^", // CL
+    "_^^%%^^^^%%%%__%%__^#^", // CP
+    "^^^%%%^^^%%%%%%%%%%^#^", // QU
+    "%^^%%%^^^%%%%%%%%%%^#^", // GL
+    "_^^%%%^^^______%%__^#^", // NS
+    "_^^%%%^^^_____%%%__^#^", // EX
+    "_^^%%%^^^__%___%%__^#^", // SY
+    "_^^%%%^^^__%%__%%__^#^", // IS
+    "%^^%%%^^^__%%%_%%__^#^", // PR
+    "%^^%%%^^^__%%__%%__^#^", // PO
+    "%^^%%%^^^%%%%_%%%__^#^", // NU
+    "%^^%%%^^^%%%%_%%%__^#^", // AL
+    "_^^%%%^^^_%___%%%__^#^", // ID
+    "_^^%%%^^^_____%%%__^#^", // IN
+    "_^^%_%^^^__%___%%__^#^", // HY
+    "_^^%_%^^^______%%__^#^", // BA
+    "%^^%%%^^^%%%%%%%%%%^#^", // BB
+    "_^^%%%^^^______%%_^^#^", // B2
+    "______________________", // ZW
+    "%^^%%%^^^%%%%_%%%__^#^", // CM
+    "%^^%%%^^^%%%%%%%%%%^#^", // WJ
+};
+
+LineBreakClass GetASCIILineBreakClass(wchar_t c)
+{
+    switch (c)
+    {
+        case ' ':  return LB_SP;
+        case '\t': return LB_BA;
+        case '\n': case '\r': case '\v': case '\f':
+                   return LB_BK;
+        case '!':  return LB_EX;
+        case '"':  return LB_QU;
+        case '$':  return LB_PR;
+        case '%':  return LB_PO;
+        case '\'': return LB_QU;
+        case '(':  return LB_OP;
+        case ')':  return LB_CP;
+        case '+':  return LB_PR;
+        case ',':  return LB_IS;
+        case '-':  return LB_HY;
+        case '.':  return LB_IS;
+        case '/':  return LB_SY;
+        case ':':  return LB_IS;
+        case ';':  return LB_IS;
+        case '?':  return LB_EX;
+        case '[':  return LB_OP;
+        case '\\': return LB_PR;
+        case ']':  return LB_CP;
+        case '{':  return LB_OP;
+        case '|':  return LB_BA;
+        case '}':  return LB_CL;
+        default:
+            if (c >= '0' && c <= '9')
+                return LB_NU;
+            if (c < 0x20 || c == 0x7F)
+                return LB_CM;
+            return LB_AL;
+    }
+}
+
+LineBreakClass GetLineBreakClass(UChar32 c)
+{
+    if (c < 0x80)
+        return GetASCIILineBreakClass((wchar_t)c);
+
+    switch (u_getIntPropertyValue(c, UCHAR_LINE_BREAK))
+    {
+        case U_LB_OPEN_PUNCTUATION:             return LB_OP;
+        case U_LB_CLOSE_PUNCTUATION:            return LB_CL;
+        case U_LB_CLOSE_PARENTHESIS:            return LB_CP;
+        case U_LB_QUOTATION:                    return LB_QU;
+        case U_LB_GLUE:                         return LB_GL;
+        case U_LB_NONSTARTER:
+        case U_LB_CONDITIONAL_JAPANESE_STARTER: return LB_NS;
+        case U_LB_EXCLAMATION:                  return LB_EX;
+        case U_LB_BREAK_SYMBOLS:                return LB_SY;
+        case U_LB_INFIX_NUMERIC:                return LB_IS;
+        case U_LB_PREFIX_NUMERIC:               return LB_PR;
+        case U_LB_POSTFIX_NUMERIC:              return LB_PO;
+        case U_LB_NUMERIC:                      return LB_NU;
+        case U_LB_IDEOGRAPHIC:
+        case U_LB_CONTINGENT_BREAK:
+        case U_LB_H2:
+        case U_LB_H3:
+        case U_LB_JL:
+        case U_LB_JV:
+        case U_LB_JT:                           return LB_ID;
+        case U_LB_INSEPARABLE:                  return LB_IN;
+        case U_LB_HYPHEN:                       return LB_HY;
+        case U_LB_HEBREW_LETTER:                return LB_HL;
+        case U_LB_BREAK_AFTER:                  return LB_BA;
+        case U_LB_BREAK_BEFORE:                 return LB_BB;
+        case U_LB_BREAK_BOTH:                   return LB_B2;
+        case U_LB_ZWSPACE:                      return LB_ZW;
+        case U_LB_COMBINING_MARK:               return LB_CM;
+        case U_LB_WORD_JOINER:                  return LB_WJ;
+        case U_LB_SPACE:                        return LB_SP;
+        case U_LB_MANDATORY_BREAK:
+        case U_LB_CARRIAGE_RETURN:
+        case U_LB_LINE_FEED:
+        case U_LB_NEXT_LINE:                    return LB_BK;
+        case U_LB_COMPLEX_CONTEXT:
+        {
+            auto type = u_charType(c);
+            return (type == U_NON_SPACING_MARK || type == U_COMBINING_SPACING_MARK) ? LB_CM : LB_AL;
+        }
+        default:                                return LB_AL;
+    }
+}
+
+// Number of columns the character occupies
+int GetCharWidth(UChar32 c)
+{
+    if (c < 0x300)
+        return (c < 0x20 || (c >= 0x7F && c < 0xA0)) ? 0 : 1;
+
+    auto type = u_charType(c);
+    if (type == U_NON_SPACING_MARK || type == U_ENCLOSING_MARK || type == U_FORMAT_CHAR)
+        return 0;
+
+    switch (u_getIntPropertyValue(c, UCHAR_EAST_ASIAN_WIDTH))
+    {
+        case U_EA_WIDE:
+        case U_EA_FULLWIDTH:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+// Decodes character at given position; returns 0 for the second half of surrogate pair
+inline UChar32 GetCodePoint(const std::wstring& s, size_t i)
+{
+    const UChar32 c = (UChar32)s[i];
+#if SIZEOF_WCHAR_T == 2 || defined(__WINDOWS__)
+    if (c >= 0xD800 && c <= 0xDBFF && i + 1 < s.size())
+    {
+        const UChar32 c2 = (UChar32)s[i + 1];
+        if (c2 >= 0xDC00 && c2 <= 0xDFFF)
+            return 0x10000 + ((c - 0xD800) << 10) + (c2 - 0xDC00);
+    }
+    else if (c >= 0xDC00 && c <= 0xDFFF && i > 0 && s[i - 1] >= 0xD800 && s[i - 1] <= 0xDBFF)
+    {
+        return 0;
+    }
+#endif
+    return c;
+}
+
+// Finds possible line breaks according to UAX #14, as libunistring does
+void FindPossibleLineBreaks(const std::wstring& s, std::vector<char>& p)
+{
+    const size_t len = s.size();
+    p.resize(len);
+
+    int lastClass = LB_BK; // class of the last non-space character
+    bool seenSpace = false; // was a space seen after the last non-space character?
+    bool lastHebrew = false; // was the last non-space character a Hebrew letter?
+    bool hebrewHyphen = false; // was it a hyphen following Hebrew letter?
+
+    for (size_t i = 0; i < len; i++)
+    {
+        const UChar32 c = GetCodePoint(s, i);
+        if (c == 0)
+        {
+            p[i] = BREAK_PROHIBITED; // inside surrogate pair
+            continue;
+        }
+
+        int cls = GetLineBreakClass(c);
+        const bool hebrew = (cls == LB_HL);
+        if (hebrew)
+            cls = LB_AL;
+
+        if (cls == LB_BK)
+        {
+            p[i] = BREAK_MANDATORY;
+            lastClass = LB_BK;
+            seenSpace = false;
+        }
+        else if (cls == LB_SP)
+        {
+            // don't break just before a space:
+            p[i] = BREAK_PROHIBITED;
+            seenSpace = true;
+        }
+        else if (cls == LB_ZW)
+        {
+            p[i] = BREAK_PROHIBITED;
+            lastClass = LB_ZW;
+            seenSpace = false;
+        }
+        else if (cls == LB_CM)
+        {
+            // don't break just before a combining character, except immediately after zero-width space:
+            if (lastClass == LB_ZW)
+            {
+                p[i] = BREAK_POSSIBLE;
+                lastClass = LB_AL;
+            }
+            else
+            {
+                p[i] = BREAK_PROHIBITED;
+            }
+        }
+        else
+        {
+            if (lastClass == LB_BK)
+            {
+                // don't break at the beginning of a line:
+                p[i] = BREAK_PROHIBITED;
+            }
+            else if (lastClass == LB_ZW)
+            {
+                p[i] = BREAK_POSSIBLE;
+            }
+            else if (hebrewHyphen && !seenSpace)
+            {
+                // don't break after hyphen in Hebrew (e.g. maqaf)
+                p[i] = BREAK_PROHIBITED;
+            }
+            else
+            {
+                switch (LINE_BREAK_PAIRS[lastClass][cls])
+                {
+                    case '_':
+                        p[i] = BREAK_POSSIBLE;
+                        break;
+                    case '%':
+                        p[i] = seenSpace ? BREAK_POSSIBLE : BREAK_PROHIBITED;
+                        break;
+                    default:
+                        p[i] = BREAK_PROHIBITED;
+                        break;
+                }
+            }
+            hebrewHyphen = lastHebrew && !seenSpace && (cls == LB_HY || cls == LB_BA);
+            lastHebrew = hebrew;
+            lastClass = cls;
+            seenSpace = false;
+        }
+    }
+}
+
+// Computes where to break the lines so that they don't exceed width columns;
+// BREAK_POSSIBLE in the output means the line should be broken before that
+// character. Works the same way as libunistring's ulc_width_linebreaks().
+void FindWidthLineBreaks(const std::wstring& s, const std::vector<char>& overrides,
+                         int width, int startColumn, std::vector<char>& p)
+{
+    FindPossibleLineBreaks(s, p);
+
+    const size_t len = s.size();
+    size_t lastBreak = std::wstring::npos;
+    int lastColumn = startColumn;
+    int pieceWidth = 0;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (overrides[i] != BREAK_UNDEFINED)
+            p[i] = overrides[i];
+
+        if (p[i] == BREAK_POSSIBLE || p[i] == BREAK_MANDATORY)
+        {
+            // an atomic piece of text ends here
+            if (lastBreak != std::wstring::npos && lastColumn + pieceWidth > width)
+            {
+                p[lastBreak] = BREAK_POSSIBLE;
+                lastColumn = 0;
+            }
+        }
+
+        if (p[i] == BREAK_MANDATORY)
+        {
+            lastBreak = std::wstring::npos;
+            lastColumn = 0;
+            pieceWidth = 0;
+        }
+        else
+        {
+            if (p[i] == BREAK_POSSIBLE)
+            {
+                // start a new piece
+                lastBreak = i;
+                lastColumn += pieceWidth;
+                pieceWidth = 0;
+            }
+
+            p[i] = BREAK_PROHIBITED;
+
+            const UChar32 c = GetCodePoint(s, i);
+            if (c != 0)
+                pieceWidth += GetCharWidth(c);
+        }
+    }
+
+    // the last atomic piece of text ends here
+    if (lastBreak != std::wstring::npos && lastColumn + pieceWidth > width)
+        p[lastBreak] = BREAK_POSSIBLE;
+}
+
+// If there's printf-style format directive at given position, returns its
+// length; gettext doesn't break lines inside of them.
+size_t GetPrintfDirectiveLength(wxString::const_iterator start, wxString::const_iterator end)
+{
+    auto i = start + 1;
+    if (i == end)
+        return 0;
+    if (*i == '%')
+        return 2;
+
+    auto skipDigits = [&i, end]{ while (i != end && *i >= '0' && *i <= '9') ++i; };
+    auto skipArgNumber = [&i, end, &skipDigits]
+    {
+        auto saved = i;
+        skipDigits();
+        if (i != saved && i != end && *i == '$')
+            ++i;
+        else
+            i = saved;
+    };
+
+    skipArgNumber();
+    while (i != end && (*i == '-' || *i == '+' || *i == ' ' || *i == '#' || *i == '0' || *i == '\''))
+        ++i;
+    if (i != end && *i == '*')
+    {
+        ++i;
+        skipArgNumber();
+    }
+    else
+    {
+        skipDigits();
+    }
+    if (i != end && *i == '.')
+    {
+        ++i;
+        if (i != end && *i == '*')
+        {
+            ++i;
+            skipArgNumber();
+        }
+        else
+        {
+            skipDigits();
+        }
+    }
+    while (i != end && wxStrchr(wxS("hlLqjztI"), (wchar_t)*i))
+        ++i;
+    if (i == end || !wxStrchr(wxS("diouxXeEfFgGaAcsCSpn@"), (wchar_t)*i))
+        return 0;
+
+    return (i - start) + 1;
+}
+
+// Same as GetPrintfDirectiveLength(), for Python's %-directives, e.g. "%(name)s"
+size_t GetPythonDirectiveLength(wxString::const_iterator start, wxString::const_iterator end)
+{
+    auto i = start + 1;
+    if (i != end && *i == '(')
+    {
+        int depth = 0;
+        for (; i != end; ++i)
+        {
+            if (*i == '(')
+                depth++;
+            else if (*i == ')' && --depth == 0)
+                break;
+        }
+        if (i == end)
+            return 0;
+        ++i;
+    }
+
+    auto skipDigits = [&i, end]{ while (i != end && *i >= '0' && *i <= '9') ++i; };
+
+    while (i != end && (*i == '-' || *i == '+' || *i == ' ' || *i == '#' || *i == '0'))
+        ++i;
+    if (i != end && *i == '*')
+        ++i;
+    else
+        skipDigits();
+    if (i != end && *i == '.')
+    {
+        ++i;
+        if (i != end && *i == '*')
+            ++i;
+        else
+            skipDigits();
+    }
+    while (i != end && (*i == 'h' || *i == 'l' || *i == 'L'))
+        ++i;
+    if (i == end || !wxStrchr(wxS("%csraiduoxXeEfFgG"), (wchar_t)*i))
+        return 0;
+
+    return (i - start) + 1;
+}
+
+// Same as GetPrintfDirectiveLength(), for Python's str.format() fields, e.g.
+// "{0}" or "{name:>{width}}", which may contain one level of nested fields
+size_t GetPythonBraceDirectiveLength(wxString::const_iterator start, wxString::const_iterator end)
+{
+    bool inSpec = false;
+    int depth = 0;
+    for (auto i = start; i != end; ++i)
+    {
+        switch ((wchar_t)*i)
+        {
+            case '{':
+                if (depth > 0 && !inSpec)
+                    return 0; // braces only allowed in format spec
+                if (++depth > 2)
+                    return 0;
+                break;
+            case '}':
+                if (--depth == 0)
+                    return (i - start) + 1;
+                break;
+            case ':':
+                if (depth == 1)
+                    inSpec = true;
+                break;
+            case '\n':
+                return 0;
+            default:
+                break;
+        }
+    }
+    return 0;
+}
+
+// If there's format directive in given syntax at the position, returns its
+// length. Also returns length of escaped literal characters (e.g. "{{"),
+// which can't be mistaken for a start of directive, with @a isDirective=false.
+size_t GetDirectiveLength(POWriter::FormatSyntax format,
+                          wxString::const_iterator start, wxString::const_iterator end,
+                          bool& isDirective)
+{
+    isDirective = true;
+    switch (format)
+    {
+        case POWriter::FormatSyntax::Printf:
+            return *start == '%' ? GetPrintfDirectiveLength(start, end) : 0;
+
+        case POWriter::FormatSyntax::Python:
+            return *start == '%' ? GetPythonDirectiveLength(start, end) : 0;
+
+        case POWriter::FormatSyntax::PythonBrace:
+            if (*start != '{' && *start != '}')
+                return 0;
+            if (start + 1 != end && *(start + 1) == *start)
+            {
+                isDirective = false;
+                return 2;
+            }
+            return *start == '{' ? GetPythonBraceDirectiveLength(start, end) : 0;
+
+        case POWriter::FormatSyntax::None:
+        case POWriter::FormatSyntax::Unrecognized:
+            return 0;
+    }
+    return 0;
+}
+
+// Is this a special comment (e.g. "#.") rather than translator's one?
+inline bool IsSpecialCommentChar(wxUniChar c)
+{
+    return c == '.' || c == ':' || c == ',' || c == '|' || c == '~';
+}
+
+inline int GetTextWidth(const std::wstring& s)
+{
+    int w = 0;
+    for (size_t i = 0; i < s.size(); i++)
+    {
+        const wchar_t c = s[i];
+        if (c >= 0x20 && c < 0x7F)
+            w++;
+        else if (auto cp = GetCodePoint(s, i))
+            w += GetCharWidth(cp);
+    }
+    return w;
+}
+
+// Length of the string in UTF-8, which is how gettext measures references
+inline int GetUTF8Length(const wxString& s)
+{
+    int len = 0;
+    for (auto i = s.wc_str(); *i; ++i)
+    {
+        const unsigned c = (unsigned)*i;
+        if (c < 0x80)
+            len += 1;
+        else if (c < 0x800 || (c >= 0xD800 && c <= 0xDFFF))
+            len += 2; // surrogates: 2 units in the pair, 4 bytes in total
+        else if (c < 0x10000)
+            len += 3;
+        else
+            len += 4;
+    }
+    return len;
+}
+
+} // anonymous namespace
+
+
+POWriter::FormatSyntax POWriter::GetFormatSyntax(const std::vector<wxString>& flags)
+{
+    // Formats in the order gettext checks them in; the first one with
+    // "X-format" or "possible-X-format" flag determines the directives.
+    // Formats that aren't listed come before PHP in gettext's order.
+    static const struct
+    {
+        const wchar_t *name;
+        FormatSyntax syntax;
+    } s_formats[] =
+    {
+        { L"c",             FormatSyntax::Printf },
+        { L"objc",          FormatSyntax::Printf },
+        { L"python",        FormatSyntax::Python },
+        { L"python-brace",  FormatSyntax::PythonBrace },
+        { nullptr,          FormatSyntax::Unrecognized },
+        { L"php",           FormatSyntax::Printf },
+    };
+
+    size_t best = WXSIZEOF(s_formats);
+
+    for (auto& flag: flags)
+    {
+        if (!flag.EndsWith(wxS("-format")) || flag.StartsWith(wxS("no-")))
+            continue;
+
+        wxString name = flag.Left(flag.length() - 7);
+        if (name.StartsWith(wxS("possible-")))
+            name.erase(0, 9);
+
+        size_t i = 0, other = 0;
+        for (; i < WXSIZEOF(s_formats); i++)
+        {
+            if (!s_formats[i].name)
+                other = i;
+            else if (name == s_formats[i].name)
+                break;
+        }
+        best = std::min(best, i < WXSIZEOF(s_formats) ? i : other);
+    }
+
+    return best < WXSIZEOF(s_formats) ? s_formats[best].syntax : FormatSyntax::None;
+}
+
+
+POWriter::POWriter(wxTextFileType crlf, int width, size_t sizeHint)
+    : m_eol(crlf == wxTextFileType_Dos ? wxS("\r\n") : wxS("\n")),
+      m_width(width),
+      m_lineCount(0),
+      m_unrecognizedWrapping(false)
+{
+    // gettext doesn't allow narrower pages either:
+    if (m_width > 0 && m_width < 20)
+        m_width = 20;
+
+    if (sizeHint)
+        m_buffer.reserve(sizeHint);
+}
+
+
+void POWriter::AddLine(const wxString& line)
+{
+    m_buffer += line;
+    EndLine();
+}
+
+
+void POWriter::AddEmptyLine()
+{
+    EndLine();
+}
+
+
+void POWriter::AddComment(const wxString& comment)
+{
+    wxString::const_iterator last = comment.begin();
+    for (wxString::const_iterator i = comment.begin(); ; ++i)
+    {
+        if (i != comment.end() && *i != '\n')
+            continue;
+
+        wxString line(last, i);
+        if (!line.empty() || i != comment.end())
+        {
+            // Normalize the comment the way gettext does: the first space after
+            // '#' is not part of the comment and it is always written when the
+            // comment is not empty.
+            if (line.empty() || line[0] != '#')
+            {
+                m_buffer += wxS("# ");
+                m_buffer += line;
+            }
+            else if (line.length() >= 2 && IsSpecialCommentChar(line[1]))
+            {
+                m_buffer += line;
+            }
+            else
+            {
+                m_buffer += '#';
+                const size_t start = (line.length() >= 2 && line[1] == ' ') ? 2 : 1;
+                if (start < line.length())
+                {
+                    m_buffer += ' ';
+                    m_buffer.append(line, start, wxString::npos);
+                }
+            }
+            EndLine();
+        }
+
+        if (i == comment.end())
+            break;
+        last = i + 1;
+    }
+}
+
+
+void POWriter::AddExtractedComment(const wxString& comment)
+{
+    m_buffer += wxS("#.");
+    if (!comment.empty())
+    {
+        m_buffer += ' ';
+        m_buffer += comment;
+    }
+    EndLine();
+}
+
+
+void POWriter::AddReferences(const wxArrayString& references)
+{
+    if (references.empty())
+        return;
+
+    const int width = m_width > 0 ? m_width : DEFAULT_PAGE_WIDTH;
+
+    // gettext ignores repeated occurrences of the same reference
+    std::vector<wxString> seen;
+    seen.reserve(references.size());
+
+    m_buffer += wxS("#:");
+    int column = 2;
+    for (auto& ref: references)
+    {
+        if (std::find(seen.begin(), seen.end(), ref) != seen.end())
+            continue;
+        seen.push_back(ref);
+
+        // filenames with spaces are enclosed in Unicode isolates:
+        wxString text;
+        if (ref.find_first_of(wxS(" \t")) != wxString::npos)
+            text << wxUniChar(0x2068) << ref << wxUniChar(0x2069);
+        else
+            text = ref;
+
+        const int len = GetUTF8Length(text) + 1;
+        if (column > 2 && column + len > width)
+        {
+            EndLine();
+            m_buffer += wxS("#:");
+            column = 2;
+        }
+        m_buffer += ' ';
+        m_buffer += text;
+        column += len;
+    }
+    EndLine();
+}
+
+
+void POWriter::AddFlags(const std::vector<wxString>& flags)
+{
+    if (flags.empty())
+        return;
+
+    m_buffer += wxS("#,");
+    for (size_t i = 0; i < flags.size(); i++)
+    {
+        m_buffer += (i == 0) ? wxS(" ") : wxS(", ");
+        m_buffer += flags[i];
+    }
+    EndLine();
+}
+
+
+void POWriter::AddString(const wxString& keyword, const wxString& value, bool wrap, FormatSyntax format, const wxString& linePrefix)
+{
+    // Port of the wrap() function from gettext's write-po.c, the output must be identical.
+
+    // Allow room for the opening and closing quotes and line prefix on every line:
+    const bool wrapping = wrap && m_width > 0;
+    const int width = wrapping ? m_width - 2 - (int)linePrefix.length() : INT_MAX;
+
+    const wxString::const_iterator end = value.end();
+    wxString::const_iterator s = value.begin();
+    bool firstLine = true;
+
+    // Loop over the '\n' delimited portions of value:
+    do
+    {
+        wxString::const_iterator es = std::find(s, end, '\n');
+        if (es != end)
+            ++es;
+
+        // Expand escape sequences in the portion:
+        m_portion.clear();
+        m_overrides.clear();
+        size_t skipRemaining = 0;
+        bool skippingDirective = false;
+        for (auto i = s; i != es; ++i)
+        {
+            const wchar_t c = *i;
+
+            bool insideDirective = false;
+            if (skipRemaining)
+            {
+                insideDirective = skippingDirective;
+                skipRemaining--;
+            }
+            else if (format != FormatSyntax::None)
+            {
+                if (auto len = GetDirectiveLength(format, i, es, skippingDirective))
+                    skipRemaining = len - 1;
+            }
+
+            const char *escaped = nullptr;
+            switch (c)
+            {
+                case '\a': escaped = "\\a"; break;
+                case '\b': escaped = "\\b"; break;
+                case '\f': escaped = "\\f"; break;
+                case '\n': escaped = "\\n"; break;
+                case '\r': escaped = "\\r"; break;
+                case '\t': escaped = "\\t"; break;
+                case '\v': escaped = "\\v"; break;
+                case '\\': escaped = "\\\\"; break;
+                case '"':  escaped = "\\\""; break;
+                default:   break;
+            }
+
+            if (escaped)
+            {
+                // escape sequences can't be broken; line may be broken before
+                // escaped quote or backslash, but never before control characters
+                m_portion += escaped[0];
+                m_portion += escaped[1];
+                m_overrides.push_back((c == '\\' || c == '"') && !insideDirective ? BREAK_UNDEFINED : BREAK_PROHIBITED);
+                m_overrides.push_back(BREAK_PROHIBITED);
+            }
+            else
+            {
+                m_portion += c;
+                m_overrides.push_back(insideDirective ? BREAK_PROHIBITED : BREAK_UNDEFINED);
+            }
+        }
+
+        const bool morePortions = (es != end);
+        bool hasBreaks = false;
+        int startColumn;
+
+        for (;;)
+        {
+            startColumn = firstLine ? (int)keyword.length() + 1 : 0;
+            hasBreaks = false;
+
+            // Compute line breaks, but only if the portion doesn't fit on the line
+            // entirely, which is the most common case:
+            if (wrapping && !m_portion.empty() && startColumn + GetTextWidth(m_portion) > width)
+            {
+                FindWidthLineBreaks(m_portion, m_overrides, width, startColumn, m_breaks);
+                hasBreaks = std::find(m_breaks.begin(), m_breaks.end(), BREAK_POSSIBLE) != m_breaks.end();
+                if (hasBreaks && format == FormatSyntax::Unrecognized)
+                    m_unrecognizedWrapping = true;
+            }
+
+            // If this is the first line and the value would wrap, use an empty
+            // first line and recompute the breaks:
+            if (firstLine && !m_portion.empty() && (morePortions || startColumn > width || hasBreaks))
+            {
+                m_buffer += linePrefix;
+                m_buffer += keyword;
+                m_buffer += wxS(" \"\"");
+                EndLine();
+                firstLine = false;
+                continue;
+            }
+            break;
+        }
+
+        // Print the portion itself, with line breaks where necessary:
+        m_buffer += linePrefix;
+        if (firstLine)
+        {
+            m_buffer += keyword;
+            m_buffer += ' ';
+            firstLine = false;
+        }
+        m_buffer += '"';
+        if (hasBreaks)
+        {
+            size_t last = 0;
+            for (size_t i = 0; i < m_portion.size(); i++)
+            {
+                if (m_breaks[i] == BREAK_POSSIBLE)
+                {
+                    m_buffer.append(wxString(m_portion.substr(last, i - last)));
+                    m_buffer += '"';
+                    EndLine();
+                    m_buffer += linePrefix;
+                    m_buffer += '"';
+                    last = i;
+                }
+            }
+            m_buffer.append(wxString(m_portion.substr(last)));
+        }
+        else
+        {
+            m_buffer += wxString(m_portion);
+        }
+        m_buffer += '"';
+        EndLine();
+
+        s = es;
+    }
+    while (s != end);
+}
@@ -0,0 +1,130 @@
+/*
+ *  This file is part of Poedit (https://poedit.net)
+ *
+ *  Copyright (C) 2025 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef Poedit_po_writer_h
+#define Poedit_po_writer_h
+
+#include <wx/string.h>
+#include <wx/arrstr.h>
+#include <wx/textbuf.h>
+
+#include <string>
+#include <vector>
+
+
+/**
+    Formats content of PO files into a single in-memory buffer.
+
+    The output is formatted the same way GNU gettext tools (msgcat, msgmerge)
+    format it, including their line wrapping of strings and references.
+ */
+class POWriter
+{
+public:
+    /// Syntax of format string directives, which gettext doesn't break lines inside of
+    enum class FormatSyntax
+    {
+        None,
+        Printf,         ///< printf-like, e.g. c-format, objc-format or php-format
+        Python,         ///< python-format, e.g. %(name)s
+        PythonBrace,    ///< python-brace-format, e.g. {name}
+        Unrecognized    ///< some other format, directives of which aren't recognized
+    };
+
+    /// Returns syntax of directives of an entry with given flags, chosen as gettext does
+    static FormatSyntax GetFormatSyntax(const std::vector<wxString>& flags);
+
+    /**
+        Creates the writer.
+
+        @param crlf      Line endings to use.
+        @param width     Maximum width of lines; 0 or negative value disables
+                         wrapping of strings.
+        @param sizeHint  Expected size of the output, for preallocation.
+     */
+    POWriter(wxTextFileType crlf, int width, size_t sizeHint = 0);
+
+    /// Adds line of text verbatim.
+    void AddLine(const wxString& line);
+
+    /// Adds empty line, i.e. entries separator.
+    void AddEmptyLine();
+
+    /// Adds translator's comment, in raw form with leading '#' on every line.
+    void AddComment(const wxString& comment);
+
+    /// Adds extracted comment ("#.") line.
+    void AddExtractedComment(const wxString& comment);
+
+    /// Adds "#:" lines with given references, reflowed as gettext does.
+    void AddReferences(const wxArrayString& references);
+
+    /// Adds "#," line with given flags, if there are any.
+    void AddFlags(const std::vector<wxString>& flags);
+
+    /**
+        Adds keyword with quoted and escaped value, e.g. msgid "foo".
+
+        @param wrap          Whether long values may be wrapped.
+        @param format        Syntax of format directives in the value, if
+                             any; lines are not broken inside directives.
+        @param linePrefix    Prefix of all output lines, e.g. "#| ".
+     */
+    void AddString(const wxString& keyword, const wxString& value,
+                   bool wrap = true, FormatSyntax format = FormatSyntax::None,
+                   const wxString& linePrefix = wxString());
+
+    /// Returns number of lines written so far.
+    unsigned GetLineCount() const { return m_lineCount; }
+
+    /**
+        Returns true if a string in FormatSyntax::Unrecognized format had to
+        be wrapped. Its line breaks may then differ from gettext's, because
+        they weren't kept out of its directives.
+     */
+    bool HasUnrecognizedWrapping() const { return m_unrecognizedWrapping; }
+
+    /// Returns formatted content.
+    const wxString& GetText() const { return m_buffer; }
+
+private:
+    void EndLine()
+    {
+        m_buffer += m_eol;
+        m_lineCount++;
+    }
+
+    wxString m_buffer;
+    wxString m_eol;
+    int m_width;
+    unsigned m_lineCount;
+    bool m_unrecognizedWrapping;
+
+    // reused buffers for AddString():
+    std::wstring m_portion;
+    std::vector<char> m_overrides, m_breaks;
+};
+
+#endif // Poedit_po_writer_h
@@ -494,6 +494,7 @@ private:
         static wxWindowIDRef idLearn = NewControlId();
         static wxWindowIDRef idImportTMX = NewControlId();
         static wxWindowIDRef idExportTMX = NewControlId();
+        static wxWindowIDRef idCompact = NewControlId();
         static wxWindowIDRef idReset = NewControlId();
 
         wxMenu menu;
@@ -505,12 +506,14 @@ private:
         menu.Append(idImportTMX, MSW_OR_OTHER(_(L"Import from TMX…"), _(L"Import From TMX…")));
         menu.Append(idExportTMX, MSW_OR_OTHER(_(L"Export to TMX…"), _(L"Export To TMX…")));
         menu.AppendSeparator();
+        menu.Append(idCompact, MSW_OR_OTHER(_(L"Compact database"), _(L"Compact Database")));
         // TRANSLATORS: This is a button that deletes everything in the translation memory (i.e. clears/resets it).
         menu.Append(idReset, _("Reset"));
 
         menu.Bind(wxEVT_MENU, &TMPageWindow::OnImportIntoTM, this, idLearn);
         menu.Bind(wxEVT_MENU, &TMPageWindow::OnImportTMX, this, idImportTMX);
         menu.Bind(wxEVT_MENU, &TMPageWindow::OnExportTMX, this, idExportTMX);
+        menu.Bind(wxEVT_MENU, &TMPageWindow::OnCompactTM, this, idCompact);
         menu.Bind(wxEVT_MENU, &TMPageWindow::OnResetTM, this, idReset);
 
         auto win = dynamic_cast<wxButton*>(e.GetEventObject());
@@ -666,6 +669,23 @@ private:
         }
     }
 
+    void OnCompactTM(wxCommandEvent&)
+    {
+        wxWindowPtr<ProgressWindow> progress(new ProgressWindow(this, _(L"Compacting translation memory…")));
+        progress->SetErrorMessage(_("Compacting translation memory failed."));
+        progress->RunTaskModal([=]() -> BackgroundTaskResult
+        {
+            auto results = TranslationMemory::Get().Compact();
+
+            BackgroundTaskResult summary(_("The translation memory was compacted."));
+            summary.details.emplace_back(_("Duplicate translations removed:"), wxNumberFormatter::ToString((long)results.removedDocs));
+            summary.details.emplace_back(_("Disk space reclaimed:"), wxFileName::GetHumanReadableSize(results.reclaimedBytes, "0", 1, wxSIZE_CONV_SI));
+            return summary;
+        });
+
+        UpdateStats();
+    }
+
     void OnResetTM(wxCommandEvent&)
     {
         auto title = _("Reset translation memory");
@@ -42,6 +42,9 @@
 #include <wx/sizer.h>
 #include <wx/windowptr.h>
 
+#include <algorithm>
+#include <thread>
+
 
 namespace
 {
@@ -128,55 +131,122 @@ Stats PreTranslateCatalogImpl(CatalogPtr catalog, const T& range, PreTranslateOp
         return res.IsExactMatch() ? ResType::Exact : ResType::Fuzzy;
     };
 
-    std::vector<dispatch::future<ResType>> operations;
+    // Items are looked up in batches, because TranslationMemory::SearchBatch()
+    // searches for repeated source strings only once and reuses the same
+    // database snapshot and queries for the whole batch. Batches are also
+    // the units of work distributed to workers:
+    const size_t BATCH_SIZE = 200;
+
+    auto items = std::make_shared<std::vector<CatalogItemPtr>>();
     for (auto dt: range)
     {
         if (dt->IsTranslated() && !dt->IsFuzzy())
             continue;
+        items->push_back(dt);
+    }
+
+    const size_t batchesCount = (items->size() + BATCH_SIZE - 1) / BATCH_SIZE;
+
+    // Function to look up one batch of items in the TM and apply the results:
+    auto translate_batch = [=,&tm](size_t batch) -> std::vector<ResType>
+    {
+        const size_t batchStart = batch * BATCH_SIZE;
+        const size_t batchEnd = std::min(items->size(), batchStart + BATCH_SIZE);
+
+        std::vector<std::wstring> sources;
+        sources.reserve(batchEnd - batchStart);
+        for (size_t i = batchStart; i < batchEnd; i++)
+            sources.push_back(str::to_wstring((*items)[i]->GetString()));
+
+        auto results = tm.SearchBatch(srclang, lang, sources);
+
+        std::vector<ResType> batchResults;
+        batchResults.reserve(batchEnd - batchStart);
+        std::vector<CatalogItemPtr> plurals;
+        std::vector<std::wstring> pluralSources;
+
+        for (size_t i = batchStart; i < batchEnd; i++)
+        {
+            auto dt = (*items)[i];
+            auto rt = process_results(dt, 0, results[i - batchStart]);
+            batchResults.push_back(rt);
+
+            // Only "simple" English-like plurals are supported; with nplurals=1,
+            // there's nothing else to do:
+            if (translated(rt) && dt->HasPlural() && lang.nplurals() == 2)
+            {
+                plurals.push_back(dt);
+                pluralSources.push_back(str::to_wstring(dt->GetPluralString()));
+            }
+        }
 
-        operations.push_back(dispatch::async([=,&tm]() -> ResType
+        if (!plurals.empty())
         {
-            if (cancellation_token->is_cancelled())
-                return {};
+            auto results_plural = tm.SearchBatch(srclang, lang, pluralSources);
+            for (size_t i = 0; i < plurals.size(); i++)
+                process_results(plurals[i], 1, results_plural[i]);
+        }
+
+        return batchResults;
+    };
 
-            auto results = tm.Search(srclang, lang, str::to_wstring(dt->GetString()));
-            auto rt = process_results(dt, 0, results);
+    // Run a bounded number of workers instead of a task per batch, so that
+    // huge catalogs don't flood the background queue:
+    size_t workersCount = options.parallelism > 0 ? options.parallelism : std::thread::hardware_concurrency();
+    workersCount = std::min(std::max<size_t>(1, workersCount), batchesCount);
 
-            if (translated(rt) && dt->HasPlural())
+    auto pipeline = std::make_shared<dispatch::bounded_pipeline<std::vector<ResType>>>(batchesCount, 2 * workersCount);
+
+    std::vector<dispatch::future<void>> workers;
+    for (size_t w = 0; w < workersCount; w++)
+    {
+        workers.push_back(dispatch::async([=]()
+        {
+            try
             {
-                switch (lang.nplurals())
+                size_t batch;
+                while (pipeline->next_batch(batch))
                 {
-                    case 2:  // "simple" English-like plurals
-                    {
-                        auto results_plural = tm.Search(srclang, lang, str::to_wstring(dt->GetPluralString()));
-                        process_results(dt, 1, results_plural);
-                    }
-                    case 1:  // nothing else to do
-                    default: // not supported
-                        break;
+                    if (cancellation_token->is_cancelled())
+                        return;
+                    if (!pipeline->push(translate_batch(batch)))
+                        return;
                 }
             }
-
-            return rt;
+            catch (...)
+            {
+                pipeline->fail(std::current_exception());
+            }
         }));
     }
 
-    Progress progress((int)operations.size());
+    Progress progress((int)items->size());
     progress.message(_(L"Pre-translating from translation memory…"));
 
     Stats stats;
-    for (auto& op: operations)
+    try
     {
-        if (cancellation_token->is_cancelled())
-            break;
+        std::vector<ResType> batchResults;
+        for (size_t done = 0; done < batchesCount; done++)
+        {
+            if (!pipeline->pop(batchResults, *cancellation_token))
+                break;
 
-        auto rt = op.get();
-        stats.add(rt);
-        if (translated(rt))
-            progress.message(wxString::Format(wxPLURAL("Pre-translated %u string", "Pre-translated %u strings", stats.matched), stats.matched));
+            const int matchedBefore = stats.matched;
+            for (auto rt: batchResults)
+                stats.add(rt);
+            if (stats.matched > matchedBefore)
+                progress.message(wxString::Format(wxPLURAL("Pre-translated %u string", "Pre-translated %u strings", stats.matched), stats.matched));
 
-        progress.increment();
+            progress.increment((int)batchResults.size());
+        }
+    }
+    catch (...)
+    {
+        pipeline->stop();
+        throw;
     }
+    pipeline->stop();
 
     return stats;
 }
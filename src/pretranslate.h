@@ -45,10 +45,13 @@ enum PreTranslateFlags
 /// Options passed to pre-translation functions
 struct PreTranslateOptions
 {
-    explicit PreTranslateOptions(int flags_ = 0) : flags(flags_) {}
+    explicit PreTranslateOptions(int flags_ = 0) : flags(flags_), parallelism(0) {}
 
     /// Flags, a combination of PreTranslateFlags values
     int flags;
+
+    /// Max. number of batches looked up in TM in parallel, 0 for one per CPU core
+    int parallelism;
 };
 
 /**
@@ -25,8 +25,10 @@
 
 #include "qa_checks.h"
 
+#include "concurrency.h"
 #include "syntaxhighlighter.h"
 
+#include <numeric>
 #include <regex>
 #include <set>
 #include <unicode/uchar.h>
@@ -556,8 +558,13 @@ QAChecker::~QAChecker()
 
 std::shared_ptr<QAChecker> QAChecker::GetFor(Catalog& catalog)
 {
-    auto lang = catalog.GetLanguage();
+    return CreateFor(catalog.GetLanguage());
+}
+
+std::shared_ptr<QAChecker> QAChecker::CreateFor(Language lang)
+{
     auto c = std::make_shared<QAChecker>();
+    c->m_language = lang;
 
     #define qa_instantiate(klass) c->AddCheck<klass>(lang);
     QA_ENUM_ALL_CHECKS(qa_instantiate);
@@ -579,12 +586,38 @@ std::vector<std::pair<std::string, wxString>> QAChecker::GetMetadata()
 
 int QAChecker::Check(Catalog& catalog)
 {
-    int issues = 0;
+    return Check(catalog.items());
+}
 
-    for (auto& i: catalog.items())
-        issues += Check(i);
 
-    return issues;
+int QAChecker::Check(const CatalogItemArray& items)
+{
+    // shards are small enough to balance load well, but big enough for the cost
+    // of creating checks instances to be negligible:
+    const size_t SHARD_SIZE = 256;
+
+    if (items.size() <= SHARD_SIZE || !m_language)
+    {
+        int issues = 0;
+        for (auto& i: items)
+            issues += Check(i);
+        return issues;
+    }
+
+    // Every item is only touched by a single shard and per-shard counts are
+    // summed in shard order, so the results don't depend on scheduling:
+    const size_t shards = (items.size() + SHARD_SIZE - 1) / SHARD_SIZE;
+    std::vector<int> issues(shards, 0);
+
+    dispatch::parallel_for(shards, [&](size_t shard)
+    {
+        auto checker = CreateFor(*m_language);
+        const size_t end = std::min(items.size(), (shard + 1) * SHARD_SIZE);
+        for (size_t i = shard * SHARD_SIZE; i < end; i++)
+            issues[shard] += checker->Check(items[i]);
+    }, /*chunkSize=*/1);
+
+    return std::accumulate(issues.begin(), issues.end(), 0);
 }
 
 
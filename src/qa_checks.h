@@ -29,6 +29,7 @@
 #include "catalog.h"
 
 #include <memory>
+#include <optional>
 #include <vector>
 
 
@@ -70,6 +71,14 @@ public:
     /// Checks all items. Returns # of issues found.
     int Check(Catalog& catalog);
 
+    /**
+        Checks given subset of items. Returns # of issues found.
+
+        Large arrays are split into shards of consecutive items that are
+        checked in parallel, each shard with its own instances of the checks.
+     */
+    int Check(const CatalogItemArray& items);
+
     /// Check a single item. Returns # of issues found.
     int Check(CatalogItemPtr item);
 
@@ -91,8 +100,15 @@ private:
     template<typename TCheck>
     bool IsCheckEnabled() const { return true; }
 
+    /// Creates checker with all standard checks for @a lang
+    static std::shared_ptr<QAChecker> CreateFor(Language lang);
+
 protected:
     std::vector<std::shared_ptr<QACheck>> m_checks;
+
+    // language of standard checks set up by GetFor(), used to create
+    // independent instances for parallel checking; unset for custom setups
+    std::optional<Language> m_language;
 };
 
 #endif // Poedit_qa_checks_h
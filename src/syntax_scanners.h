@@ -0,0 +1,444 @@
+/*
+ *  This file is part of Poedit (https://poedit.net)
+ *
+ *  Copyright (C) 2025 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef Poedit_syntax_scanners_h
+#define Poedit_syntax_scanners_h
+
+#include <cwchar>
+#include <string>
+
+namespace scanners
+{
+
+// Hand-written matchers for the supported markup and format string syntaxes.
+//
+// Each Match*() function checks if there's a match starting at position @a p
+// of @a s and returns its end position or NO_MATCH. They behave exactly like
+// the regular expressions (ECMAScript flavor) quoted in their descriptions,
+// including the order in which alternatives are tried, but run in time
+// proportional to the length of the match and don't allocate.
+
+const size_t NO_MATCH = std::wstring::npos;
+
+inline wchar_t At(const std::wstring& s, size_t i) { return i < s.length() ? s[i] : 0; }
+
+inline bool IsOneOf(wchar_t c, const wchar_t *set) { return c && wcschr(set, c); }
+inline bool IsDigit(wchar_t c) { return c >= '0' && c <= '9'; }
+inline bool IsAlnum(wchar_t c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || IsDigit(c); }
+inline bool IsWordChar(wchar_t c) { return IsAlnum(c) || c == '_'; }                          // \w
+inline bool IsSpace(wchar_t c) { return c == ' ' || (c >= '\t' && c <= '\r'); }              // \s
+inline bool IsAnyChar(wchar_t c) { return c && c != '\n' && c != '\r'; }                      // .
+inline bool IsPlaceholderNameChar(wchar_t c) { return IsWordChar(c) || c == '.' || c == '-'; } // [\w.-]
+inline bool IsBracesNameChar(wchar_t c) { return IsWordChar(c) || (c >= '.' && c <= ':') || c == ','; } // [\w.-:,]
+
+template<typename Pred>
+inline size_t SkipWhile(const std::wstring& s, size_t p, Pred pred)
+{
+    while (p < s.length() && pred(s[p]))
+        p++;
+    return p;
+}
+
+inline size_t SkipDigits(const std::wstring& s, size_t p) { return SkipWhile(s, p, IsDigit); }
+
+// (\d+\$)?
+inline size_t SkipPositionalArg(const std::wstring& s, size_t p)
+{
+    const size_t d = SkipDigits(s, p);
+    return (d > p && At(s, d) == '$') ? d + 1 : p;
+}
+
+// (\d+|\*)?(\.(\d+|\*))?
+inline size_t SkipWidthAndPrecision(const std::wstring& s, size_t p)
+{
+    if (At(s, p) == '*')
+        p++;
+    else
+        p = SkipDigits(s, p);
+
+    if (At(s, p) == '.')
+    {
+        if (At(s, p + 1) == '*')
+            return p + 2;
+        const size_t d = SkipDigits(s, p + 1);
+        if (d > p + 1)
+            return d;
+    }
+    return p;
+}
+
+// (hh|ll|[hljztL])?[%csdioxXufFeEaAgGnp]
+inline size_t MatchCLengthAndConversion(const std::wstring& s, size_t p)
+{
+    const wchar_t *conversions = L"%csdioxXufFeEaAgGnp";
+    const wchar_t c = At(s, p);
+    if ((c == 'h' || c == 'l') && At(s, p + 1) == c && IsOneOf(At(s, p + 2), conversions))
+        return p + 3;
+    if (IsOneOf(c, L"hljztL") && IsOneOf(At(s, p + 1), conversions))
+        return p + 2;
+    if (IsOneOf(c, conversions))
+        return p + 1;
+    return NO_MATCH;
+}
+
+// %(\d+\$)?[-+ #0]{0,5}(\d+|\*)?(\.(\d+|\*))?  -- returns position after it or NO_MATCH
+inline size_t SkipCFormatPrefix(const std::wstring& s, size_t p)
+{
+    if (At(s, p) != '%')
+        return NO_MATCH;
+    p = SkipPositionalArg(s, p + 1);
+    for (int i = 0; i < 5 && IsOneOf(At(s, p), L"-+ #0"); i++)
+        p++;
+    return SkipWidthAndPrecision(s, p);
+}
+
+
+// (<\/?[a-zA-Z0-9:-]+(\s+[-:\w]+(=([-:\w+]|"[^"]*"|'[^']*'))?)*\s*\/?>)|(&[^ ;]+;)
+inline size_t MatchHTMLMarkup(const std::wstring& s, size_t p)
+{
+    if (At(s, p) == '<')
+    {
+        p++;
+        if (At(s, p) == '/')
+            p++;
+        const size_t name = SkipWhile(s, p, [](wchar_t c){ return IsAlnum(c) || c == ':' || c == '-'; });
+        if (name == p)
+            return NO_MATCH;
+        p = name;
+
+        // attributes:
+        for (;;)
+        {
+            const size_t attr = SkipWhile(s, p, IsSpace);
+            if (attr == p)
+                break;
+            const size_t attrEnd = SkipWhile(s, attr, [](wchar_t c){ return IsWordChar(c) || c == ':' || c == '-'; });
+            if (attrEnd == attr)
+                break;
+            p = attrEnd;
+
+            if (At(s, p) == '=')
+            {
+                const wchar_t v = At(s, p + 1);
+                if (IsWordChar(v) || IsOneOf(v, L"-:+"))
+                {
+                    p += 2;
+                }
+                else if (v == '"' || v == '\'')
+                {
+                    const size_t close = s.find(v, p + 2);
+                    if (close != std::wstring::npos)
+                        p = close + 1;
+                }
+            }
+        }
+
+        p = SkipWhile(s, p, IsSpace);
+        if (At(s, p) == '/')
+            p++;
+        return At(s, p) == '>' ? p + 1 : NO_MATCH;
+    }
+    else if (At(s, p) == '&')
+    {
+        const size_t end = SkipWhile(s, p + 1, [](wchar_t c){ return c != ' ' && c != ';'; });
+        return (end > p + 1 && At(s, end) == ';') ? end + 1 : NO_MATCH;
+    }
+    return NO_MATCH;
+}
+
+// \{[\w.-]+\}
+inline size_t MatchSimpleBraces(const std::wstring& s, size_t p)
+{
+    if (At(s, p) != '{')
+        return NO_MATCH;
+    const size_t end = SkipWhile(s, p + 1, IsPlaceholderNameChar);
+    return (end > p + 1 && At(s, end) == '}') ? end + 1 : NO_MATCH;
+}
+
+// Variables expansion for various template languages:
+//   %[\w.-]+%|%?\{[\w.-]+\}|\{\{[\w.-]+\}\}
+// i.e. %var% (Twig), %{var} (Ruby), {var} and {{var}}
+inline size_t MatchCommonPlaceholder(const std::wstring& s, size_t p)
+{
+    switch (At(s, p))
+    {
+        case '%':
+        {
+            const size_t end = SkipWhile(s, p + 1, IsPlaceholderNameChar);
+            if (end > p + 1 && At(s, end) == '%')
+                return end + 1;
+            return MatchSimpleBraces(s, p + 1);
+        }
+
+        case '{':
+        {
+            size_t end = MatchSimpleBraces(s, p);
+            if (end != NO_MATCH || At(s, p + 1) != '{')
+                return end;
+            end = SkipWhile(s, p + 2, IsPlaceholderNameChar);
+            return (end > p + 2 && At(s, end) == '}' && At(s, end + 1) == '}') ? end + 2 : NO_MATCH;
+        }
+
+        default:
+            return NO_MATCH;
+    }
+}
+
+// WebExtension-like $foo$ placeholders: \$[A-Za-z0-9_]+\$
+inline size_t MatchDollarPlaceholder(const std::wstring& s, size_t p)
+{
+    if (At(s, p) != '$')
+        return NO_MATCH;
+    const size_t end = SkipWhile(s, p + 1, IsWordChar);
+    return (end > p + 1 && At(s, end) == '$') ? end + 1 : NO_MATCH;
+}
+
+// php-format per http://php.net/manual/en/function.sprintf.php plus positionals:
+//   %(\d+\$)?[-+]{0,2}([ 0]|'.)?-?\d*(\..?\d+)?[%bcdeEfFgGosuxX]
+inline size_t MatchPHPFormat(const std::wstring& s, size_t p)
+{
+    const wchar_t *conversions = L"%bcdeEfFgGosuxX";
+
+    if (At(s, p) != '%')
+        return NO_MATCH;
+    p = SkipPositionalArg(s, p + 1);
+    for (int i = 0; i < 2 && IsOneOf(At(s, p), L"-+"); i++)
+        p++;
+    if (IsOneOf(At(s, p), L" 0"))
+        p++;
+    else if (At(s, p) == '\'' && IsAnyChar(At(s, p + 1)))
+        p += 2;
+    if (At(s, p) == '-')
+        p++;
+    p = SkipDigits(s, p);
+
+    if (At(s, p) == '.')
+    {
+        // try with the optional character after the dot first, then without it
+        if (IsAnyChar(At(s, p + 1)))
+        {
+            const size_t d = SkipDigits(s, p + 2);
+            if (d > p + 2 && IsOneOf(At(s, d), conversions))
+                return d + 1;
+        }
+        const size_t d = SkipDigits(s, p + 1);
+        if (d > p + 1 && IsOneOf(At(s, d), conversions))
+            return d + 1;
+    }
+
+    return IsOneOf(At(s, p), conversions) ? p + 1 : NO_MATCH;
+}
+
+// c-format per http://en.cppreference.com/w/cpp/io/c/fprintf,
+//              http://pubs.opengroup.org/onlinepubs/9699919799/functions/fprintf.html
+//   %(\d+\$)?[-+ #0]{0,5}(\d+|\*)?(\.(\d+|\*))?((hh|ll|[hljztL])?[%csdioxXufFeEaAgGnp]|<[A-Za-z0-9]+>)
+inline size_t MatchCFormat(const std::wstring& s, size_t p)
+{
+    p = SkipCFormatPrefix(s, p);
+    if (p == NO_MATCH)
+        return NO_MATCH;
+
+    const size_t end = MatchCLengthAndConversion(s, p);
+    if (end != NO_MATCH || At(s, p) != '<')
+        return end;
+
+    // <inttypes.h> macros such as <PRId64>:
+    const size_t macroEnd = SkipWhile(s, p + 1, IsAlnum);
+    return (macroEnd > p + 1 && At(s, macroEnd) == '>') ? macroEnd + 1 : NO_MATCH;
+}
+
+// %@|<c-format>
+inline size_t MatchObjCFormat(const std::wstring& s, size_t p)
+{
+    if (At(s, p) == '%' && At(s, p + 1) == '@')
+        return p + 2;
+    return MatchCFormat(s, p);
+}
+
+// ruby-format per https://ruby-doc.org/core-2.7.1/Kernel.html#method-i-sprintf
+//   %(\d+\$)?[-+ #0]{0,5}(\d+|\*)?(\.(\d+|\*))?(hh|ll|[hljztL])?[%csdioxXufFeEaAgGnp]
+inline size_t MatchRubyFormat(const std::wstring& s, size_t p)
+{
+    p = SkipCFormatPrefix(s, p);
+    return p == NO_MATCH ? NO_MATCH : MatchCLengthAndConversion(s, p);
+}
+
+// C++20 std::format: (\{\{)|(\}\})|(\{[^}]*\})
+inline size_t MatchCXX20Format(const std::wstring& s, size_t p)
+{
+    switch (At(s, p))
+    {
+        case '{':
+        {
+            if (At(s, p + 1) == '{')
+                return p + 2;
+            const size_t close = s.find('}', p + 1);
+            return close == std::wstring::npos ? NO_MATCH : close + 1;
+        }
+        case '}':
+            return At(s, p + 1) == '}' ? p + 2 : NO_MATCH;
+        default:
+            return NO_MATCH;
+    }
+}
+
+// Python and Perl-libintl braces format (also covered by common placeholders above): \{[\w.-:,]+\}
+inline size_t MatchBracesFormat(const std::wstring& s, size_t p)
+{
+    if (At(s, p) != '{')
+        return NO_MATCH;
+    const size_t end = SkipWhile(s, p + 1, IsBracesNameChar);
+    return (end > p + 1 && At(s, end) == '}') ? end + 1 : NO_MATCH;
+}
+
+// python-format old style https://docs.python.org/2/library/stdtypes.html#string-formatting
+//               new style https://docs.python.org/3/library/string.html#format-string-syntax
+//   (%(\(\w+\))?[-+ #0]?(\d+|\*)?(\.(\d+|\*))?[hlL]?[diouxXeEfFgGcrs%])|<braces-format>
+inline size_t MatchPythonFormat(const std::wstring& s, size_t p)
+{
+    const wchar_t *conversions = L"diouxXeEfFgGcrs%";
+
+    if (At(s, p) != '%')
+        return MatchBracesFormat(s, p);
+
+    p++;
+    if (At(s, p) == '(')
+    {
+        const size_t end = SkipWhile(s, p + 1, IsWordChar);
+        if (end > p + 1 && At(s, end) == ')')
+            p = end + 1;
+    }
+    if (IsOneOf(At(s, p), L"-+ #0"))
+        p++;
+    p = SkipWidthAndPrecision(s, p);
+
+    if (IsOneOf(At(s, p), L"hlL") && IsOneOf(At(s, p + 1), conversions))
+        return p + 2;
+    return IsOneOf(At(s, p), conversions) ? p + 1 : NO_MATCH;
+}
+
+// Qt and KDE formats: %L?(\d\d?|n)
+inline size_t MatchQtFormat(const std::wstring& s, size_t p)
+{
+    if (At(s, p) != '%')
+        return NO_MATCH;
+    p++;
+    if (At(s, p) == 'L' && (IsDigit(At(s, p + 1)) || At(s, p + 1) == 'n'))
+        p++;
+    if (IsDigit(At(s, p)))
+        return IsDigit(At(s, p + 1)) ? p + 2 : p + 1;
+    return At(s, p) == 'n' ? p + 1 : NO_MATCH;
+}
+
+// Lua: %[- 0]*\d*(\.\d+)?[sqdiouXxAaEefGgc]
+inline size_t MatchLuaFormat(const std::wstring& s, size_t p)
+{
+    const wchar_t *conversions = L"sqdiouXxAaEefGgc";
+
+    if (At(s, p) != '%')
+        return NO_MATCH;
+    p = SkipWhile(s, p + 1, [](wchar_t c){ return c == '-' || c == ' ' || c == '0'; });
+    p = SkipDigits(s, p);
+    if (At(s, p) == '.' && IsDigit(At(s, p + 1)))
+        p = SkipDigits(s, p + 1);
+    return IsOneOf(At(s, p), conversions) ? p + 1 : NO_MATCH;
+}
+
+// Pascal per https://www.freepascal.org/docs-html/rtl/sysutils/format.html
+//   %(\*:|\d*:)?-?(\*|\d+)?(\.\*|\.\d+)?[dDuUxXeEfFgGnNmMsSpP]
+inline size_t MatchPascalFormat(const std::wstring& s, size_t p)
+{
+    if (At(s, p) != '%')
+        return NO_MATCH;
+    p++;
+    if (At(s, p) == '*' && At(s, p + 1) == ':')
+    {
+        p += 2;
+    }
+    else
+    {
+        const size_t d = SkipDigits(s, p);
+        if (At(s, d) == ':')
+            p = d + 1;
+    }
+    if (At(s, p) == '-')
+        p++;
+    p = SkipWidthAndPrecision(s, p);
+    return IsOneOf(At(s, p), L"dDuUxXeEfFgGnNmMsSpP") ? p + 1 : NO_MATCH;
+}
+
+
+/// Match function together with characters any match must start with
+struct Syntax
+{
+    size_t (*match)(const std::wstring& s, size_t p);
+    const wchar_t *triggers;
+};
+
+const Syntax HTML_MARKUP         = { MatchHTMLMarkup,        L"<&" };
+const Syntax COMMON_PLACEHOLDERS = { MatchCommonPlaceholder, L"%{" };
+const Syntax DOLLAR_PLACEHOLDERS = { MatchDollarPlaceholder, L"$" };
+const Syntax PHP_FORMAT          = { MatchPHPFormat,         L"%" };
+const Syntax C_FORMAT            = { MatchCFormat,           L"%" };
+const Syntax OBJC_FORMAT         = { MatchObjCFormat,        L"%" };
+const Syntax CXX20_FORMAT        = { MatchCXX20Format,       L"{}" };
+const Syntax BRACES_FORMAT       = { MatchBracesFormat,      L"{" };
+const Syntax PYTHON_FORMAT       = { MatchPythonFormat,      L"%{" };
+const Syntax RUBY_FORMAT         = { MatchRubyFormat,        L"%" };
+const Syntax QT_FORMAT           = { MatchQtFormat,          L"%" };
+const Syntax LUA_FORMAT          = { MatchLuaFormat,         L"%" };
+const Syntax PASCAL_FORMAT       = { MatchPascalFormat,      L"%" };
+
+/// Calls @a f(start, end) for all non-overlapping matches of @a syntax, left to right
+template<typename F>
+inline void ForEachMatch(const Syntax& syntax, const std::wstring& s, F&& f)
+{
+    size_t pos = s.find_first_of(syntax.triggers);
+    while (pos != std::wstring::npos)
+    {
+        const size_t end = syntax.match(s, pos);
+        if (end != NO_MATCH)
+        {
+            if (!f(pos, end))
+                return;
+            pos = s.find_first_of(syntax.triggers, end);
+        }
+        else
+        {
+            pos = s.find_first_of(syntax.triggers, pos + 1);
+        }
+    }
+}
+
+inline bool ContainsMatch(const Syntax& syntax, const std::wstring& s)
+{
+    bool found = false;
+    ForEachMatch(syntax, s, [&found](size_t, size_t){ found = true; return false; });
+    return found;
+}
+
+} // namespace scanners
+
+#endif // Poedit_syntax_scanners_h
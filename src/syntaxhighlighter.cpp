@@ -27,9 +27,12 @@
 
 #include "catalog.h"
 #include "str_helpers.h"
+#include "syntax_scanners.h"
 
 #include <unicode/uchar.h>
-#include <regex>
+#include <cwchar>
+
+using namespace scanners;
 
 namespace
 {
@@ -140,107 +143,27 @@ private:
 };
 
 
-
-/// Match regular expressions for highlighting
-class RegexSyntaxHighlighter : public SyntaxHighlighter
+/// Highlights matches of given syntax
+class ScannerSyntaxHighlighter : public SyntaxHighlighter
 {
 public:
-    static const std::wregex::flag_type flags = std::regex_constants::ECMAScript | std::regex_constants::optimize;
-
-    RegexSyntaxHighlighter(const wchar_t *regex, TextKind kind) : m_re(regex, flags), m_kind(kind) {}
-    RegexSyntaxHighlighter(const std::wregex& regex, TextKind kind) : m_re(regex), m_kind(kind) {}
+    ScannerSyntaxHighlighter(const Syntax& syntax, TextKind kind) : m_syntax(syntax), m_kind(kind) {}
 
     void Highlight(const std::wstring& s, const CallbackType& highlight) override
     {
-        try
+        ForEachMatch(m_syntax, s, [&](size_t start, size_t end)
         {
-            std::wsregex_iterator next(s.begin(), s.end(), m_re);
-            std::wsregex_iterator end;
-            while (next != end)
-            {
-                auto match = *next++;
-                if (match.empty())
-                    continue;
-                int pos = static_cast<int>(match.position());
-                highlight(pos, pos + static_cast<int>(match.length()), m_kind);
-            }
-        }
-        catch (std::regex_error& e)
-        {
-            switch (e.code())
-            {
-                case std::regex_constants::error_complexity:
-                case std::regex_constants::error_stack:
-                    // MSVC version of std::regex in particular can fail to match
-                    // e.g. HTML regex with backreferences on insanely large strings;
-                    // in that case, don't highlight instead of failing outright.
-                    return;
-                default:
-                    throw;
-            }
-        }
+            highlight(static_cast<int>(start), static_cast<int>(end), m_kind);
+            return true;
+        });
     }
 
 private:
-    std::wregex m_re;
+    const Syntax& m_syntax;
     TextKind m_kind;
 };
 
 
-std::wregex REOBJ_HTML_MARKUP(LR"((<\/?[a-zA-Z0-9:-]+(\s+[-:\w]+(=([-:\w+]|"[^"]*"|'[^']*'))?)*\s*\/?>)|(&[^ ;]+;))",
-                              RegexSyntaxHighlighter::flags);
-
-// variables expansion for various template languages
-std::wregex REOBJ_COMMON_PLACEHOLDERS(
-                //
-                //           |             |
-                LR"(%[\w.-]+%|%?\{[\w.-]+\}|\{\{[\w.-]+\}\})",
-                //      |    |      |      |        |
-                //      |           |               |
-                //      |           |               +----------------------- {{var}}
-                //      |           |
-                //      |           +--------------------------------------- %{var} (Ruby) and {var}
-                //      |
-                //      +--------------------------------------------------- %var% (Twig)
-                //
-                RegexSyntaxHighlighter::flags);
-const wchar_t* COMMON_PLACEHOLDERS_TRIGGER_CHARS = L"{%";
-
-// WebExtension-like $foo$ placeholders
-std::wregex REOBJ_DOLLAR_PLACEHOLDERS(LR"(\$[A-Za-z0-9_]+\$)", RegexSyntaxHighlighter::flags);
-
-// php-format per http://php.net/manual/en/function.sprintf.php plus positionals
-const wchar_t* RE_PHP_FORMAT = LR"(%(\d+\$)?[-+]{0,2}([ 0]|'.)?-?\d*(\..?\d+)?[%bcdeEfFgGosuxX])";
-
-// c-format per http://en.cppreference.com/w/cpp/io/c/fprintf,
-//              http://pubs.opengroup.org/onlinepubs/9699919799/functions/fprintf.html
-#define RE_C_FORMAT_BASE LR"(%(\d+\$)?[-+ #0]{0,5}(\d+|\*)?(\.(\d+|\*))?((hh|ll|[hljztL])?[%csdioxXufFeEaAgGnp]|<[A-Za-z0-9]+>))"
-const wchar_t* RE_C_FORMAT = RE_C_FORMAT_BASE;
-const wchar_t* RE_OBJC_FORMAT =  L"%@|" RE_C_FORMAT_BASE;
-const wchar_t* RE_CXX20_FORMAT = LR"((\{\{)|(\}\})|(\{[^}]*\}))";
-
-// Python and Perl-libintl braces format (also covered by common placeholders above)
-#define RE_BRACES LR"(\{[\w.-:,]+\})"
-
-// python-format old style https://docs.python.org/2/library/stdtypes.html#string-formatting
-//               new style https://docs.python.org/3/library/string.html#format-string-syntax
-const wchar_t* RE_PYTHON_FORMAT = LR"((%(\(\w+\))?[-+ #0]?(\d+|\*)?(\.(\d+|\*))?[hlL]?[diouxXeEfFgGcrs%]))" // old style
-                                  "|"
-                                  RE_BRACES; // new style
-
-// ruby-format per https://ruby-doc.org/core-2.7.1/Kernel.html#method-i-sprintf
-const wchar_t* RE_RUBY_FORMAT = LR"(%(\d+\$)?[-+ #0]{0,5}(\d+|\*)?(\.(\d+|\*))?(hh|ll|[hljztL])?[%csdioxXufFeEaAgGnp])";
-
-// Qt and KDE formats
-const wchar_t* RE_QT_FORMAT = LR"(%L?(\d\d?|n))";
-
-// Lua
-const wchar_t* RE_LUA_FORMAT = LR"(%[- 0]*\d*(\.\d+)?[sqdiouXxAaEefGgc])";
-
-// Pascal per https://www.freepascal.org/docs-html/rtl/sysutils/format.html
-const wchar_t* RE_PASCAL_FORMAT = LR"(%(\*:|\d*:)?-?(\*|\d+)?(\.\*|\.\d+)?[dDuUxXeEfFgGnNmMsSpP])";
-
-
 } // anonymous namespace
 
 
@@ -255,15 +178,17 @@ SyntaxHighlighterPtr SyntaxHighlighter::ForItem(const CatalogItem& item, int kin
     {
         needsHTML = false;
 
+        // only strings with tags are treated as markup; entities alone,
+        // e.g. in "Tom &amp; Jerry", don't make it worth highlighting
         str::wstring_conv_t str1 = str::to_wstring(item.GetString());
-        if (str1.find(L"<") != std::wstring::npos && std::regex_search(str1, REOBJ_HTML_MARKUP))
+        if (str1.find(L'<') != std::wstring::npos && ContainsMatch(HTML_MARKUP, str1))
         {
             needsHTML = true;
         }
         else if (item.HasPlural())
         {
             str::wstring_conv_t strp = str::to_wstring(item.GetString());
-            if (strp.find(L"<") != std::wstring::npos && std::regex_search(strp, REOBJ_HTML_MARKUP))
+            if (strp.find(L'<') != std::wstring::npos && ContainsMatch(HTML_MARKUP, strp))
             {
                 needsHTML = true;
             }
@@ -282,14 +207,14 @@ SyntaxHighlighterPtr SyntaxHighlighter::ForItem(const CatalogItem& item, int kin
             needsGenericPlaceholders = false;
 
             str::wstring_conv_t str1 = str::to_wstring(item.GetString());
-            if (str1.find_first_of(COMMON_PLACEHOLDERS_TRIGGER_CHARS) != std::wstring::npos && std::regex_search(str1, REOBJ_COMMON_PLACEHOLDERS))
+            if (ContainsMatch(COMMON_PLACEHOLDERS, str1))
             {
 				needsGenericPlaceholders = true;
 			}
             else if (item.HasPlural())
             {
                 str::wstring_conv_t strp = str::to_wstring(item.GetString());
-                if (strp.find_first_of(COMMON_PLACEHOLDERS_TRIGGER_CHARS) != std::wstring::npos && std::regex_search(strp, REOBJ_COMMON_PLACEHOLDERS))
+                if (ContainsMatch(COMMON_PLACEHOLDERS, strp))
                 {
                     needsGenericPlaceholders = true;
                 }
@@ -311,14 +236,14 @@ SyntaxHighlighterPtr SyntaxHighlighter::ForItem(const CatalogItem& item, int kin
     // HTML goes first, has lowest priority than special-purpose stuff like format strings:
     if (needsHTML)
     {
-        static auto html = std::make_shared<RegexSyntaxHighlighter>(REOBJ_HTML_MARKUP, TextKind::Markup);
+        static auto html = std::make_shared<ScannerSyntaxHighlighter>(HTML_MARKUP, TextKind::Markup);
         all->Add(html);
     }
 
     if (needsGenericPlaceholders)
     {
         // If no format specified, heuristically apply highlighting of common variable markers
-        static auto placeholders = std::make_shared<RegexSyntaxHighlighter>(REOBJ_COMMON_PLACEHOLDERS, TextKind::Placeholder);
+        static auto placeholders = std::make_shared<ScannerSyntaxHighlighter>(COMMON_PLACEHOLDERS, TextKind::Placeholder);
         all->Add(placeholders);
     }
 
@@ -326,57 +251,57 @@ SyntaxHighlighterPtr SyntaxHighlighter::ForItem(const CatalogItem& item, int kin
     {
         if (fmt == "php")
         {
-            static auto php_format = std::make_shared<RegexSyntaxHighlighter>(RE_PHP_FORMAT, TextKind::Placeholder);
+            static auto php_format = std::make_shared<ScannerSyntaxHighlighter>(PHP_FORMAT, TextKind::Placeholder);
             all->Add(php_format);
         }
         else if (fmt == "c")
         {
-            static auto c_format = std::make_shared<RegexSyntaxHighlighter>(RE_C_FORMAT, TextKind::Placeholder);
+            static auto c_format = std::make_shared<ScannerSyntaxHighlighter>(C_FORMAT, TextKind::Placeholder);
             all->Add(c_format);
         }
         else if (fmt == "c++")
         {
-            static auto cxx_format = std::make_shared<RegexSyntaxHighlighter>(RE_CXX20_FORMAT, TextKind::Placeholder);
+            static auto cxx_format = std::make_shared<ScannerSyntaxHighlighter>(CXX20_FORMAT, TextKind::Placeholder);
             all->Add(cxx_format);
         }
         else if (fmt == "python")
         {
-            static auto python_format = std::make_shared<RegexSyntaxHighlighter>(RE_PYTHON_FORMAT, TextKind::Placeholder);
+            static auto python_format = std::make_shared<ScannerSyntaxHighlighter>(PYTHON_FORMAT, TextKind::Placeholder);
             all->Add(python_format);
         }
         else if (fmt == "ruby")
         {
-            static auto ruby_format = std::make_shared<RegexSyntaxHighlighter>(RE_RUBY_FORMAT, TextKind::Placeholder);
+            static auto ruby_format = std::make_shared<ScannerSyntaxHighlighter>(RUBY_FORMAT, TextKind::Placeholder);
             all->Add(ruby_format);
         }
         else if (fmt == "objc")
         {
-            static auto objc_format = std::make_shared<RegexSyntaxHighlighter>(RE_OBJC_FORMAT, TextKind::Placeholder);
+            static auto objc_format = std::make_shared<ScannerSyntaxHighlighter>(OBJC_FORMAT, TextKind::Placeholder);
             all->Add(objc_format);
         }
         else if (fmt == "qt" || fmt == "qt-plural" || fmt == "kde" || fmt == "kde-kuit")
         {
-            static auto qt_format = std::make_shared<RegexSyntaxHighlighter>(RE_QT_FORMAT, TextKind::Placeholder);
+            static auto qt_format = std::make_shared<ScannerSyntaxHighlighter>(QT_FORMAT, TextKind::Placeholder);
             all->Add(qt_format);
         }
         else if (fmt == "lua")
         {
-            static auto lua_format = std::make_shared<RegexSyntaxHighlighter>(RE_LUA_FORMAT, TextKind::Placeholder);
+            static auto lua_format = std::make_shared<ScannerSyntaxHighlighter>(LUA_FORMAT, TextKind::Placeholder);
             all->Add(lua_format);
         }
         else if (fmt == "csharp" || fmt == "perl-brace" || fmt == "python-brace")
         {
-            static auto brace_format = std::make_shared<RegexSyntaxHighlighter>(RE_BRACES, TextKind::Placeholder);
+            static auto brace_format = std::make_shared<ScannerSyntaxHighlighter>(BRACES_FORMAT, TextKind::Placeholder);
             all->Add(brace_format);
         }
         else if (fmt == "object-pascal")
         {
-            static auto pascal_format = std::make_shared<RegexSyntaxHighlighter>(RE_PASCAL_FORMAT, TextKind::Placeholder);
+            static auto pascal_format = std::make_shared<ScannerSyntaxHighlighter>(PASCAL_FORMAT, TextKind::Placeholder);
             all->Add(pascal_format);
         }
         else if (fmt == "ph-dollars")
         {
-            static auto dollars_format = std::make_shared<RegexSyntaxHighlighter>(REOBJ_DOLLAR_PLACEHOLDERS, TextKind::Placeholder);
+            static auto dollars_format = std::make_shared<ScannerSyntaxHighlighter>(DOLLAR_PLACEHOLDERS, TextKind::Placeholder);
             all->Add(dollars_format);
         }
     }
@@ -0,0 +1,145 @@
+/*
+ *  This file is part of Poedit (https://poedit.net)
+ *
+ *  Copyright (C) 2025 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "fuzzy_match.h"
+
+#include <algorithm>
+
+
+FuzzyMatcher::FuzzyMatcher(const Tokens& query) : m_length(query.size())
+{
+    m_query.reserve(query.size());
+    for (auto& t: query)
+    {
+        auto id = m_ids.emplace(t, (int)m_ids.size()).first->second;
+        m_query.push_back(id);
+    }
+
+    if (m_length <= 64)
+    {
+        m_positions.resize(m_ids.size(), 0);
+        for (size_t i = 0; i < m_length; i++)
+            m_positions[m_query[i]] |= uint64_t(1) << i;
+    }
+}
+
+
+size_t FuzzyMatcher::Distance(const Tokens& tokens) const
+{
+    if (m_length == 0)
+        return tokens.size();
+    if (tokens.empty())
+        return m_length;
+
+    if (m_length <= 64)
+        return DistanceBitParallel(tokens);
+    else
+        return DistanceDynamic(tokens);
+}
+
+
+double FuzzyMatcher::Similarity(const Tokens& tokens) const
+{
+    const size_t longer = std::max(m_length, tokens.size());
+    if (longer == 0)
+        return 1.0;
+    return 1.0 - double(Distance(tokens)) / longer;
+}
+
+
+double FuzzyMatcher::MaxSimilarity(size_t length1, size_t length2)
+{
+    // edit distance is at least the difference in lengths
+    const size_t longer = std::max(length1, length2);
+    if (longer == 0)
+        return 1.0;
+    return double(std::min(length1, length2)) / longer;
+}
+
+
+size_t FuzzyMatcher::DistanceBitParallel(const Tokens& tokens) const
+{
+    // Myers' algorithm as formulated by Hyyrö ("Explaining and extending the
+    // bit-parallel approximate string matching algorithm of Myers", 2001),
+    // computing global edit distance: the vertical deltas of one DP matrix
+    // column are stored in Pv/Mv bitmasks and the whole column is updated at
+    // once for every token of the candidate.
+    const uint64_t last = uint64_t(1) << (m_length - 1);
+
+    uint64_t Pv = ~uint64_t(0);
+    uint64_t Mv = 0;
+    size_t score = m_length;
+
+    for (auto& t: tokens)
+    {
+        auto id = m_ids.find(t);
+        const uint64_t Eq = (id == m_ids.end()) ? 0 : m_positions[id->second];
+
+        const uint64_t Xv = Eq | Mv;
+        const uint64_t Xh = (((Eq & Pv) + Pv) ^ Pv) | Eq;
+        uint64_t Ph = Mv | ~(Xh | Pv);
+        uint64_t Mh = Pv & Xh;
+
+        if (Ph & last)
+            score++;
+        else if (Mh & last)
+            score--;
+
+        // top row of the matrix increases by 1 in every column:
+        Ph = (Ph << 1) | 1;
+        Mh <<= 1;
+        Pv = Mh | ~(Xv | Ph);
+        Mv = Ph & Xv;
+    }
+
+    return score;
+}
+
+
+size_t FuzzyMatcher::DistanceDynamic(const Tokens& tokens) const
+{
+    // Classic dynamic programming with a single row, for (rare) long queries:
+    std::vector<size_t> row(m_length + 1);
+    for (size_t i = 0; i <= m_length; i++)
+        row[i] = i;
+
+    for (size_t j = 0; j < tokens.size(); j++)
+    {
+        auto found = m_ids.find(tokens[j]);
+        const int id = (found == m_ids.end()) ? -1 : found->second;
+
+        size_t diagonal = row[0];
+        row[0] = j + 1;
+        for (size_t i = 1; i <= m_length; i++)
+        {
+            const size_t above = row[i];
+            const size_t cost = (m_query[i - 1] == id) ? 0 : 1;
+            row[i] = std::min({above + 1, row[i - 1] + 1, diagonal + cost});
+            diagonal = above;
+        }
+    }
+
+    return row[m_length];
+}
@@ -0,0 +1,86 @@
+/*
+ *  This file is part of Poedit (https://poedit.net)
+ *
+ *  Copyright (C) 2025 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef Poedit_fuzzy_match_h
+#define Poedit_fuzzy_match_h
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/**
+    Computes similarity of token sequences to a fixed query.
+
+    Similarity is based on token-level edit (Levenshtein) distance, i.e. the
+    number of words that must be inserted, deleted or replaced to turn one
+    text into the other, normalized to 0..1 range the way CAT tools compute
+    their percentage matches: 1 - distance / max(length1, length2).
+
+    Queries of up to 64 tokens, i.e. virtually all of them, use Myers'
+    bit-parallel algorithm that runs in time linear in candidate's length.
+
+    The matcher is immutable after construction and can be used from
+    multiple threads.
+ */
+class FuzzyMatcher
+{
+public:
+    typedef std::vector<std::wstring> Tokens;
+
+    explicit FuzzyMatcher(const Tokens& query);
+
+    /// Returns length of the query, in tokens.
+    size_t GetQueryLength() const { return m_length; }
+
+    /// Returns edit distance between the query and @a tokens.
+    size_t Distance(const Tokens& tokens) const;
+
+    /// Returns similarity of the query and @a tokens, in 0..1 range.
+    double Similarity(const Tokens& tokens) const;
+
+    /**
+        Returns upper bound for Similarity() of texts with given lengths.
+
+        Useful for discarding candidates without tokenizing them.
+     */
+    static double MaxSimilarity(size_t length1, size_t length2);
+
+private:
+    size_t DistanceBitParallel(const Tokens& tokens) const;
+    size_t DistanceDynamic(const Tokens& tokens) const;
+
+    // IDs of distinct query tokens and query itself, expressed as IDs:
+    std::unordered_map<std::wstring, int> m_ids;
+    std::vector<int> m_query;
+    size_t m_length;
+
+    // For every token ID, bitmask of query positions where it occurs
+    // (only used if the query is short enough for bit-parallel algorithm):
+    std::vector<uint64_t> m_positions;
+};
+
+#endif // Poedit_fuzzy_match_h
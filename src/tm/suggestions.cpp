@@ -28,15 +28,113 @@
 #include "concurrency.h"
 #include "transmem.h"
 
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include <wx/log.h>
+
+namespace
+{
+
+/**
+    Thread-safe, size-bounded cache of results of recent queries.
+
+    Least recently used entries are discarded when the cache is full. Entries
+    are tagged with backend's generation at the time of the query and are
+    only used if the backend wasn't modified since.
+ */
+class SuggestionsCache
+{
+public:
+    explicit SuggestionsCache(size_t maxSize) : m_maxSize(maxSize) {}
+
+    bool Get(const std::wstring& key, unsigned generation, SuggestionsList& results)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto found = m_index.find(key);
+        if (found == m_index.end() || found->second->generation != generation)
+        {
+            if (found != m_index.end())
+            {
+                m_entries.erase(found->second);
+                m_index.erase(found);
+            }
+            m_stats.misses++;
+            return false;
+        }
+
+        // move to the front of the list as the most recently used entry:
+        m_entries.splice(m_entries.begin(), m_entries, found->second);
+        m_stats.hits++;
+        results = found->second->results;
+        return true;
+    }
+
+    void Put(const std::wstring& key, unsigned generation, const SuggestionsList& results)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto found = m_index.find(key);
+        if (found != m_index.end())
+        {
+            found->second->generation = generation;
+            found->second->results = results;
+            m_entries.splice(m_entries.begin(), m_entries, found->second);
+            return;
+        }
+
+        m_entries.push_front({key, generation, results});
+        m_index.emplace(key, m_entries.begin());
+
+        if (m_entries.size() > m_maxSize)
+        {
+            m_index.erase(m_entries.back().key);
+            m_entries.pop_back();
+        }
+    }
+
+    SuggestionsProvider::CacheStats GetStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto stats = m_stats;
+        stats.entries = m_entries.size();
+        return stats;
+    }
+
+private:
+    struct Entry
+    {
+        std::wstring key;
+        unsigned generation;
+        SuggestionsList results;
+    };
+
+    const size_t m_maxSize;
+
+    mutable std::mutex m_mutex;
+    std::list<Entry> m_entries; // most recently used first
+    std::unordered_map<std::wstring, std::list<Entry>::iterator> m_index;
+    SuggestionsProvider::CacheStats m_stats;
+};
+
+// Max. number of queries whose results are cached
+const size_t MAX_CACHED_QUERIES = 1000;
+
+} // anonymous namespace
+
 
 class SuggestionsProviderImpl
 {
 public:
-    SuggestionsProviderImpl() {}
+    SuggestionsProviderImpl() : m_cache(std::make_shared<SuggestionsCache>(MAX_CACHED_QUERIES)) {}
 
     dispatch::future<SuggestionsList> SuggestTranslation(SuggestionsBackend& backend, const SuggestionQuery&& q)
     {
         auto bck = &backend;
+        auto cache = m_cache;
         return dispatch::async([=]{
             // don't bother asking the backend if the language or query is invalid:
             if (!q.srclang.IsValid() || !q.lang.IsValid() || q.srclang == q.lang || q.source.empty())
@@ -44,10 +142,33 @@ public:
                 return dispatch::make_ready_future(SuggestionsList());
             }
 
+            // reuse results of recent identical query, unless the backend changed since:
+            std::wstring key = std::to_wstring(reinterpret_cast<uintptr_t>(bck));
+            key += L'\x01';
+            key += q.srclang.WCode();
+            key += L'\x01';
+            key += q.lang.WCode();
+            key += L'\x01';
+            key += q.source;
+
+            const unsigned generation = bck->GetGeneration();
+            SuggestionsList cached;
+            if (cache->Get(key, generation, cached))
+                return dispatch::make_ready_future(std::move(cached));
+
             // query the backend:
-            return bck->SuggestTranslation(std::move(q));
+            return bck->SuggestTranslation(std::move(q)).then([=](SuggestionsList results)
+            {
+                cache->Put(key, generation, results);
+                return results;
+            });
         });
     }
+
+    SuggestionsProvider::CacheStats GetCacheStats() const { return m_cache->GetStats(); }
+
+private:
+    std::shared_ptr<SuggestionsCache> m_cache;
 };
 
 
@@ -58,6 +179,13 @@ SuggestionsProvider::SuggestionsProvider() : m_impl(new SuggestionsProviderImpl)
 
 SuggestionsProvider::~SuggestionsProvider()
 {
+    auto stats = GetCacheStats();
+    if (stats.hits || stats.misses)
+    {
+        wxLogTrace("poedit.tm", "suggestions cache: %d hits, %d misses (%.0f%% hit rate), %d entries",
+                   (int)stats.hits, (int)stats.misses, 100.0 * stats.hits / (stats.hits + stats.misses),
+                   (int)stats.entries);
+    }
 }
 
 dispatch::future<SuggestionsList> SuggestionsProvider::SuggestTranslation(SuggestionsBackend& backend, const SuggestionQuery&& q)
@@ -65,6 +193,11 @@ dispatch::future<SuggestionsList> SuggestionsProvider::SuggestTranslation(Sugges
     return m_impl->SuggestTranslation(backend, std::move(q));
 }
 
+SuggestionsProvider::CacheStats SuggestionsProvider::GetCacheStats() const
+{
+    return m_impl->GetCacheStats();
+}
+
 void SuggestionsProvider::Delete(const Suggestion& s)
 {
     if (s.id.empty())
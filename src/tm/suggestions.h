@@ -130,6 +130,17 @@ public:
     /// Mark a suggestion as good. Called when a suggestion is used.
     static void Delete(const Suggestion& s);
 
+    /// Statistics about the cache of recent queries' results, for diagnostics
+    struct CacheStats
+    {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t entries = 0;
+    };
+
+    /// Returns current statistics about the cache of recent queries
+    CacheStats GetCacheStats() const;
+
 private:
     std::unique_ptr<SuggestionsProviderImpl> m_impl;
 };
@@ -170,6 +181,16 @@ public:
 
     /// Delete suggestion with given ID from the database
     virtual void Delete(const std::string& id) = 0;
+
+    /**
+        Returns a number that changes whenever the backend's data change.
+
+        SuggestionsProvider uses it to invalidate cached results of
+        SuggestTranslation().
+
+        @note Must be thread-safe, may be called from any thread.
+     */
+    virtual unsigned GetGeneration() const = 0;
 };
 
 #endif // Poedit_suggestions_h
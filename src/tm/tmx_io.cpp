@@ -31,8 +31,18 @@
     #define timegm _mkgmtime
 #endif
 
+#include <wx/log.h>
+#include <wx/stopwatch.h>
 #include <wx/translation.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#include "concurrency.h"
 #include "errors.h"
 #include "progress.h"
 #include "pugixml.h"
@@ -73,36 +83,395 @@ std::wstring extract_seg(xml_node node)
     return pugi::as_wide(text);
 }
 
-} // anonymous namespace
-
 
-int TMX::ImportFromFile(std::istream& file, TranslationMemory& tm)
+// MT-safe cache of parsed language codes; the same few codes are used by all
+// entries of a TMX file and parsing them isn't cheap.
+class LanguagesCache
 {
-    xml_document doc;
-    auto result = doc.load(file);
-    if (!result)
-        BOOST_THROW_EXCEPTION(std::runtime_error(result.description()));
+public:
+    Language Get(const std::string& code)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto i = m_cache.find(code);
+            if (i != m_cache.end())
+                return i->second;
+        }
 
-    auto root = doc.child("tmx");
-    if (!root)
-        BOOST_THROW_EXCEPTION(Exception(_("The TMX file is malformed.")));
+        auto lang = Language::TryParse(code);
 
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cache.emplace(code, lang);
+        return lang;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::unordered_map<std::string, Language> m_cache;
+};
+
+
+// Information shared by all <tu> elements of a file
+struct ImportContext
+{
     std::string defaultSrclang;
     std::string defaultDate;
-    auto header = root.child("header");
-    if (header)
+    LanguagesCache languages;
+
+    void ReadHeader(xml_node header)
     {
         defaultSrclang = header.attribute("srclang").value();
         if (defaultSrclang == "*all*")
             defaultSrclang.clear();
         defaultDate = extract_date(header);
     }
+};
+
+
+// Inserts all translations from a single <tu> element, returns their count.
+// Can be called from multiple threads at once.
+int import_tu(xml_node tu, ImportContext& ctx, TranslationMemory::IOInterface& writer)
+{
+    auto tuDate = extract_date(tu, ctx.defaultDate);
+    std::string tuSrclang = tu.attribute("srclang").value();
+    if (tuSrclang.empty())
+        tuSrclang = ctx.defaultSrclang;
+
+    std::wstring source;
+    for (auto tuv: tu.children("tuv"))
+    {
+        if (extract_lang(tuv) == tuSrclang)
+        {
+            source = extract_seg(tuv);
+            break;
+        }
+    }
+    if (source.empty())
+        return 0;
+
+    auto srclang = ctx.languages.Get(tuSrclang);
+    if (!srclang.IsValid())
+        return 0;
 
     int counter = 0;
+    for (auto tuv: tu.children("tuv"))
+    {
+        auto tuvLang = extract_lang(tuv);
+        if (tuvLang == tuSrclang)
+            continue;
+
+        auto lang = ctx.languages.Get(tuvLang);
+        if (!lang.IsValid())
+            continue;
+
+        auto trans = extract_seg(tuv);
+        if (trans.empty())
+            continue;
+
+        time_t creationTime = 0;
+        auto tuvDate = extract_date(tu, tuDate);
+        if (!tuvDate.empty())
+        {
+            struct tm t {};
+            std::istringstream s(tuvDate.c_str());
+            s >> std::get_time(&t, "%Y%m%dT%H%M%SZ"); // YYYYMMDDThhmmssZ
+            if (!s.fail())
+                creationTime = timegm(&t);
+        }
+
+        writer.Insert(srclang, lang, source, trans, creationTime);
+        counter++;
+    }
+
+    return counter;
+}
+
+
+[[noreturn]] void throw_malformed()
+{
+    BOOST_THROW_EXCEPTION(Exception(_("The TMX file is malformed.")));
+}
+
+
+/**
+    Reads TMX file sequentially and splits it into individual <header> and <tu>
+    elements that can be parsed independently of each other, without ever
+    holding more than a small part of the file in memory.
+
+    This is not a full XML parser: it only understands as much of XML syntax
+    as is needed to find elements' boundaries reliably, i.e. comments, CDATA
+    sections, processing instructions, DTD and quoted attribute values.
+ */
+class ElementsReader
+{
+public:
+    explicit ElementsReader(std::istream& file) : m_file(file), m_pos(0), m_consumed(0), m_sawRoot(false) {}
+
+    /**
+        Reads next <header> or <tu> element into @a xml.
+
+        Returns element's name or empty string at the end of the file.
+     */
+    std::string Next(std::string& xml)
+    {
+        if (m_pos > CHUNK_SIZE)
+        {
+            m_buffer.erase(0, m_pos);
+            m_consumed += m_pos;
+            m_pos = 0;
+        }
+
+        for (;;)
+        {
+            size_t start = Find("<", m_pos);
+            if (start == std::string::npos)
+                return std::string();
+
+            if (SkipMarkup(start, m_pos))
+                continue;
+
+            if (StartsWith(start, "</"))
+            {
+                m_pos = FindTagEnd(start) + 1;
+                continue;
+            }
+
+            auto name = ReadName(start + 1);
+            auto tagEnd = FindTagEnd(start);
+
+            if (name != "tu" && name != "header")
+            {
+                // container element such as <tmx> or <body>, descend into it:
+                if (name == "tmx")
+                    m_sawRoot = true;
+                m_pos = tagEnd + 1;
+                continue;
+            }
+
+            size_t end = (m_buffer[tagEnd - 1] == '/') ? tagEnd + 1 : FindEndTag(name, tagEnd + 1);
+            xml.assign(m_buffer, start, end - start);
+            m_pos = end;
+            return name;
+        }
+    }
+
+    /// Returns true if <tmx> root element was encountered.
+    bool SawRoot() const { return m_sawRoot; }
+
+    /// Returns number of bytes of the file processed so far.
+    uint64_t GetBytesRead() const { return m_consumed + m_pos; }
+
+private:
+    static const size_t CHUNK_SIZE = 1024 * 1024;
+
+    // Reads more data into the buffer, returns false at EOF
+    bool Fill()
+    {
+        if (!m_file)
+            return false;
+        const size_t oldSize = m_buffer.size();
+        m_buffer.resize(oldSize + CHUNK_SIZE);
+        m_file.read(&m_buffer[oldSize], CHUNK_SIZE);
+        m_buffer.resize(oldSize + (size_t)m_file.gcount());
+        return m_buffer.size() > oldSize;
+    }
+
+    // Ensures at least @a count bytes are available at @a pos, if possible
+    bool Ensure(size_t pos, size_t count)
+    {
+        while (m_buffer.size() < pos + count)
+        {
+            if (!Fill())
+                return false;
+        }
+        return true;
+    }
+
+    bool StartsWith(size_t pos, const char *s)
+    {
+        const size_t len = strlen(s);
+        return Ensure(pos, len) && m_buffer.compare(pos, len, s) == 0;
+    }
+
+    // Finds string @a s at or after @a from, reading more data as needed
+    size_t Find(const char *s, size_t from)
+    {
+        const size_t len = strlen(s);
+        for (;;)
+        {
+            auto found = m_buffer.find(s, from);
+            if (found != std::string::npos)
+                return found;
+            if (m_buffer.size() >= len)
+                from = std::max(from, m_buffer.size() - len + 1);
+            if (!Fill())
+                return std::string::npos;
+        }
+    }
+
+    size_t FindOrThrow(const char *s, size_t from)
+    {
+        auto found = Find(s, from);
+        if (found == std::string::npos)
+            throw_malformed();
+        return found;
+    }
+
+    // If there's a comment, CDATA, PI or DTD at @a pos, stores position just
+    // after it in @a after and returns true.
+    bool SkipMarkup(size_t pos, size_t& after)
+    {
+        if (StartsWith(pos, "<!--"))
+        {
+            after = FindOrThrow("-->", pos + 4) + 3;
+            return true;
+        }
+        if (StartsWith(pos, "<![CDATA["))
+        {
+            after = FindOrThrow("]]>", pos + 9) + 3;
+            return true;
+        }
+        if (StartsWith(pos, "<?"))
+        {
+            after = FindOrThrow("?>", pos + 2) + 2;
+            return true;
+        }
+        if (StartsWith(pos, "<!"))
+        {
+            // <!DOCTYPE ...> may contain internal subset in [...]
+            auto end = FindOrThrow(">", pos);
+            auto bracket = m_buffer.find('[', pos);
+            if (bracket < end)
+                end = FindOrThrow(">", FindOrThrow("]", bracket));
+            after = end + 1;
+            return true;
+        }
+        return false;
+    }
+
+    // Returns name of the tag starting at @a pos
+    std::string ReadName(size_t pos)
+    {
+        size_t end = pos;
+        for (;;)
+        {
+            if (!Ensure(end, 1))
+                throw_malformed();
+            const char c = m_buffer[end];
+            if (c == '>' || c == '/' || isspace((unsigned char)c))
+                break;
+            end++;
+        }
+        return m_buffer.substr(pos, end - pos);
+    }
+
+    // Finds the closing '>' of a tag starting at @a pos, skipping quoted attribute values
+    size_t FindTagEnd(size_t pos)
+    {
+        char quote = 0;
+        for (size_t i = pos + 1;; i++)
+        {
+            if (!Ensure(i, 1))
+                throw_malformed();
+            const char c = m_buffer[i];
+            if (quote)
+            {
+                if (c == quote)
+                    quote = 0;
+            }
+            else if (c == '"' || c == '\'')
+            {
+                quote = c;
+            }
+            else if (c == '>')
+            {
+                return i;
+            }
+        }
+    }
+
+    // Finds end of element @a name's content starting at @a from, returns
+    // position just after the end tag
+    size_t FindEndTag(const std::string& name, size_t from)
+    {
+        const std::string endTag = "</" + name;
+        for (;;)
+        {
+            auto pos = FindOrThrow("<", from);
+            if (SkipMarkup(pos, from))
+                continue;
+
+            if (StartsWith(pos, endTag.c_str()) && Ensure(pos, endTag.size() + 1))
+            {
+                const char c = m_buffer[pos + endTag.size()];
+                if (c == '>' || isspace((unsigned char)c))
+                    return FindTagEnd(pos) + 1;
+            }
+            from = pos + 1;
+        }
+    }
+
+    std::istream& m_file;
+    std::string m_buffer;
+    size_t m_pos;
+    uint64_t m_consumed;
+    bool m_sawRoot;
+};
+
+
+// Returns encoding to parse TMX files' fragments with, or encoding_auto if
+// the file can't be read in fragments and must be loaded as a whole.
+xml_encoding detect_encoding(std::istream& file)
+{
+    char head[256] = {0};
+    const auto start = file.tellg();
+    file.read(head, sizeof(head) - 1);
+    const auto len = (size_t)file.gcount();
+    file.clear();
+    file.seekg(start);
+
+    // UTF-16 and UTF-32 files have either BOM or zero bytes in the XML declaration:
+    if (len >= 2 && ((uint8_t(head[0]) == 0xFF && uint8_t(head[1]) == 0xFE) || (uint8_t(head[0]) == 0xFE && uint8_t(head[1]) == 0xFF)))
+        return encoding_auto;
+    if (memchr(head, 0, std::min(len, (size_t)4)))
+        return encoding_auto;
+
+    // Except for UTF-8, pugixml only supports Latin-1:
+    std::string decl(head, len);
+    std::transform(decl.begin(), decl.end(), decl.begin(), [](char c){ return (char)tolower((unsigned char)c); });
+    auto declEnd = decl.find("?>");
+    if (decl.compare(0, 5, "<?xml") == 0 && declEnd != std::string::npos)
+    {
+        decl.resize(declEnd);
+        if (decl.find("iso-8859-1") != std::string::npos || decl.find("latin1") != std::string::npos)
+            return encoding_latin1;
+    }
+    return encoding_utf8;
+}
+
+
+// Imports files that can't be streamed, i.e. in UTF-16 or UTF-32 encodings.
+int import_whole_document(std::istream& file, TranslationMemory& tm)
+{
+    xml_document doc;
+    auto result = doc.load(file);
+    if (!result)
+        BOOST_THROW_EXCEPTION(std::runtime_error(result.description()));
+
+    auto root = doc.child("tmx");
+    if (!root)
+        throw_malformed();
+
+    auto ctx = std::make_shared<ImportContext>();
+    auto header = root.child("header");
+    if (header)
+        ctx->ReadHeader(header);
+
     auto body = root.child("body");
     if (!body)
-        BOOST_THROW_EXCEPTION(Exception(_("The TMX file is malformed.")));
+        throw_malformed();
 
+    int counter = 0;
     tm.ImportData([=,&counter,&body](auto& writer)
     {
         auto tu_children = body.children("tu");
@@ -111,56 +480,144 @@ int TMX::ImportFromFile(std::istream& file, TranslationMemory& tm)
         for (auto tu: tu_children)
         {
             progress.increment();
+            counter += import_tu(tu, *ctx, writer);
+        }
+    });
+
+    return counter;
+}
+
+} // anonymous namespace
+
+
+int TMX::ImportFromFile(std::istream& file, TranslationMemory& tm)
+{
+    // Number of <tu> elements processed together. Reading of the next batch
+    // from the file overlaps with processing of the previous one, which is
+    // split between multiple threads.
+    const size_t BATCH_SIZE = 1000;
+
+    // Unit of progress reporting, so that multi-GB files fit into int:
+    const uint64_t PROGRESS_UNIT = 64 * 1024;
 
-            auto tuDate = extract_date(tu, defaultDate);
-            std::string tuSrclang = tu.attribute("srclang").value();
-            if (tuSrclang.empty())
-                tuSrclang = defaultSrclang;
+    auto encoding = detect_encoding(file);
+    if (encoding == encoding_auto)
+        return import_whole_document(file, tm);
 
-            std::wstring source;
-            for (auto tuv: tu.children("tuv"))
+    uint64_t fileSize = 0;
+    {
+        const auto start = file.tellg();
+        file.seekg(0, std::ios::end);
+        const auto end = file.tellg();
+        file.clear();
+        file.seekg(start);
+        if (start != std::streampos(-1) && end != std::streampos(-1))
+            fileSize = uint64_t(end - start);
+    }
+
+    wxStopWatch sw;
+    int counter = 0;
+
+    ImportContext ctx;
+    ElementsReader reader(file);
+
+    tm.ImportData([&](auto& writer)
+    {
+        Progress progress(int(fileSize / PROGRESS_UNIT) + 1);
+        int progressDone = 0;
+
+        auto process_batch = [&ctx, &writer, encoding](const std::vector<std::string>& batch)
+        {
+            std::atomic<int> count{0};
+            dispatch::parallel_for(batch.size(), [&](size_t i)
             {
-                if (extract_lang(tuv) == tuSrclang)
-                {
-                    source = extract_seg(tuv);
-                    break;
-                }
+                xml_document doc;
+                auto result = doc.load_buffer(batch[i].data(), batch[i].size(), parse_default, encoding);
+                if (!result)
+                    BOOST_THROW_EXCEPTION(std::runtime_error(result.description()));
+                count += import_tu(doc.first_child(), ctx, writer);
+            });
+            return count.load();
+        };
+
+        dispatch::future<int> pending;
+        auto wait_for_pending = [&]
+        {
+            if (pending.valid())
+                counter += pending.get();
+
+            const int done = int(reader.GetBytesRead() / PROGRESS_UNIT);
+            if (done > progressDone)
+            {
+                progress.increment(done - progressDone);
+                progressDone = done;
             }
-            if (source.empty())
-                continue;
+        };
 
-            for (auto tuv: tu.children("tuv"))
+        // Hands the batch over for processing, but only after the previous
+        // batch was done with, to keep memory use bounded:
+        auto batch = std::make_shared<std::vector<std::string>>();
+        auto submit_batch = [&]
+        {
+            wait_for_pending();
+            if (batch->empty())
+                return;
+            pending = dispatch::async([process_batch, batch]{ return process_batch(*batch); });
+            batch = std::make_shared<std::vector<std::string>>();
+        };
+
+        try
+        {
+            std::string xml;
+            for (;;)
             {
-                auto tuvLang = extract_lang(tuv);
-                if (tuvLang == tuSrclang)
-                    continue;
-
-                auto srclang = Language::TryParse(tuSrclang);
-                auto lang = Language::TryParse(tuvLang);
-                if (!srclang.IsValid() || !lang.IsValid())
-                    continue;
-
-                auto trans = extract_seg(tuv);
-                if (trans.empty())
-                    continue;
-
-                time_t creationTime = 0;
-                auto tuvDate = extract_date(tu, tuDate);
-                if (!tuvDate.empty())
+                auto name = reader.Next(xml);
+                if (name.empty())
+                    break;
+
+                // reject files that aren't TMX before anything is imported from them:
+                if (!reader.SawRoot())
+                    throw_malformed();
+
+                if (name == "tu")
                 {
-                    struct tm t {};
-                    std::istringstream s(tuvDate.c_str());
-                    s >> std::get_time(&t, "%Y%m%dT%H%M%SZ"); // YYYYMMDDThhmmssZ
-                    if (!s.fail())
-                        creationTime = timegm(&t);
+                    batch->push_back(std::move(xml));
+                    xml.clear();
+                    if (batch->size() >= BATCH_SIZE)
+                        submit_batch();
+                }
+                else // <header>
+                {
+                    // defaults from the header apply to all following <tu> elements:
+                    submit_batch();
+                    wait_for_pending();
+
+                    xml_document doc;
+                    auto result = doc.load_buffer(xml.data(), xml.size(), parse_default, encoding);
+                    if (!result)
+                        BOOST_THROW_EXCEPTION(std::runtime_error(result.description()));
+                    ctx.ReadHeader(doc.first_child());
                 }
-
-                writer.Insert(srclang, lang, source, trans, creationTime);
-                counter++;
             }
+
+            if (!reader.SawRoot())
+                throw_malformed();
+
+            submit_batch();
+            wait_for_pending();
+        }
+        catch (...)
+        {
+            // don't leave the batch being processed with dangling references
+            if (pending.valid())
+                pending.wait();
+            throw;
         }
     });
 
+    wxLogTrace("poedit.tm", "imported %d TMX entries in %ld ms (%.0f entries/s)",
+               counter, sw.Time(), sw.Time() ? counter * 1000.0 / sw.Time() : 0.0);
+
     return counter;
 }
 
@@ -169,12 +626,15 @@ int TMX::ImportFromFile(std::istream& file, TranslationMemory& tm)
 
 void TMX::ExportToFile(TranslationMemory& tm, std::ostream& file)
 {
+    // Writes <tu> elements directly to the output as they come, in chunks
+    // formatted by pugixml, so that the whole TM is never held in memory.
     class Exporter : public TranslationMemory::IOInterface
     {
     public:
-        Exporter()
+        Exporter(std::ostream& file) : m_file(file), m_count(0)
         {
-            auto root = m_doc.append_child("tmx");
+            xml_document doc;
+            auto root = doc.append_child("tmx");
             root.append_attribute("version") = "1.4";
             auto header = root.append_child("header");
             header.append_attribute("creationtool") = "Poedit";
@@ -184,7 +644,12 @@ void TMX::ExportToFile(TranslationMemory& tm, std::ostream& file)
             header.append_attribute("adminlang") = "en";
             header.append_attribute("srclang") = "en"; // reasonable default for gettext
             header.append_attribute("o-tmf") = "PoeditTM";
-            m_body = root.append_child("body");
+
+            m_file << "<?xml version=\"1.0\"?>\n<tmx version=\"1.4\">\n";
+            header.print(m_file, "\t", format_default, encoding_utf8, 1);
+            m_file << "\t<body>\n";
+
+            m_body = m_chunk.append_child("body");
         }
 
         void Insert(const Language& srclang,
@@ -217,19 +682,36 @@ void TMX::ExportToFile(TranslationMemory& tm, std::ostream& file)
                 tuv.append_attribute("xml:lang") = lang.LanguageTag().c_str();
                 tuv.append_child("seg").text() = pugi::as_utf8(trans).c_str();
             }
+
+            if (++m_count % CHUNK_SIZE == 0)
+                FlushChunk();
         }
 
-        void Save(std::ostream& f)
+        void Finish()
         {
-            m_doc.save(f);
+            FlushChunk();
+            m_file << "\t</body>\n</tmx>\n";
         }
 
     private:
-        xml_document m_doc;
+        // Number of <tu> elements kept in memory before writing them out
+        static const int CHUNK_SIZE = 1000;
+
+        void FlushChunk()
+        {
+            for (auto tu: m_body.children())
+                tu.print(m_file, "\t", format_default, encoding_utf8, 2);
+            m_chunk.reset();
+            m_body = m_chunk.append_child("body");
+        }
+
+        std::ostream& m_file;
+        xml_document m_chunk;
         xml_node m_body;
+        int m_count;
     };
 
-    Exporter e;
+    Exporter e(file);
     tm.ExportData(e);
-    e.Save(file);
+    e.Finish();
 }
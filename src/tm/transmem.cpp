@@ -26,7 +26,9 @@
 #include "transmem.h"
 
 #include "catalog.h"
+#include "configuration.h"
 #include "errors.h"
+#include "fuzzy_match.h"
 #include "progress.h"
 #include "str_helpers.h"
 #include "utility.h"
@@ -38,7 +40,14 @@
 #include <wx/translation.h>
 
 #include <time.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
 #include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 
 #include <boost/algorithm/string/find.hpp>
 #include <boost/uuid/uuid.hpp>
@@ -48,6 +57,7 @@
 
 #include <Lucene.h>
 #include <LuceneException.h>
+#include <ConcurrentMergeScheduler.h>
 #include <MMapDirectory.h>
 #include <SerialMergeScheduler.h>
 #include <SimpleFSDirectory.h>
@@ -58,13 +68,15 @@
 #include <Document.h>
 #include <Field.h>
 #include <DateField.h>
-#include <PrefixQuery.h>
 #include <StringUtils.h>
+#include <TermDocs.h>
+#include <TermEnum.h>
 #include <TermQuery.h>
 #include <BooleanQuery.h>
 #include <PhraseQuery.h>
 #include <Term.h>
 #include <ScoreDoc.h>
+#include <SetBasedFieldSelector.h>
 #include <TopDocs.h>
 #include <StringReader.h>
 #include <TokenStream.h>
@@ -97,6 +109,80 @@ namespace
     }
 
 
+// Runs refreshes of readers in a single background thread shared by all
+// shards. Refreshes requested in quick succession (e.g. by commit touching
+// several shards) are done together after a short delay.
+class BackgroundRefresher
+{
+public:
+    BackgroundRefresher(std::chrono::milliseconds delay) : m_delay(delay), m_stop(false)
+    {
+        m_thread = std::thread([this]{ Run(); });
+    }
+
+    ~BackgroundRefresher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+            m_cv.notify_one();
+        }
+        m_thread.join();
+    }
+
+    /// Schedules refresh to be done soon
+    void Request(std::function<void()> refresh)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.push_back(refresh);
+        m_cv.notify_one();
+    }
+
+private:
+    void Run()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            m_cv.wait(lock, [this]{ return !m_pending.empty() || m_stop; });
+            if (m_stop)
+                return;
+            m_cv.wait_for(lock, m_delay, [this]{ return m_stop; });
+            if (m_stop)
+                return;
+
+            std::vector<std::function<void()>> pending;
+            pending.swap(m_pending);
+
+            lock.unlock();
+            for (auto& refresh: pending)
+            {
+                try
+                {
+                    refresh();
+                }
+                catch (...)
+                {
+                    // not fatal, the next query will try again
+                    wxLogTrace("poedit.tm", "refreshing TM reader failed: %s", DescribeCurrentException());
+                }
+            }
+            pending.clear(); // release references before locking again
+            lock.lock();
+        }
+    }
+
+    std::chrono::milliseconds m_delay;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<std::function<void()>> m_pending;
+    bool m_stop;
+
+    std::thread m_thread;
+};
+
+
 // Manages IndexReader and Searcher instances in multi-threaded environment.
 // Curiously, Lucene uses shared_ptr-based refcounting *and* explicit one as
 // well, with a crucial part not well protected.
@@ -106,30 +192,90 @@ namespace
 // class, see
 // http://blog.mikemccandless.com/2011/09/lucenes-searchermanager-simplifies.html
 // http://blog.mikemccandless.com/2011/11/near-real-time-readers-with-lucenes.html
-class SearcherManager
+//
+// Searches never block each other: the current reader and searcher are kept
+// in an immutable snapshot that is replaced atomically when the index changes.
+// Readers are reopened by a background thread shortly after a commit and also,
+// if a query comes before that, by the query itself.
+class SearcherManager : public std::enable_shared_from_this<SearcherManager>
 {
+    // Reader and searcher over the same state of the index
+    struct Snapshot
+    {
+        Snapshot(IndexReaderPtr r, unsigned gen, std::shared_ptr<std::mutex> mutex)
+            : reader(r), searcher(newLucene<IndexSearcher>(r)), generation(gen), refMutex(mutex)
+        {}
+
+        ~Snapshot()
+        {
+            searcher.reset();
+            std::lock_guard<std::mutex> guard(*refMutex);
+            reader->decRef();
+        }
+
+        IndexReaderPtr reader;
+        IndexSearcherPtr searcher;
+        unsigned generation;
+        std::shared_ptr<std::mutex> refMutex;
+    };
+
+    typedef std::shared_ptr<const Snapshot> SnapshotPtr;
+
 public:
-    SearcherManager(IndexWriterPtr writer)
+    SearcherManager(IndexWriterPtr writer, std::shared_ptr<BackgroundRefresher> refresher)
+        : m_refMutex(std::make_shared<std::mutex>()),
+          m_refresher(refresher),
+          m_generation(0)
     {
-        m_reader = writer->getReader();
-        m_searcher = newLucene<IndexSearcher>(m_reader);
+        m_current = std::make_shared<Snapshot>(writer->getReader(), 0, m_refMutex);
     }
 
     ~SearcherManager()
     {
-        m_searcher.reset();
-        m_reader->decRef();
+        std::atomic_store(&m_current, SnapshotPtr());
     }
 
-    // Safe, properly ref-counting (in Lucene way, not just shared_ptr) holder.
+    /// Counter of modifications of the TM, shared by all instances
+    static unsigned GetGeneration() { return ms_tmGeneration.load(); }
+
+    /// Increments the counter for changes done outside of the writer
+    static void IncrementGeneration() { ms_tmGeneration++; }
+
+    /// Notifies about a change to the index. The reader is only reopened
+    /// lazily, by the next query, because reopening NRT reader flushes
+    /// writer's RAM buffer into a new (small) segment.
+    void NotifyChanged()
+    {
+        m_generation++;
+        IncrementGeneration();
+    }
+
+    /// Notifies about committed or rolled back changes; unlike NotifyChanged(),
+    /// this refreshes the reader in background so that queries don't have to.
+    void NotifyCommitted()
+    {
+        NotifyChanged();
+
+        auto refresher = m_refresher.lock();
+        if (!refresher)
+            return; // the TM is being closed
+
+        std::weak_ptr<SearcherManager> weakSelf = shared_from_this();
+        refresher->Request([weakSelf]
+        {
+            if (auto self = weakSelf.lock())
+                self->Refresh();
+        });
+    }
+
+    // Holder of reader or searcher that keeps its snapshot alive while used.
     template<typename T>
     class SafeRef
     {
     public:
         typedef boost::shared_ptr<T> TPtr;
 
-        SafeRef(SafeRef&& other) : m_mng(other.m_mng) { std::swap(m_ptr, other.m_ptr); }
-        ~SafeRef() { if (m_ptr) m_mng.DecRef(m_ptr); }
+        SafeRef(SafeRef&& other) = default;
 
         TPtr ptr() { return m_ptr; }
         T* operator->() const { return m_ptr.get(); }
@@ -139,96 +285,545 @@ public:
 
     private:
         friend class SearcherManager;
-        explicit SafeRef(SearcherManager& m, TPtr ptr) : m_mng(m), m_ptr(ptr) {}
+        explicit SafeRef(SnapshotPtr snapshot, TPtr ptr) : m_snapshot(snapshot), m_ptr(ptr) {}
 
-        SearcherManager& m_mng;
-        boost::shared_ptr<T> m_ptr;
+        SnapshotPtr m_snapshot;
+        TPtr m_ptr;
     };
 
     SafeRef<IndexReader> Reader()
     {
-        std::lock_guard<std::mutex> guard(m_mutex);
-        ReloadReaderIfNeeded();
-        m_reader->incRef();
-        return SafeRef<IndexReader>(*this, m_reader);
+        auto snapshot = Current();
+        return SafeRef<IndexReader>(snapshot, snapshot->reader);
     }
 
     SafeRef<IndexSearcher> Searcher()
     {
-        std::lock_guard<std::mutex> guard(m_mutex);
-        ReloadReaderIfNeeded();
-        m_searcher->getIndexReader()->incRef();
-        return SafeRef<IndexSearcher>(*this, m_searcher);
+        auto snapshot = Current();
+        return SafeRef<IndexSearcher>(snapshot, snapshot->searcher);
     }
 
 private:
-    void ReloadReaderIfNeeded()
+    // Returns snapshot reflecting all changes done so far
+    SnapshotPtr Current()
     {
-        // contract: m_mutex is locked when this function is called
-        if (m_reader->isCurrent())
-            return; // nothing to do
+        auto snapshot = std::atomic_load(&m_current);
+        if (snapshot->generation == m_generation.load())
+            return snapshot; // fast path, no locking
+        return Refresh();
+    }
 
-        auto newReader = m_reader->reopen();
-        auto newSearcher = newLucene<IndexSearcher>(newReader);
+    // Reopens the reader if the index changed and publishes new snapshot
+    SnapshotPtr Refresh()
+    {
+        std::lock_guard<std::mutex> guard(m_refreshMutex);
 
-        m_reader->decRef();
+        // generation must be read before reopening, so that changes made
+        // during it are picked up by the next refresh:
+        auto generation = m_generation.load();
+        auto snapshot = std::atomic_load(&m_current);
+        if (snapshot->generation == generation)
+            return snapshot; // another thread refreshed it meanwhile
+
+        IndexReaderPtr newReader;
+        {
+            std::lock_guard<std::mutex> refGuard(*m_refMutex);
+            if (snapshot->reader->isCurrent())
+            {
+                // nothing changed in the index itself (e.g. commit of no
+                // changes), so just keep using the reader
+                newReader = snapshot->reader;
+                newReader->incRef();
+            }
+            else
+            {
+                newReader = snapshot->reader->reopen();
+            }
+        }
 
-        m_reader = newReader;
-        m_searcher = newSearcher;
+        snapshot = std::make_shared<Snapshot>(newReader, generation, m_refMutex);
+        std::atomic_store(&m_current, snapshot);
+        return snapshot;
     }
 
-    void DecRef(IndexReaderPtr& r)
+    SnapshotPtr m_current;
+    std::mutex m_refreshMutex;
+
+    // Guards Lucene's explicit refcounting, see above
+    std::shared_ptr<std::mutex> m_refMutex;
+
+    // not owned, so that the refresher thread never destroys itself
+    std::weak_ptr<BackgroundRefresher> m_refresher;
+
+    // Changes of this index; snapshot is current if it has the same value
+    std::atomic<unsigned> m_generation;
+
+    // Changes of all indexes, for TranslationMemory::GetGeneration()
+    static std::atomic<unsigned> ms_tmGeneration;
+};
+
+std::atomic<unsigned> SearcherManager::ms_tmGeneration(0);
+
+
+// Commits changes to the TM in a background thread, grouping requests made
+// in quick succession into a single commit, because Lucene commits are
+// expensive. A requested commit happens after the delay at the latest.
+class BackgroundCommitter
+{
+public:
+    BackgroundCommitter(std::function<void()> commit, std::chrono::milliseconds delay)
+        : m_commit(commit), m_delay(delay), m_pending(false), m_urgent(false), m_stop(false)
     {
-        std::lock_guard<std::mutex> guard(m_mutex);
-        r->decRef();
+        m_thread = std::thread([this]{ Run(); });
     }
-    void DecRef(IndexSearcherPtr& s)
+
+    ~BackgroundCommitter() { Stop(); }
+
+    // Requests commit to happen within the delay
+    void Request()
     {
-        std::lock_guard<std::mutex> guard(m_mutex);
-        s->getIndexReader()->decRef();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_pending)
+        {
+            m_pending = true;
+            m_deadline = std::chrono::steady_clock::now() + m_delay;
+        }
+        m_cv.notify_one();
     }
 
-    IndexReaderPtr   m_reader;
-    IndexSearcherPtr m_searcher;
-    std::mutex       m_mutex;
+    // Requests commit to happen as soon as possible
+    void RequestNow()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending = m_urgent = true;
+        m_cv.notify_one();
+    }
+
+    // Stops the thread, after doing any pending commit
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+            m_cv.notify_one();
+        }
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+
+private:
+    void Run()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            m_cv.wait(lock, [this]{ return m_pending || m_stop; });
+            if (!m_pending)
+                return;
+
+            m_cv.wait_until(lock, m_deadline, [this]{ return m_urgent || m_stop; });
+            m_pending = m_urgent = false;
+
+            lock.unlock();
+            try
+            {
+                m_commit();
+            }
+            catch (...)
+            {
+                wxLogTrace("poedit.tm", "background commit failed: %s", DescribeCurrentException());
+            }
+            lock.lock();
+        }
+    }
+
+    std::function<void()> m_commit;
+    std::chrono::milliseconds m_delay;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_pending, m_urgent, m_stop;
+    std::chrono::steady_clock::time_point m_deadline;
+
+    std::thread m_thread;
 };
 
 
+// Returns key of the source text in given languages used to look up exact
+// matches quickly. It is stored, indexed, in the "exact" field of documents.
+std::wstring get_exact_match_key(const Language& srclang, const std::wstring& lang, const std::wstring& source)
+{
+    static const boost::uuids::uuid s_namespace =
+      boost::uuids::string_generator()("5284ba63-6229-4ceb-a153-67d50216419d");
+    boost::uuids::name_generator gen(s_namespace);
+
+    std::wstring id(srclang.WCode());
+    id += L'\x01';
+    id += lang;
+    id += L'\x01';
+    id += source;
+
+    return boost::uuids::to_wstring(gen(id));
+}
+
+
+// Returns source text split into (normalized) tokens by the analyzer
+std::vector<std::wstring> tokenize(AnalyzerPtr analyzer, const std::wstring& text)
+{
+    std::vector<std::wstring> tokens;
+    auto stream = analyzer->tokenStream(L"source", newLucene<StringReader>(text));
+    while (stream->incrementToken())
+        tokens.push_back(stream->getAttribute<TermAttribute>()->term());
+    return tokens;
+}
+
+// Returns number of tokens the analyzer splits source text into
+int count_tokens(AnalyzerPtr analyzer, const std::wstring& text)
+{
+    auto stream = analyzer->tokenStream(L"source", newLucene<StringReader>(text));
+    int count = 0;
+    while (stream->incrementToken())
+        count++;
+    return count;
+}
+
+
+// Current version of documents' content, see TranslationMemoryImpl::MigrateDocuments().
+// Version 1 adds "exact", "ntokens" and "srclen" fields.
+const long DOCUMENTS_FORMAT_VERSION = 1;
+
+
+// Returns language code without the country part, e.g. 'sr@latin' for 'sr_RS@latin'
+Lucene::String GetLangAndVariant(const Language& lang)
+{
+    Lucene::String code = StringUtils::toUnicode(lang.Lang());
+    const auto variant = lang.Variant();
+    if (!variant.empty())
+        code += L"@" + StringUtils::toUnicode(variant);
+    return code;
+}
+
+
 struct SearchArguments
 {
-    QueryPtr srclang, lang;
+    QueryPtr langFilter;
     QueryPtr query;
     std::wstring exactSourceText;
+    Language srclangValue, langValue;
 
     void set_lang(const Language& srclang_, const Language& lang_)
     {
-        // TODO: query by srclang too!
-        this->srclang = newLucene<TermQuery>(newLucene<Term>(L"srclang", srclang_.WCode()));
-
+        srclangValue = srclang_;
+        langValue = lang_;
+
+        // Shards only contain documents with the same source language and
+        // target language family and modifier (see Shard), so searching for
+        // e.g. 'cs' or 'sr@latin' needs no filtering, because 'cs_*' or
+        // 'sr_*@latin' variants should match as well. Regional variants must
+        // still exclude other regions, though: 'pt_BR' should find 'pt_BR'
+        // and 'pt', but not 'pt_PT'.
         const Lucene::String fullLang = lang_.WCode();
-        const Lucene::String shortLang = StringUtils::toUnicode(lang_.Lang());
+        const Lucene::String shortLang = GetLangAndVariant(lang_);
 
-        QueryPtr langPrimary = newLucene<TermQuery>(newLucene<Term>(L"lang", fullLang));
-        QueryPtr langSecondary;
         if (fullLang == shortLang)
         {
-            // for e.g. 'cs', search also 'cs_*' (e.g. 'cs_CZ')
-            langSecondary = newLucene<PrefixQuery>(newLucene<Term>(L"lang", shortLang + L"_"));
+            langFilter.reset();
         }
         else
         {
-            // search short variants of the language too
-            langSecondary = newLucene<TermQuery>(newLucene<Term>(L"lang", shortLang));
+            auto langQ = newLucene<BooleanQuery>();
+            langQ->add(newLucene<TermQuery>(newLucene<Term>(L"lang", fullLang)), BooleanClause::SHOULD);
+            langQ->add(newLucene<TermQuery>(newLucene<Term>(L"lang", shortLang)), BooleanClause::SHOULD);
+            langFilter = langQ;
         }
-        langSecondary->setBoost(0.85);
-        auto langQ = newLucene<BooleanQuery>();
-        langQ->add(langPrimary, BooleanClause::SHOULD);
-        langQ->add(langSecondary, BooleanClause::SHOULD);
+    }
 
-        this->lang = langQ;
+    // Returns the query combined with language filter, if any
+    QueryPtr full_query() const
+    {
+        if (!langFilter)
+            return query;
+
+        auto fullQuery = newLucene<BooleanQuery>();
+        fullQuery->add(langFilter, BooleanClause::MUST);
+        fullQuery->add(query, BooleanClause::MUST);
+        return fullQuery;
+    }
+};
+
+
+#ifdef __WXMSW__
+typedef SimpleFSDirectory DirectoryType;
+#else
+typedef MMapDirectory DirectoryType;
+#endif
+
+// One partition of the TM, an index holding translations from a single
+// source language into a single language family (e.g. 'pt', 'pt_BR' and
+// 'pt_PT'). Languages with a modifier, such as 'sr@latin', are kept apart
+// from the unmodified ones. Queries only ever need to look into one shard.
+class Shard
+{
+public:
+    Shard(const std::wstring& path, AnalyzerPtr analyzer, double ramBufferSizeMB,
+          std::shared_ptr<BackgroundRefresher> refresher)
+        : m_changed(false)
+    {
+        wxFileName::Mkdir(path, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+        auto dir = newLucene<DirectoryType>(path);
+
+        writer = newLucene<IndexWriter>(dir, analyzer, IndexWriter::MaxFieldLengthLIMITED);
+        writer->setRAMBufferSizeMB(ramBufferSizeMB);
+
+        // Merging segments can take a long time with large TMs; doing it in
+        // background threads prevents it from stalling writes and commits.
+        // Serial merging is kept as a fallback option.
+        if (Config::TMConcurrentMerges())
+            writer->setMergeScheduler(newLucene<ConcurrentMergeScheduler>());
+        else
+            writer->setMergeScheduler(newLucene<SerialMergeScheduler>());
+
+        // get the associated realtime reader & searcher:
+        mng = std::make_shared<SearcherManager>(writer, refresher);
+    }
+
+    ~Shard()
+    {
+        mng.reset();
+        writer->close();
     }
+
+    /// Notifies about a change to the shard's index
+    void NotifyChanged()
+    {
+        m_changed = true;
+        mng->NotifyChanged();
+    }
+
+    /// Returns true if the shard has changed since the last call
+    bool TakeChanged() { return m_changed.exchange(false); }
+
+    IndexWriterPtr writer;
+    std::shared_ptr<SearcherManager> mng;
+
+private:
+    std::atomic<bool> m_changed;
 };
 
+typedef std::shared_ptr<Shard> ShardPtr;
+
+
+// Read-only access to documents of a shard, see ShardedIndex::Readers()
+struct ShardReader
+{
+    std::wstring name;
+    IndexReaderPtr reader;
+    bool isOpen;                    // shard was open for writing
+    std::shared_ptr<void> holder;   // keeps the reader valid while used
+};
+
+
+// Collection of all shards of the TM, stored in subdirectories of the
+// database directory. Shards are only opened when first needed.
+class ShardedIndex
+{
+public:
+    ShardedIndex(const std::wstring& path, AnalyzerPtr analyzer)
+        : m_path(path), m_analyzer(analyzer), m_ramBudgetMB(0), m_closed(false)
+    {
+        // short delay to group refreshes of shards changed by the same commit
+        m_refresher = std::make_shared<BackgroundRefresher>(std::chrono::milliseconds(50));
+    }
+
+    /// Returns shard for given languages, creating it if it doesn't exist yet
+    ShardPtr Get(const Language& srclang, const Language& lang)
+    {
+        return Open(GetShardName(srclang, lang), true);
+    }
+
+    /// Returns existing shard for given languages or nullptr if there's none
+    ShardPtr Find(const Language& srclang, const Language& lang)
+    {
+        return Open(GetShardName(srclang, lang), false);
+    }
+
+    /// Returns existing shard with given name, opening it if needed
+    ShardPtr Get(const std::wstring& name)
+    {
+        return Open(name, false);
+    }
+
+    /// Returns names of all existing shards
+    std::vector<std::wstring> Names()
+    {
+        std::vector<std::wstring> names;
+        if (wxFileName::DirExists(m_path))
+        {
+            wxDir dir(m_path);
+            wxString name;
+            for (bool cont = dir.GetFirst(&name, wxEmptyString, wxDIR_DIRS); cont; cont = dir.GetNext(&name))
+                names.push_back(name.ToStdWstring());
+        }
+        return names;
+    }
+
+    /// Returns all existing shards, opening them if needed
+    std::vector<ShardPtr> All()
+    {
+        std::vector<ShardPtr> all;
+        for (auto& name: Names())
+        {
+            if (auto shard = Open(name, false))
+                all.push_back(shard);
+        }
+        return all;
+    }
+
+    /**
+        Returns readers of all existing shards, for enumerating documents.
+
+        Open shards provide their current reader, including uncommitted
+        changes. Other shards can't have any and are read from the disk with
+        read-only readers, without opening them (and their writers) at all.
+     */
+    std::vector<ShardReader> Readers()
+    {
+        std::vector<ShardReader> readers;
+        for (auto& name: Names())
+        {
+            ShardPtr shard;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto i = m_shards.find(name);
+                if (i != m_shards.end())
+                    shard = i->second;
+            }
+
+            if (shard)
+            {
+                auto ref = std::make_shared<SearcherManager::SafeRef<IndexReader>>(shard->mng->Reader());
+                readers.push_back({name, ref->ptr(), true, ref});
+            }
+            else
+            {
+                auto dir = newLucene<DirectoryType>(m_path + wxFILE_SEP_PATH + name);
+                if (!IndexReader::indexExists(dir))
+                    continue;
+                auto reader = IndexReader::open(dir, true);
+                std::shared_ptr<void> closer(reader.get(), [reader](void*)
+                {
+                    try { reader->close(); } catch (LuceneException&) {}
+                });
+                readers.push_back({name, reader, false, closer});
+            }
+        }
+        return readers;
+    }
+
+    /// Closes the shard if nobody uses it, e.g. when it was opened only
+    /// temporarily for maintenance. Its pending changes are committed.
+    void CloseIfUnused(const std::wstring& name)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto i = m_shards.find(name);
+        if (i == m_shards.end() || i->second.use_count() > 1)
+            return;
+
+        // closed under the lock, so that it can't be reopened meanwhile
+        wxLogTrace("poedit.tm", "closing TM shard %s", name);
+        m_shards.erase(i);
+
+        if (m_ramBudgetMB > 0)
+        {
+            const double perShard = GetRAMBufferSizeMB(m_shards.size());
+            for (auto& s: m_shards)
+                s.second->writer->setRAMBufferSizeMB(perShard);
+        }
+    }
+
+    /// Returns shards that are currently open
+    std::vector<ShardPtr> Opened()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<ShardPtr> opened;
+        for (auto& i: m_shards)
+            opened.push_back(i.second);
+        return opened;
+    }
+
+    /// Sets total size of in-memory buffers of added documents, which is
+    /// divided among all open shards, including those opened later.
+    /// Zero restores Lucene's default size of each shard's buffer.
+    void SetRAMBufferBudgetMB(double mb)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_ramBudgetMB = mb;
+        const double perShard = GetRAMBufferSizeMB(m_shards.size());
+        for (auto& i: m_shards)
+            i.second->writer->setRAMBufferSizeMB(perShard);
+    }
+
+    AnalyzerPtr GetAnalyzer() const { return m_analyzer; }
+
+    /// Closes all shards; they can't be opened again afterwards
+    void Close()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_shards.clear();
+    }
+
+private:
+    // Returns buffer size for each of @a count shards
+    double GetRAMBufferSizeMB(size_t count) const
+    {
+        if (m_ramBudgetMB <= 0 || count == 0)
+            return IndexWriter::DEFAULT_RAM_BUFFER_SIZE_MB;
+        return m_ramBudgetMB / count;
+    }
+
+    static std::wstring GetShardName(const Language& srclang, const Language& lang)
+    {
+        return srclang.WCode() + L"-" + GetLangAndVariant(lang);
+    }
+
+    ShardPtr Open(const std::wstring& name, bool create)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_closed)
+            boost::throw_exception(AlreadyClosedException(L"translation memory is closed"));
+
+        auto i = m_shards.find(name);
+        if (i != m_shards.end())
+            return i->second;
+
+        const std::wstring path = m_path + wxFILE_SEP_PATH + name;
+        if (!create && !wxFileName::DirExists(path))
+            return nullptr;
+
+        wxLogTrace("poedit.tm", "opening TM shard %s", name);
+        const double perShard = GetRAMBufferSizeMB(m_shards.size() + 1);
+        auto shard = std::make_shared<Shard>(path, m_analyzer, perShard, m_refresher);
+        if (m_ramBudgetMB > 0)
+        {
+            // the budget is shared with the new shard now
+            for (auto& i: m_shards)
+                i.second->writer->setRAMBufferSizeMB(perShard);
+        }
+        m_shards.emplace(name, shard);
+        return shard;
+    }
+
+    const std::wstring m_path;
+    AnalyzerPtr m_analyzer;
+
+    std::mutex m_mutex;
+    std::map<std::wstring, ShardPtr> m_shards;
+    double m_ramBudgetMB;
+    bool m_closed;
+
+    std::shared_ptr<BackgroundRefresher> m_refresher;
+};
 
 } // anonymous namespace
 
@@ -239,23 +834,29 @@ struct SearchArguments
 class TranslationMemoryImpl
 {
 public:
-#ifdef __WXMSW__
-    typedef SimpleFSDirectory DirectoryType;
-#else
-    typedef MMapDirectory DirectoryType;
-#endif
-
     TranslationMemoryImpl() { Init(); }
 
     ~TranslationMemoryImpl()
     {
-        m_mng.reset();
-        m_writer->close();
+        StopMigration();
+        m_committer->Stop();
+        m_index->Close();
+    }
+
+    /// Stops migration of old documents, if running, and waits for it to finish
+    void StopMigration()
+    {
+        m_migrationCancelled = true;
+        if (m_migration.valid())
+            m_migration.wait();
     }
 
     SuggestionsList Search(const Language& srclang, const Language& lang,
                            const std::wstring& source);
 
+    std::vector<SuggestionsList> SearchBatch(const Language& srclang, const Language& lang,
+                                             const std::vector<std::wstring>& sources);
+
     void ExportData(TranslationMemory::IOInterface& destination);
     void ImportData(std::function<void(TranslationMemory::IOInterface&)> source);
 
@@ -266,17 +867,61 @@ public:
 
     void GetStats(long& numDocs, long& fileSize);
 
+    TranslationMemory::CompactionResults Compact();
+
     static std::wstring GetDatabaseDir();
 
+    /// Checks for the single, unsharded index used by older versions
+    static bool HasLegacyIndex();
+
+    /// Deletes the legacy index, see HasLegacyIndex()
+    static void DeleteLegacyIndex();
+
 private:
     void Init();
 
+    // Moves documents from the legacy index into shards and upgrades
+    // documents written by older versions to contain all fields current
+    // version uses. Runs in background, once.
+    void MigrateDocuments();
+
+    // Moves documents from the legacy index, if there's any, into shards.
+    // Returns number of moved documents. May throw. If it is already
+    // running in another thread, waits for it to finish first.
+    int MigrateLegacyIndex(const std::atomic<bool>& cancelled);
+
+    // Returns number of documents in the legacy index that weren't moved
+    // into shards yet
+    int CountLegacyDocuments();
+
+    // Does the upgrading part of MigrateDocuments() for all shards,
+    // returns number of upgraded documents. May throw.
+    int UpgradeDocuments(const std::atomic<bool>& cancelled);
+    int UpgradeDocuments(const ShardReader& shard, const std::atomic<bool>& cancelled);
+
+    // Removes older revisions of translations, see Compact()
+    int RemoveNearDuplicates(const ShardReader& shard);
+
+    // Merges all segments of the shard's index into one, reporting progress
+    void MergeSegments(const ShardReader& shard, bool changed);
+
+    // Performs the search using given searcher, with language queries
+    // already set in @a sa. May throw LuceneException.
+    SuggestionsList DoSearch(IndexSearcherPtr searcher, SearchArguments sa,
+                             const std::wstring& source);
+
 private:
     AnalyzerPtr      m_analyzer;
-    IndexWriterPtr   m_writer;
-    std::shared_ptr<SearcherManager> m_mng;
+    std::shared_ptr<ShardedIndex> m_index;
 
     std::shared_ptr<TranslationMemory::Writer> m_writerAPI;
+    std::shared_ptr<BackgroundCommitter> m_committer;
+
+    dispatch::future<void> m_migration;
+    std::atomic<bool> m_migrationCancelled{false};
+
+    std::mutex m_legacyMigrationMutex;
+    std::atomic<int> m_legacyMigrated{0};
 };
 
 
@@ -301,6 +946,28 @@ std::wstring TranslationMemoryImpl::GetDatabaseDir()
 }
 
 
+bool TranslationMemoryImpl::HasLegacyIndex()
+{
+    const std::wstring path = GetDatabaseDir();
+    return wxFileName::DirExists(path) && IndexReader::indexExists(newLucene<DirectoryType>(path));
+}
+
+
+void TranslationMemoryImpl::DeleteLegacyIndex()
+{
+    // Shards live in subdirectories, so any files directly in the database
+    // directory belong to the legacy index:
+    const wxString path(GetDatabaseDir());
+    if (!wxFileName::DirExists(path))
+        return;
+
+    wxArrayString files;
+    wxDir::GetAllFiles(path, &files, wxEmptyString, wxDIR_FILES | wxDIR_HIDDEN);
+    for (auto& f: files)
+        wxRemoveFile(f);
+}
+
+
 namespace
 {
 
@@ -314,12 +981,13 @@ static const int MAX_RESULTS = 10;
 // a few hits regardless.
 static const int LUCENE_QUERY_MAX_DOCS = 500;
 
-// Normalized score that must be met for a suggestion to be shown. This is
-// an empirical guess of what constitutes good matches.
+// Similarity (see FuzzyMatcher) that must be met for a suggestion to be shown.
+// This is an empirical guess of what constitutes good matches.
 static const double QUALITY_THRESHOLD = 0.6;
 
-// Maximum allowed difference in phrase length, in #terms.
-static const int MAX_ALLOWED_LENGTH_DIFFERENCE = 3;
+// Maximum score of non-exact matches, which may still be 100% similar
+// if they differ only in case, punctuation or stop words.
+static const double MAX_FUZZY_SCORE = 0.95;
 
 
 void AddOrUpdateResult(SuggestionsList& all, Suggestion&& r)
@@ -362,6 +1030,38 @@ std::wstring get_text_field(DocumentPtr doc, const std::wstring& field)
 }
 
 
+// Returns true if the two texts are so similar that one is likely a revised
+// version of the other, e.g. with a typo fixed.
+bool is_near_duplicate(const std::wstring& a, const std::wstring& b)
+{
+    const double NEAR_DUPLICATE_SIMILARITY = 0.85;
+
+    const size_t longer = std::max(a.size(), b.size());
+    if (longer == 0)
+        return true;
+    if (std::min(a.size(), b.size()) < NEAR_DUPLICATE_SIMILARITY * longer)
+        return false; // edit distance is at least the difference in lengths
+
+    // character-level Levenshtein distance with a single row
+    std::vector<size_t> row(a.size() + 1);
+    for (size_t i = 0; i <= a.size(); i++)
+        row[i] = i;
+    for (size_t j = 0; j < b.size(); j++)
+    {
+        size_t diagonal = row[0];
+        row[0] = j + 1;
+        for (size_t i = 1; i <= a.size(); i++)
+        {
+            const size_t above = row[i];
+            row[i] = std::min({above + 1, row[i - 1] + 1, diagonal + (a[i - 1] == b[j] ? 0 : 1)});
+            diagonal = above;
+        }
+    }
+
+    return 1.0 - double(row[a.size()]) / longer >= NEAR_DUPLICATE_SIMILARITY;
+}
+
+
 void postprocess_results(SuggestionsList& results)
 {
     std::stable_sort(results.begin(), results.end());
@@ -370,73 +1070,185 @@ void postprocess_results(SuggestionsList& results)
 }
 
 
-template<typename T>
-void PerformSearchWithBlock(IndexSearcherPtr searcher,
-                            const SearchArguments& sa,
-                            double scoreThreshold,
-                            double scoreScaling,
-                            T callback)
+// Returns codes of all target languages admitted by the language filter
+std::vector<Lucene::String> get_searched_languages(IndexSearcherPtr searcher, const SearchArguments& sa)
 {
-    auto fullQuery = newLucene<BooleanQuery>();
-    fullQuery->add(sa.srclang, BooleanClause::MUST);
-    fullQuery->add(sa.lang, BooleanClause::MUST);
-    fullQuery->add(sa.query, BooleanClause::MUST);
+    if (sa.langFilter)
+        return { sa.langValue.WCode(), GetLangAndVariant(sa.langValue) };
+
+    // Without a filter, all languages in the shard match. There's only a few
+    // of them, e.g. 'cs' and 'cs_CZ', so enumerating them is cheap:
+    std::vector<Lucene::String> codes;
+    auto terms = searcher->getIndexReader()->terms(newLucene<Term>(L"lang", L""));
+    do
+    {
+        auto term = terms->term();
+        if (!term || term->field() != L"lang")
+            break;
+        codes.push_back(term->text());
+    }
+    while (terms->next());
+    terms->close();
+    return codes;
+}
 
-    auto hits = searcher->search(fullQuery, LUCENE_QUERY_MAX_DOCS);
+
+// Looks up documents with exactly the same source text, in the same languages
+// (including variants the full-text search would find, e.g. 'cs_CZ' for 'cs'),
+// using the "exact" field. This is much faster than full-text search.
+bool PerformExactSearch(IndexSearcherPtr searcher,
+                        const SearchArguments& sa,
+                        SuggestionsList& results)
+{
+    auto query = newLucene<BooleanQuery>();
+    for (auto& lang: get_searched_languages(searcher, sa))
+    {
+        auto key = get_exact_match_key(sa.srclangValue, lang, sa.exactSourceText);
+        query->add(newLucene<TermQuery>(newLucene<Term>(L"exact", key)), BooleanClause::SHOULD);
+    }
+
+    auto hits = searcher->search(query, LUCENE_QUERY_MAX_DOCS);
+    for (int i = 0; i < hits->scoreDocs.size(); i++)
+    {
+        auto doc = searcher->doc(hits->scoreDocs[i]->doc);
+        if (get_text_field(doc, L"source") != sa.exactSourceText)
+            continue; // hash collision
+
+        auto t = get_text_field(doc, L"trans");
+        time_t ts = DateField::stringToTime(doc->get(L"created"));
+        Suggestion r {t, 1.0, int(ts)};
+        r.id = StringUtils::toUTF8(doc->get(L"uuid"));
+        AddOrUpdateResult(results, std::move(r));
+    }
+
+    postprocess_results(results);
+    return !results.empty();
+}
+
+
+// Compact summary of a search hit, with just enough information to rank it.
+// Full documents are only loaded for the hits that make it into results.
+struct ScoredHit
+{
+    int32_t doc;
+    double score;
+    time_t created;
+};
+
+
+FieldSelectorPtr make_field_selector(std::initializer_list<const wchar_t*> fields,
+                                     std::initializer_list<const wchar_t*> lazyFields = {})
+{
+    auto load = HashSet<String>::newInstance();
+    for (auto f: fields)
+        load.add(f);
+    auto lazy = HashSet<String>::newInstance();
+    for (auto f: lazyFields)
+        lazy.add(f);
+    return newLucene<SetBasedFieldSelector>(load, lazy);
+}
+
+// Fields needed to score a hit. Source text isn't needed for documents
+// that can be discarded based on "ntokens" alone, so load it lazily.
+FieldSelectorPtr get_scoring_fields()
+{
+    static const FieldSelectorPtr s_selector =
+        make_field_selector({L"v", L"created", L"ntokens"}, {L"source"});
+    return s_selector;
+}
+
+// Fields needed to create a suggestion from a hit.
+FieldSelectorPtr get_result_fields()
+{
+    static const FieldSelectorPtr s_selector = make_field_selector({L"v", L"uuid", L"trans"});
+    return s_selector;
+}
+
+
+// Runs the query and rescores its hits by similarity of their source text
+// to the query, as computed by the matcher. Lucene is only used to find
+// candidates, its scores are ignored. Full documents are not loaded.
+std::vector<ScoredHit> ScoreHits(IndexSearcherPtr searcher,
+                                 AnalyzerPtr analyzer,
+                                 const SearchArguments& sa,
+                                 const FuzzyMatcher& matcher,
+                                 double scoreThreshold)
+{
+    auto hits = searcher->search(sa.full_query(), LUCENE_QUERY_MAX_DOCS);
+
+    std::vector<ScoredHit> scored;
+    scored.reserve(hits->scoreDocs.size());
 
     for (int i = 0; i < hits->scoreDocs.size(); i++)
     {
         const auto& scoreDoc = hits->scoreDocs[i];
-        auto score = scoreDoc->score / hits->maxScore;
-        if (score < scoreThreshold)
+        auto doc = searcher->doc(scoreDoc->doc, get_scoring_fields());
+
+        // Discard too short or too long texts without looking at them:
+        auto ntokens = doc->get(L"ntokens");
+        if (!ntokens.empty() &&
+            FuzzyMatcher::MaxSimilarity(StringUtils::toInt(ntokens), matcher.GetQueryLength()) < scoreThreshold)
+        {
             continue;
+        }
 
-        auto doc = searcher->doc(scoreDoc->doc);
+        double score;
         auto src = get_text_field(doc, L"source");
         if (src == sa.exactSourceText)
-        {
             score = 1.0;
-        }
         else
-        {
-            if (score == 1.0)
-            {
-                score = 0.95; // can't score non-exact thing as 100%:
+            score = std::min(matcher.Similarity(tokenize(analyzer, src)), MAX_FUZZY_SCORE);
+
+        if (score < scoreThreshold)
+            continue;
+
+        scored.push_back({scoreDoc->doc, score, DateField::stringToTime(doc->get(L"created"))});
+    }
+
+    return scored;
+}
 
-                // Check against too small queries having perfect hit in a large stored text.
-                // Do this by penalizing too large difference in lengths of the source strings.
-                double len1 = sa.exactSourceText.size();
-                double len2 = src.size();
-                score *= 1.0 - 0.4 * (std::abs(len1 - len2) / std::max(len1, len2));
-            }
 
-            score *= scoreScaling;
-        }
+// Adds the best of scored hits to results. Hits are processed from the best
+// one and only as many documents are loaded as needed to find MAX_RESULTS
+// distinct suggestions; the rest couldn't make it into results anyway.
+void CollectResults(IndexSearcherPtr searcher,
+                    std::vector<ScoredHit>& hits,
+                    SuggestionsList& results)
+{
+    // same order as Suggestion's operator<
+    std::stable_sort(hits.begin(), hits.end(), [](const ScoredHit& a, const ScoredHit& b)
+    {
+        if (std::fabs(a.score - b.score) <= std::numeric_limits<double>::epsilon())
+            return int(a.created) > int(b.created);
+        else
+            return a.score > b.score;
+    });
+
+    for (auto& hit: hits)
+    {
+        if (results.size() >= MAX_RESULTS)
+            break;
 
-        callback(doc, score);
+        auto doc = searcher->doc(hit.doc, get_result_fields());
+        Suggestion r {get_text_field(doc, L"trans"), hit.score, int(hit.created)};
+        r.id = StringUtils::toUTF8(doc->get(L"uuid"));
+        AddOrUpdateResult(results, std::move(r));
     }
+
+    postprocess_results(results);
 }
 
-void PerformSearch(IndexSearcherPtr searcher,
-                   const SearchArguments& sa,
-                   SuggestionsList& results,
-                   double scoreThreshold,
-                   double scoreScaling)
+
+template<typename T>
+void PerformSearchWithBlock(IndexSearcherPtr searcher,
+                            const SearchArguments& sa,
+                            T callback)
 {
-    PerformSearchWithBlock
-    (
-        searcher, sa, scoreThreshold, scoreScaling,
-        [&results](DocumentPtr doc, double score)
-        {
-            auto t = get_text_field(doc, L"trans");
-            time_t ts = DateField::stringToTime(doc->get(L"created"));
-            Suggestion r {t, score, int(ts)};
-            r.id = StringUtils::toUTF8(doc->get(L"uuid"));
-            AddOrUpdateResult(results, std::move(r));
-        }
-    );
+    auto hits = searcher->search(sa.full_query(), LUCENE_QUERY_MAX_DOCS);
 
-    postprocess_results(results);
+    for (int i = 0; i < hits->scoreDocs.size(); i++)
+        callback(searcher->doc(hits->scoreDocs[i]->doc));
 }
 
 } // anonymous namespace
@@ -447,78 +1259,105 @@ SuggestionsList TranslationMemoryImpl::Search(const Language& srclang,
 {
     try
     {
-        SuggestionsList results;
-
-        const Lucene::String sourceField(L"source");
-        auto boolQ = newLucene<BooleanQuery>();
-        auto phraseQ = newLucene<PhraseQuery>();
-
-        auto stream = m_analyzer->tokenStream(sourceField, newLucene<StringReader>(source));
-        int sourceTokensCount = 0;
-        int sourceTokenPosition = -1;
-        while (stream->incrementToken())
-        {
-            sourceTokensCount++;
-            auto word = stream->getAttribute<TermAttribute>()->term();
-            sourceTokenPosition += stream->getAttribute<PositionIncrementAttribute>()->getPositionIncrement();
-            auto term = newLucene<Term>(sourceField, word);
-            boolQ->add(newLucene<TermQuery>(term), BooleanClause::SHOULD);
-            phraseQ->add(term, sourceTokenPosition);
-        }
+        auto shard = m_index->Find(srclang, lang);
+        if (!shard)
+            return SuggestionsList();
 
         SearchArguments sa;
         sa.set_lang(srclang, lang);
-        sa.exactSourceText = source;
-        sa.query = phraseQ;
 
-        auto searcher = m_mng->Searcher();
+        auto searcher = shard->mng->Searcher();
+        return DoSearch(searcher.ptr(), sa, source);
+    }
+    catch (LuceneException&)
+    {
+        return SuggestionsList();
+    }
+}
 
-        // Try exact phrase first:
-        PerformSearch(searcher.ptr(), sa, results, QUALITY_THRESHOLD, /*scoreScaling=*/1.0);
-        if (!results.empty())
-            return results;
 
-        // Then, if no matches were found, permit being a bit sloppy:
-        phraseQ->setSlop(1);
-        sa.query = phraseQ;
-        PerformSearch(searcher.ptr(), sa, results, QUALITY_THRESHOLD, /*scoreScaling=*/0.9);
+std::vector<SuggestionsList> TranslationMemoryImpl::SearchBatch(const Language& srclang,
+                                                                const Language& lang,
+                                                                const std::vector<std::wstring>& sources)
+{
+    std::vector<SuggestionsList> results(sources.size());
 
-        if (!results.empty())
+    try
+    {
+        auto shard = m_index->Find(srclang, lang);
+        if (!shard)
             return results;
 
-        // As the last resort, try terms search. This will almost certainly
-        // produce low-quality results, but hopefully better than nothing.
-        boolQ->setMinimumNumberShouldMatch(std::max(1, boolQ->getClauses().size() - MAX_ALLOWED_LENGTH_DIFFERENCE));
-        sa.query = boolQ;
-        PerformSearchWithBlock
-        (
-            searcher.ptr(), sa, QUALITY_THRESHOLD, /*scoreScaling=*/0.8,
-            [=,&results](DocumentPtr doc, double score)
+        SearchArguments sa;
+        sa.set_lang(srclang, lang);
+
+        auto searcher = shard->mng->Searcher();
+
+        // index of the first occurrence of every source text:
+        std::unordered_map<std::wstring_view, size_t> firstOccurrence;
+        firstOccurrence.reserve(sources.size());
+
+        for (size_t i = 0; i < sources.size(); i++)
+        {
+            auto inserted = firstOccurrence.emplace(sources[i], i);
+            if (!inserted.second)
             {
-                auto s = get_text_field(doc, sourceField);
-                auto t = get_text_field(doc, L"trans");
-                auto stream2 = m_analyzer->tokenStream(sourceField, newLucene<StringReader>(s));
-                int tokensCount2 = 0;
-                while (stream2->incrementToken())
-                    tokensCount2++;
-
-                if (std::abs(tokensCount2 - sourceTokensCount) <= MAX_ALLOWED_LENGTH_DIFFERENCE)
-                {
-                    time_t ts = DateField::stringToTime(doc->get(L"created"));
-                    Suggestion r {t, score, int(ts)};
-                    r.id = StringUtils::toUTF8(doc->get(L"uuid"));
-                    AddOrUpdateResult(results, std::move(r));
-                }
+                results[i] = results[inserted.first->second];
+                continue;
             }
-        );
 
-        postprocess_results(results);
-        return results;
+            try
+            {
+                results[i] = DoSearch(searcher.ptr(), sa, sources[i]);
+            }
+            catch (LuceneException&)
+            {
+                // no hits for this text, same as in Search()
+            }
+        }
     }
     catch (LuceneException&)
     {
-        return SuggestionsList();
+        // no hits at all, same as in Search()
     }
+
+    return results;
+}
+
+
+SuggestionsList TranslationMemoryImpl::DoSearch(IndexSearcherPtr searcher,
+                                                SearchArguments sa,
+                                                const std::wstring& source)
+{
+    SuggestionsList results;
+
+    // Verbatim matches are the most common case, e.g. when pre-translating
+    // updated files, and can be found without analyzing the text at all:
+    sa.exactSourceText = source;
+    if (PerformExactSearch(searcher, sa, results))
+        return results;
+
+    auto tokens = tokenize(m_analyzer, source);
+    if (tokens.empty())
+        return results;
+
+    // Find candidates that share enough words with the source text. A text
+    // with similarity of at least QUALITY_THRESHOLD has at least that many
+    // tokens (of the longer text) in common with the query, so use it as
+    // the minimum number of matching terms:
+    const Lucene::String sourceField(L"source");
+    auto boolQ = newLucene<BooleanQuery>();
+    for (auto& word: tokens)
+        boolQ->add(newLucene<TermQuery>(newLucene<Term>(sourceField, word)), BooleanClause::SHOULD);
+    boolQ->setMinimumNumberShouldMatch(std::max(1, int(QUALITY_THRESHOLD * tokens.size())));
+    sa.query = boolQ;
+
+    // ...and then rank them by actual similarity:
+    FuzzyMatcher matcher(tokens);
+    auto hits = ScoreHits(searcher, m_analyzer, sa, matcher, QUALITY_THRESHOLD);
+
+    CollectResults(searcher, hits, results);
+    return results;
 }
 
 
@@ -527,6 +1366,10 @@ void TranslationMemoryImpl::SearchSubstring(TranslationMemory::IOInterface& dest
 {
     try
     {
+        auto shard = m_index->Find(srclang, lang);
+        if (!shard)
+            return;
+
         const Lucene::String sourceField(L"source");
         auto phraseQ = newLucene<PhraseQuery>();
 
@@ -545,12 +1388,12 @@ void TranslationMemoryImpl::SearchSubstring(TranslationMemory::IOInterface& dest
         sa.exactSourceText = sourcePhrase;
         sa.query = phraseQ;
 
-        auto searcher = m_mng->Searcher();
+        auto searcher = shard->mng->Searcher();
 
         PerformSearchWithBlock
         (
-            searcher.ptr(), sa, /*qualityThreshold=*/0.0, /*scoreScaling=*/1.0,
-            [&](DocumentPtr doc, double /*score*/)
+            searcher.ptr(), sa,
+            [&](DocumentPtr doc)
             {
                 auto sourceText = get_text_field(doc, sourceField);
                 if (boost::algorithm::ifind_first(sourceText, sourcePhrase))
@@ -575,24 +1418,59 @@ void TranslationMemoryImpl::ExportData(TranslationMemory::IOInterface& destinati
 {
     try
     {
-        auto reader = m_mng->Reader();
-        int32_t numDocs = reader->maxDoc();
-        Progress progress(numDocs);
+        // only load fields that are exported, not any of the internal ones:
+        static const FieldSelectorPtr s_exportedFields =
+            make_field_selector({L"v", L"srclang", L"lang", L"source", L"trans", L"created"});
+
+        // documents from the legacy index must be exported too; rather than
+        // reading both and dealing with duplicates, finish moving them first
+        const std::atomic<bool> notCancelled(false);
+        MigrateLegacyIndex(notCancelled);
+
+        auto shards = m_index->Readers();
+        int32_t totalDocs = 0;
+        for (auto& shard: shards)
+            totalDocs += shard.reader->maxDoc();
 
-        for (int32_t i = 0; i < numDocs; i++)
+        Progress progress(totalDocs);
+
+        std::map<String, Language> languages;
+        auto get_lang = [&languages](const String& code)
         {
-            progress.increment();
-            if (reader->isDeleted(i))
-                continue;
-            auto doc = reader->document(i);
-            destination.Insert
-            (
-            	Language::TryParse(doc->get(L"srclang")),
-                Language::TryParse(doc->get(L"lang")),
-                get_text_field(doc, L"source"),
-                get_text_field(doc, L"trans"),
-                DateField::stringToTime(doc->get(L"created"))
-            );
+            auto i = languages.find(code);
+            if (i == languages.end())
+                i = languages.emplace(code, Language::TryParse(code)).first;
+            return i->second;
+        };
+
+        for (auto& shard: shards)
+        {
+            // Read the index one segment at a time, sequentially, instead of
+            // going through the composite reader that has to locate every
+            // document's segment:
+            auto segments = shard.reader->getSequentialSubReaders();
+            if (!segments)
+                segments = newCollection<IndexReaderPtr>(shard.reader);
+
+            for (auto segment: segments)
+            {
+                const int32_t numDocs = segment->maxDoc();
+                for (int32_t i = 0; i < numDocs; i++)
+                {
+                    progress.increment();
+                    if (segment->isDeleted(i))
+                        continue;
+                    auto doc = segment->document(i, s_exportedFields);
+                    destination.Insert
+                    (
+                        get_lang(doc->get(L"srclang")),
+                        get_lang(doc->get(L"lang")),
+                        get_text_field(doc, L"source"),
+                        get_text_field(doc, L"trans"),
+                        DateField::stringToTime(doc->get(L"created"))
+                    );
+                }
+            }
         }
     }
     CATCH_AND_RETHROW_EXCEPTION
@@ -601,8 +1479,25 @@ void TranslationMemoryImpl::ExportData(TranslationMemory::IOInterface& destinati
 
 void TranslationMemoryImpl::ImportData(std::function<void(TranslationMemory::IOInterface&)> source)
 {
+    // Total size of in-memory buffers of added documents used during bulk
+    // imports, shared by all open shards. Larger buffers mean less frequent
+    // flushing of small segments to disk and less merging of them later.
+    const double IMPORT_RAM_BUFFER_BUDGET_MB = 64.0;
+
     auto writer = TranslationMemory::Get().GetWriter();
-    source(*writer);
+
+    m_index->SetRAMBufferBudgetMB(IMPORT_RAM_BUFFER_BUDGET_MB);
+    try
+    {
+        source(*writer);
+    }
+    catch (...)
+    {
+        m_index->SetRAMBufferBudgetMB(0);
+        throw;
+    }
+    m_index->SetRAMBufferBudgetMB(0);
+
     writer->Commit();
 }
 
@@ -611,13 +1506,184 @@ void TranslationMemoryImpl::GetStats(long& numDocs, long& fileSize)
 {
     try
     {
-        auto reader = m_mng->Reader();
-        numDocs = reader->numDocs();
+        numDocs = CountLegacyDocuments();
+        for (auto& shard: m_index->Readers())
+            numDocs += shard.reader->numDocs();
         fileSize = wxDir::GetTotalSize(GetDatabaseDir()).GetValue();
     }
     CATCH_AND_RETHROW_EXCEPTION
 }
 
+
+TranslationMemory::CompactionResults TranslationMemoryImpl::Compact()
+{
+    // the background migration would only duplicate work done here; it is
+    // stopped for good, so all of it must be done here, including moving
+    // documents out of the legacy index
+    StopMigration();
+
+    TranslationMemory::CompactionResults results {};
+
+    long numDocs, sizeBefore, sizeAfter;
+    GetStats(numDocs, sizeBefore);
+
+    try
+    {
+        Progress progress(4);
+
+        std::atomic<bool> cancelled(false);
+        results.upgradedDocs = MigrateLegacyIndex(cancelled);
+        progress.increment();
+        results.upgradedDocs += UpgradeDocuments(cancelled);
+        progress.increment();
+
+        auto shards = m_index->Readers();
+
+        std::vector<int> removed;
+        for (auto& shard: shards)
+        {
+            removed.push_back(RemoveNearDuplicates(shard));
+            results.removedDocs += removed.back();
+        }
+        progress.increment();
+
+        Progress merging((int)shards.size());
+        for (size_t i = 0; i < shards.size(); i++)
+            MergeSegments(shards[i], removed[i] > 0);
+
+        // don't keep shards opened only for compaction open:
+        for (auto& shard: shards)
+        {
+            shard.holder.reset();
+            if (!shard.isOpen)
+                m_index->CloseIfUnused(shard.name);
+        }
+    }
+    CATCH_AND_RETHROW_EXCEPTION
+
+    GetStats(numDocs, sizeAfter);
+    results.reclaimedBytes = std::max(0L, sizeBefore - sizeAfter);
+
+    wxLogTrace("poedit.tm", "compacted TM: %d upgraded, %d removed, %ld bytes reclaimed",
+               results.upgradedDocs, results.removedDocs, results.reclaimedBytes);
+    return results;
+}
+
+
+int TranslationMemoryImpl::RemoveNearDuplicates(const ShardReader& shard)
+{
+    // Every document has a single "exact" term identifying its languages and
+    // source text, so enumerating these terms yields all groups of documents
+    // with the same source text, without loading everything into memory.
+    static const FieldSelectorPtr s_fields = make_field_selector({L"v", L"uuid", L"source", L"trans", L"created"});
+
+    struct Entry
+    {
+        std::string uuid;
+        std::wstring source, trans;
+        time_t created;
+    };
+    std::vector<Entry> group;
+    std::vector<const Entry*> kept;
+
+    int removed = 0;
+    ShardPtr writable; // only opened if there's something to remove
+
+    auto reader = shard.reader;
+    auto terms = reader->terms(newLucene<Term>(L"exact", L""));
+    do
+    {
+        auto term = terms->term();
+        if (!term || term->field() != L"exact")
+            break;
+        if (terms->docFreq() < 2)
+            continue;
+
+        group.clear();
+        auto docs = reader->termDocs(term);
+        while (docs->next())
+        {
+            auto doc = reader->document(docs->doc(), s_fields);
+            group.push_back({StringUtils::toUTF8(doc->get(L"uuid")),
+                             get_text_field(doc, L"source"),
+                             get_text_field(doc, L"trans"),
+                             DateField::stringToTime(doc->get(L"created"))});
+        }
+        docs->close();
+
+        // Keep the newest of similar translations, they are usually fixes
+        // of typos or small improvements of the older ones:
+        std::stable_sort(group.begin(), group.end(),
+                         [](const Entry& a, const Entry& b){ return a.created > b.created; });
+
+        kept.clear();
+        for (auto& e: group)
+        {
+            bool duplicate = std::any_of(kept.begin(), kept.end(), [&e](const Entry *k)
+            {
+                // compare source too, because of (unlikely) collisions of "exact" keys
+                return k->source == e.source && is_near_duplicate(k->trans, e.trans);
+            });
+
+            if (duplicate)
+            {
+                if (!writable)
+                    writable = m_index->Get(shard.name);
+                writable->writer->deleteDocuments(newLucene<Term>(L"uuid", StringUtils::toUnicode(e.uuid)));
+                removed++;
+            }
+            else
+            {
+                kept.push_back(&e);
+            }
+        }
+    }
+    while (terms->next());
+    terms->close();
+
+    if (removed)
+    {
+        writable->NotifyChanged();
+        m_writerAPI->Commit();
+    }
+
+    return removed;
+}
+
+
+void TranslationMemoryImpl::MergeSegments(const ShardReader& shard, bool changed)
+{
+    auto subReaders = shard.reader->getSequentialSubReaders();
+    const int segments = subReaders ? subReaders.size() : 1;
+
+    // nothing to merge or expunge, don't open the shard needlessly:
+    if (segments <= 1 && !changed && !shard.reader->hasDeletions())
+        return;
+
+    auto writable = m_index->Get(shard.name);
+    if (!writable)
+        return;
+
+    // Lucene doesn't report progress of merging, so merge in several
+    // steps, halving the number of segments every time:
+    std::vector<int> steps;
+    for (int n = segments / 2; n > 1; n /= 2)
+        steps.push_back(n);
+    steps.push_back(1);
+
+    Progress progress((int)steps.size() + 1);
+    for (auto maxSegments: steps)
+    {
+        writable->writer->optimize(maxSegments);
+        progress.increment();
+    }
+
+    writable->writer->expungeDeletes();
+    writable->NotifyChanged();
+    m_writerAPI->Commit();
+    progress.increment();
+}
+
 // ----------------------------------------------------------------
 // TranslationMemoryWriterImpl
 // ----------------------------------------------------------------
@@ -625,7 +1691,9 @@ void TranslationMemoryImpl::GetStats(long& numDocs, long& fileSize)
 class TranslationMemoryWriterImpl : public TranslationMemory::Writer
 {
 public:
-    TranslationMemoryWriterImpl(IndexWriterPtr writer) : m_writer(writer) {}
+    TranslationMemoryWriterImpl(std::shared_ptr<ShardedIndex> index,
+                                std::shared_ptr<BackgroundCommitter> committer)
+        : m_index(index), m_committer(committer), m_uncommitted(0) {}
 
     ~TranslationMemoryWriterImpl() {}
 
@@ -633,16 +1701,36 @@ public:
     {
         try
         {
-            m_writer->commit();
+            m_uncommitted = 0;
+            for (auto& shard: m_index->Opened())
+            {
+                // only modified shards, commits are expensive even if empty
+                if (!shard->TakeChanged())
+                    continue;
+                shard->writer->commit();
+                shard->mng->NotifyCommitted();
+            }
         }
         CATCH_AND_RETHROW_EXCEPTION
     }
 
+    void ScheduleCommit() override
+    {
+        m_committer->Request();
+    }
+
     void Rollback() override
     {
         try
         {
-            m_writer->rollback();
+            m_uncommitted = 0;
+            for (auto& shard: m_index->Opened())
+            {
+                if (!shard->TakeChanged())
+                    continue;
+                shard->writer->rollback();
+                shard->mng->NotifyCommitted();
+            }
         }
         CATCH_AND_RETHROW_EXCEPTION
     }
@@ -689,8 +1777,17 @@ public:
                                       Field::STORE_YES, Field::INDEX_ANALYZED));
             doc->add(newLucene<Field>(L"trans", trans,
                                       Field::STORE_YES, Field::INDEX_NOT_ANALYZED));
+            doc->add(newLucene<Field>(L"exact", get_exact_match_key(srclang, lang.WCode(), source),
+                                      Field::STORE_NO, Field::INDEX_NOT_ANALYZED));
+            doc->add(newLucene<Field>(L"ntokens", StringUtils::toString(count_tokens(m_index->GetAnalyzer(), source)),
+                                      Field::STORE_YES, Field::INDEX_NO));
+            doc->add(newLucene<Field>(L"srclen", StringUtils::toString((int)source.length()),
+                                      Field::STORE_YES, Field::INDEX_NO));
 
-            m_writer->updateDocument(newLucene<Term>(L"uuid", itemUUID), doc);
+            auto shard = m_index->Get(srclang, lang);
+            shard->writer->updateDocument(newLucene<Term>(L"uuid", itemUUID), doc);
+            shard->NotifyChanged();
+            CountUncommittedChange();
         }
         CATCH_AND_RETHROW_EXCEPTION
     }
@@ -760,7 +1857,21 @@ public:
     {
         try
         {
-            m_writer->deleteDocuments(newLucene<Term>(L"uuid", StringUtils::toUnicode(uuid)));
+            // The UUID doesn't tell which shard the document is in, but
+            // deleting individual documents is rare enough to look in all,
+            // opening only the one that has it for writing:
+            auto term = newLucene<Term>(L"uuid", StringUtils::toUnicode(uuid));
+            for (auto& found: m_index->Readers())
+            {
+                if (found.reader->docFreq(term) == 0)
+                    continue;
+                if (auto shard = m_index->Get(found.name))
+                {
+                    shard->writer->deleteDocuments(term);
+                    shard->NotifyChanged();
+                }
+            }
+            CountUncommittedChange();
         }
         CATCH_AND_RETHROW_EXCEPTION
     }
@@ -769,13 +1880,31 @@ public:
     {
         try
         {
-            m_writer->deleteAll();
+            for (auto& shard: m_index->All())
+            {
+                shard->writer->deleteAll();
+                shard->NotifyChanged();
+            }
         }
         CATCH_AND_RETHROW_EXCEPTION
     }
 
 private:
-    IndexWriterPtr m_writer;
+    // Called after every change, commits if too many changes accumulated
+    void CountUncommittedChange()
+    {
+        if (++m_uncommitted >= MAX_UNCOMMITTED_CHANGES)
+            m_committer->RequestNow();
+    }
+
+    // Number of uncommitted changes that are committed without waiting for
+    // explicit commit request. Keeps memory use and potential loss of data
+    // in check, while not committing too often during bulk imports.
+    static const int MAX_UNCOMMITTED_CHANGES = 50000;
+
+    std::shared_ptr<ShardedIndex> m_index;
+    std::shared_ptr<BackgroundCommitter> m_committer;
+    std::atomic<int> m_uncommitted;
 };
 
 
@@ -783,21 +1912,184 @@ void TranslationMemoryImpl::Init()
 {
     try
     {
-        auto dir = newLucene<DirectoryType>(GetDatabaseDir());
         m_analyzer = newLucene<StandardAnalyzer>(LuceneVersion::LUCENE_CURRENT);
+        m_index = std::make_shared<ShardedIndex>(GetDatabaseDir(), m_analyzer);
 
-        m_writer = newLucene<IndexWriter>(dir, m_analyzer, IndexWriter::MaxFieldLengthLIMITED);
-        m_writer->setMergeScheduler(newLucene<SerialMergeScheduler>());
+        m_committer = std::make_shared<BackgroundCommitter>([this]{ m_writerAPI->Commit(); },
+                                                            std::chrono::seconds(Config::TMCommitDelay()));
+        m_writerAPI = std::make_shared<TranslationMemoryWriterImpl>(m_index, m_committer);
 
-        // get the associated realtime reader & searcher:
-        m_mng.reset(new SearcherManager(m_writer));
-
-        m_writerAPI = std::make_shared<TranslationMemoryWriterImpl>(m_writer);
+        // shards are opened lazily, so only migration needs to look at the disk now:
+        if (HasLegacyIndex() || Config::TMFormatVersion() < DOCUMENTS_FORMAT_VERSION)
+            m_migration = dispatch::async([this]{ MigrateDocuments(); });
     }
     CATCH_AND_RETHROW_EXCEPTION
 }
 
 
+void TranslationMemoryImpl::MigrateDocuments()
+{
+    try
+    {
+        MigrateLegacyIndex(m_migrationCancelled);
+        if (!m_migrationCancelled && Config::TMFormatVersion() < DOCUMENTS_FORMAT_VERSION)
+            UpgradeDocuments(m_migrationCancelled);
+    }
+    catch (...)
+    {
+        // not fatal, old documents are just slower to search (or not found,
+        // if not moved into shards yet); try again next time
+        wxLogTrace("poedit.tm", "migration of TM documents failed");
+    }
+}
+
+
+int TranslationMemoryImpl::MigrateLegacyIndex(const std::atomic<bool>& cancelled)
+{
+    // Older versions kept all languages in a single index directly in the
+    // database directory. Its documents are inserted into shards anew,
+    // which also upgrades them to the current format. If this is
+    // interrupted, it starts over next time, which is harmless, because
+    // inserting the same translation again just replaces it.
+    const int COMMIT_EVERY = 10000;
+
+    std::lock_guard<std::mutex> lock(m_legacyMigrationMutex);
+    if (!HasLegacyIndex())
+        return 0;
+
+    auto reader = IndexReader::open(newLucene<DirectoryType>(GetDatabaseDir()), true);
+    const int32_t numDocs = reader->maxDoc();
+    int migrated = 0;
+    m_legacyMigrated = 0;
+
+    for (int32_t i = 0; i < numDocs; i++)
+    {
+        if (cancelled)
+        {
+            reader->close();
+            return migrated;
+        }
+        if (reader->isDeleted(i))
+            continue;
+
+        auto doc = reader->document(i);
+        m_writerAPI->Insert
+        (
+            Language::TryParse(doc->get(L"srclang")),
+            Language::TryParse(doc->get(L"lang")),
+            get_text_field(doc, L"source"),
+            get_text_field(doc, L"trans"),
+            DateField::stringToTime(doc->get(L"created"))
+        );
+
+        m_legacyMigrated = ++migrated;
+        if (migrated % COMMIT_EVERY == 0)
+            m_writerAPI->Commit();
+    }
+
+    reader->close();
+    m_writerAPI->Commit();
+
+    DeleteLegacyIndex();
+
+    wxLogTrace("poedit.tm", "moved %d documents from legacy index into shards", migrated);
+    return migrated;
+}
+
+
+int TranslationMemoryImpl::CountLegacyDocuments()
+{
+    if (!HasLegacyIndex())
+        return 0;
+
+    try
+    {
+        // Documents already moved by migration in progress are in shards too.
+        // (If an earlier migration was interrupted, the documents it moved
+        // are counted twice until this one finishes, which is harmless.)
+        auto reader = IndexReader::open(newLucene<DirectoryType>(GetDatabaseDir()), true);
+        const int count = reader->numDocs();
+        reader->close();
+        return std::max(0, count - m_legacyMigrated.load());
+    }
+    catch (LuceneException&)
+    {
+        // the migration just finished and deleted the index
+        return 0;
+    }
+}
+
+
+int TranslationMemoryImpl::UpgradeDocuments(const std::atomic<bool>& cancelled)
+{
+    int migrated = 0;
+    for (auto& shard: m_index->Readers())
+    {
+        migrated += UpgradeDocuments(shard, cancelled);
+        if (cancelled)
+            return migrated;
+
+        // don't keep shards opened only for upgrading open:
+        shard.holder.reset();
+        if (!shard.isOpen)
+            m_index->CloseIfUnused(shard.name);
+    }
+
+    Config::TMFormatVersion(DOCUMENTS_FORMAT_VERSION);
+    wxLogTrace("poedit.tm", "migrated %d documents to format version %ld", migrated, DOCUMENTS_FORMAT_VERSION);
+    return migrated;
+}
+
+
+int TranslationMemoryImpl::UpgradeDocuments(const ShardReader& shard, const std::atomic<bool>& cancelled)
+{
+    // Commit in reasonably sized chunks, so that progress isn't lost if
+    // the app is closed before the migration finishes:
+    const int COMMIT_EVERY = 10000;
+
+    auto reader = shard.reader;
+    const int32_t numDocs = reader->maxDoc();
+    int migrated = 0;
+
+    for (int32_t i = 0; i < numDocs; i++)
+    {
+        if (cancelled)
+            return migrated;
+        if (reader->isDeleted(i))
+            continue;
+
+        auto doc = reader->document(i);
+        if (!doc->get(L"ntokens").empty())
+            continue; // already up to date
+
+        // Pre-1.8 documents have differently computed UUIDs, because
+        // their text was stored escaped:
+        if (doc->get(L"v").empty())
+        {
+            if (auto writable = m_index->Get(shard.name))
+                writable->writer->deleteDocuments(newLucene<Term>(L"uuid", doc->get(L"uuid")));
+        }
+
+        m_writerAPI->Insert
+        (
+            Language::TryParse(doc->get(L"srclang")),
+            Language::TryParse(doc->get(L"lang")),
+            get_text_field(doc, L"source"),
+            get_text_field(doc, L"trans"),
+            DateField::stringToTime(doc->get(L"created"))
+        );
+
+        if (++migrated % COMMIT_EVERY == 0)
+            m_writerAPI->Commit();
+    }
+
+    if (migrated)
+        m_writerAPI->Commit();
+
+    return migrated;
+}
+
+
 
 // ----------------------------------------------------------------
 // Singleton management
@@ -851,6 +2143,15 @@ SuggestionsList TranslationMemory::Search(const Language& srclang,
     return m_impl->Search(srclang, lang, source);
 }
 
+std::vector<SuggestionsList> TranslationMemory::SearchBatch(const Language& srclang,
+                                                            const Language& lang,
+                                                            const std::vector<std::wstring>& sources)
+{
+    if (!m_impl)
+        std::rethrow_exception(m_error);
+    return m_impl->SearchBatch(srclang, lang, sources);
+}
+
 dispatch::future<SuggestionsList> TranslationMemory::SuggestTranslation(const SuggestionQuery&& q)
 {
     try
@@ -870,6 +2171,11 @@ void TranslationMemory::Delete(const std::string& id)
     tm->Commit();
 }
 
+unsigned TranslationMemory::GetGeneration() const
+{
+    return SearcherManager::GetGeneration();
+}
+
 void TranslationMemory::ExportData(IOInterface& destination)
 {
     if (!m_impl)
@@ -893,11 +2199,18 @@ std::shared_ptr<TranslationMemory::Writer> TranslationMemory::GetWriter()
 
 void TranslationMemory::DeleteAllAndReset()
 {
+    // don't let migration write old documents back
+    if (m_impl)
+        m_impl->StopMigration();
+
     try
     {
         auto tm = TranslationMemory::Get().GetWriter();
         tm->DeleteAll();
         tm->Commit();
+
+        // ...and the legacy index that may not be fully migrated yet
+        TranslationMemoryImpl::DeleteLegacyIndex();
     }
     catch (...)
     {
@@ -909,6 +2222,7 @@ void TranslationMemory::DeleteAllAndReset()
         std::swap(m_impl, impl);
         delete impl;
         m_error = nullptr;
+        SearcherManager::IncrementGeneration();
     }
 }
 
@@ -919,6 +2233,13 @@ void TranslationMemory::GetStats(long& numDocs, long& fileSize)
     m_impl->GetStats(numDocs, fileSize);
 }
 
+TranslationMemory::CompactionResults TranslationMemory::Compact()
+{
+    if (!m_impl)
+        std::rethrow_exception(m_error);
+    return m_impl->Compact();
+}
+
 void TranslationMemory::SearchSubstring(IOInterface& destination,
                                         const Language& srclang, const Language& lang, const std::wstring& sourcePhrase)
 {
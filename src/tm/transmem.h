@@ -64,11 +64,32 @@ public:
                            const Language& lang,
                            const std::wstring& source);
 
+    /**
+        Search translation memory for similar strings for many source texts at once.
+
+        This is more efficient than calling Search() repeatedly: identical
+        source texts are only searched for once and the same snapshot of
+        the database is used for the whole batch.
+
+        @param srclang Language of the source texts.
+        @param lang    Language of the desired translations.
+        @param sources Source texts, may contain duplicates.
+
+        @return List of hits for every source text, in the same order as
+                @a sources.
+     */
+    std::vector<SuggestionsList> SearchBatch(const Language& srclang,
+                                             const Language& lang,
+                                             const std::vector<std::wstring>& sources);
+
     /// SuggestionsBackend API implementation:
     dispatch::future<SuggestionsList> SuggestTranslation(const SuggestionQuery&& q) override;
 
     void Delete(const std::string& id) override;
 
+    /// Incremented on every change done through the Writer (or reset)
+    unsigned GetGeneration() const override;
+
     /// Abstract interface to processing TM entries
     class IOInterface
     {
@@ -91,7 +112,8 @@ public:
 
     /**
         Imports data provided by the function into the database. The function
-        must use the interface passed to it to write data.
+        must use the interface passed to it to write data. The interface may
+        be used from multiple threads concurrently.
 
         May throw on error.
      */
@@ -167,6 +189,16 @@ public:
         /// Commits changes written so far.
         virtual void Commit() = 0;
 
+        /**
+            Requests commit of changes written so far to be done soon, in
+            the background.
+
+            Unlike Commit(), this is cheap and doesn't block. Requests made in
+            quick succession are grouped into a single commit. Commit is also
+            done automatically when too many changes accumulate.
+         */
+        virtual void ScheduleCommit() = 0;
+
         /// Rolls back changes written so far.
         virtual void Rollback() = 0;
     };
@@ -180,6 +212,30 @@ public:
     /// Returns statistics about the TM
     void GetStats(long& numDocs, long& fileSize);
 
+    /// Results of Compact()
+    struct CompactionResults
+    {
+        /// Number of near-duplicate translations removed
+        int removedDocs;
+        /// Number of documents written by old versions that were upgraded
+        int upgradedDocs;
+        /// Reduction in database size on disk, in bytes
+        long reclaimedBytes;
+    };
+
+    /**
+        Compacts the database. This is expensive, but makes the database
+        smaller and searches faster.
+
+        Older, near-duplicate translations of the same source text are
+        removed, keeping only the newest one. Documents in older format are
+        rewritten. Finally, segments of the index are merged and deleted
+        documents purged.
+
+        Reports progress and may throw on error.
+     */
+    CompactionResults Compact();
+
 private:
     TranslationMemory();
     ~TranslationMemory();
@@ -0,0 +1,115 @@
+/*
+ *  This file is part of Poedit (https://poedit.net)
+ *
+ *  Copyright (C) 2025 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+// Checks that MOWriter produces byte-for-byte the same output as msgfmt for
+// the reference catalogs in tests/mo.
+
+#include "mo_writer.h"
+#include "po_reader.h"
+
+#include <cstdio>
+#include <iostream>
+
+
+namespace
+{
+
+const char *REFERENCE_CATALOGS[] =
+{
+    "plurals.po",
+    "contexts.po",
+    "empty.po",
+    "non_ascii.po",
+    "latin2.po",
+};
+
+// Compiles the catalog the same way POCatalog::DoCompileMO() does
+std::string CompileWithMOWriter(const std::vector<tests::POEntry>& entries)
+{
+    MOWriter mo;
+    for (auto& e: entries)
+    {
+        // msgfmt doesn't include fuzzy and untranslated entries, except for the header:
+        if (!e.msgid.empty() && (e.IsFuzzy() || e.msgstr.empty() || e.msgstr[0].empty()))
+            continue;
+        mo.AddMessage(e.has_context, e.context, e.msgid, e.has_plural, e.msgid_plural, e.msgstr);
+    }
+    return mo.Serialize();
+}
+
+bool CompileWithMsgfmt(const std::string& po_file, std::string& output)
+{
+    const std::string mo_file = "mo_writer_test.mo";
+    std::remove(mo_file.c_str());
+    const std::string cmd = "msgfmt -o " + mo_file + " '" + po_file + "'";
+    if (std::system(cmd.c_str()) != 0)
+        return false;
+    const bool ok = tests::ReadFile(mo_file, output);
+    std::remove(mo_file.c_str());
+    return ok;
+}
+
+} // anonymous namespace
+
+
+int main()
+{
+    if (!tests::HasTool("msgfmt"))
+    {
+        std::cerr << "msgfmt not available, skipping\n";
+        return 77;
+    }
+
+    int failures = 0;
+    for (auto name: REFERENCE_CATALOGS)
+    {
+        const std::string po_file = tests::DataDir("mo") + name;
+
+        std::vector<tests::POEntry> entries;
+        std::string expected;
+        if (!tests::ReadPOFile(po_file, entries) || !CompileWithMsgfmt(po_file, expected))
+        {
+            std::cerr << "FAIL: " << name << ": couldn't read or compile the catalog\n";
+            failures++;
+            continue;
+        }
+
+        const std::string actual = CompileWithMOWriter(entries);
+        if (actual != expected)
+        {
+            size_t pos = 0;
+            while (pos < actual.size() && pos < expected.size() && actual[pos] == expected[pos])
+                pos++;
+            std::cerr << "FAIL: " << name << ": output differs from msgfmt's at offset " << pos
+                      << " (sizes " << actual.size() << " and " << expected.size() << ")\n";
+            failures++;
+            continue;
+        }
+
+        std::cout << "PASS: " << name << "\n";
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,234 @@
+/*
+ *  This file is part of Poedit (https://poedit.net)
+ *
+ *  Copyright (C) 2025 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef Poedit_tests_po_reader_h
+#define Poedit_tests_po_reader_h
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Helpers shared by tests that compare Poedit's output with gettext tools'.
+// The parser is deliberately minimal: it handles only the well-formed PO
+// files used as test data and keeps strings in the file's encoding.
+
+namespace tests
+{
+
+struct POEntry
+{
+    std::vector<std::string> comments;      // raw translator's comment lines, with '#'
+    std::vector<std::string> extracted;     // "#." comments
+    std::vector<std::string> references;
+    std::vector<std::string> flags;
+
+    bool has_context = false;
+    std::string context;
+    std::string msgid;
+    bool has_plural = false;
+    std::string msgid_plural;
+    std::vector<std::string> msgstr;
+
+    bool IsFuzzy() const
+    {
+        for (auto& f: flags)
+            if (f == "fuzzy")
+                return true;
+        return false;
+    }
+};
+
+
+inline std::string TrimSpaces(const std::string& s)
+{
+    auto b = s.find_first_not_of(" \t");
+    if (b == std::string::npos)
+        return std::string();
+    return s.substr(b, s.find_last_not_of(" \t") - b + 1);
+}
+
+
+// Parses quoted and escaped C string
+inline std::string UnquoteString(const std::string& quoted)
+{
+    std::string out;
+    const std::string s = TrimSpaces(quoted);
+    for (size_t i = 1; i + 1 < s.length(); i++)
+    {
+        if (s[i] != '\\')
+        {
+            out += s[i];
+            continue;
+        }
+        switch (s[++i])
+        {
+            case 'n':  out += '\n'; break;
+            case 't':  out += '\t'; break;
+            case 'r':  out += '\r'; break;
+            case 'a':  out += '\a'; break;
+            case 'b':  out += '\b'; break;
+            case 'f':  out += '\f'; break;
+            case 'v':  out += '\v'; break;
+            default:   out += s[i]; break;
+        }
+    }
+    return out;
+}
+
+
+inline bool ReadFile(const std::string& filename, std::string& content)
+{
+    std::ifstream f(filename, std::ios::binary);
+    if (!f)
+        return false;
+    std::stringstream ss;
+    ss << f.rdbuf();
+    content = ss.str();
+    return true;
+}
+
+
+/// Parses PO file into entries, skipping obsolete ones.
+inline bool ReadPOFile(const std::string& filename, std::vector<POEntry>& entries)
+{
+    std::string content;
+    if (!ReadFile(filename, content))
+        return false;
+
+    std::istringstream in(content);
+    std::string line;
+    POEntry entry;
+    std::string *current = nullptr;
+    bool inMsgstr = false;
+
+    auto flush = [&]
+    {
+        if (inMsgstr)
+            entries.push_back(entry);
+        entry = POEntry();
+        current = nullptr;
+        inMsgstr = false;
+    };
+
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty() || line.compare(0, 2, "#~") == 0)
+            continue;
+
+        if (line[0] == '"')
+        {
+            if (!current)
+                return false;
+            *current += UnquoteString(line);
+            continue;
+        }
+
+        const bool isComment = line[0] == '#';
+        if (inMsgstr && (isComment || line.compare(0, 5, "msgid") == 0 || line.compare(0, 7, "msgctxt") == 0))
+            flush();
+
+        if (line.compare(0, 2, "#,") == 0)
+        {
+            std::istringstream flags(line.substr(2));
+            std::string flag;
+            while (std::getline(flags, flag, ','))
+                entry.flags.push_back(TrimSpaces(flag));
+        }
+        else if (line.compare(0, 2, "#:") == 0)
+        {
+            std::istringstream refs(line.substr(2));
+            std::string ref;
+            while (refs >> ref)
+                entry.references.push_back(ref);
+        }
+        else if (line.compare(0, 2, "#.") == 0)
+        {
+            entry.extracted.push_back(TrimSpaces(line.substr(2)));
+        }
+        else if (isComment)
+        {
+            entry.comments.push_back(line);
+        }
+        else
+        {
+            const auto space = line.find(' ');
+            if (space == std::string::npos)
+                return false;
+            const std::string keyword = line.substr(0, space);
+            if (keyword == "msgctxt")
+            {
+                entry.has_context = true;
+                current = &entry.context;
+            }
+            else if (keyword == "msgid")
+            {
+                current = &entry.msgid;
+            }
+            else if (keyword == "msgid_plural")
+            {
+                entry.has_plural = true;
+                current = &entry.msgid_plural;
+            }
+            else if (keyword.compare(0, 6, "msgstr") == 0)
+            {
+                entry.msgstr.emplace_back();
+                current = &entry.msgstr.back();
+                inMsgstr = true;
+            }
+            else
+            {
+                return false;
+            }
+            *current = UnquoteString(line.substr(space + 1));
+        }
+    }
+
+    flush();
+    return true;
+}
+
+
+/// Returns true if given gettext tool is available.
+inline bool HasTool(const std::string& tool)
+{
+    return std::system((tool + " --version >/dev/null 2>&1").c_str()) == 0;
+}
+
+
+/// Returns path to the test data directory.
+inline std::string DataDir(const char *subdir)
+{
+    const char *srcdir = std::getenv("srcdir");
+    return std::string(srcdir ? srcdir : ".") + "/" + subdir + "/";
+}
+
+} // namespace tests
+
+#endif // Poedit_tests_po_reader_h
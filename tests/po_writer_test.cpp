@@ -0,0 +1,172 @@
+/*
+ *  This file is part of Poedit (https://poedit.net)
+ *
+ *  Copyright (C) 2025 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+// Checks that POWriter formats the golden files in tests/po exactly the same
+// as msgcat does, at several line widths.
+
+#include "po_writer.h"
+#include "po_reader.h"
+
+#include <wx/arrstr.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+
+namespace
+{
+
+const char *GOLDEN_FILES[] =
+{
+    "wrapping.po",
+    "formats.po",
+};
+
+// 0 means no wrapping
+const int WIDTHS[] = { 79, 40, 0 };
+
+inline wxString FromUTF8(const std::string& s)
+{
+    return wxString::FromUTF8(s.data(), s.length());
+}
+
+// Writes the entries the same way POCatalog::DoSaveOnly() does
+std::string FormatWithPOWriter(const std::vector<tests::POEntry>& entries, int width)
+{
+    POWriter f(wxTextFileType_Unix, width);
+
+    bool first = true;
+    for (auto& e: entries)
+    {
+        if (!first)
+            f.AddEmptyLine();
+        first = false;
+
+        wxString comment;
+        for (auto& line: e.comments)
+            comment << FromUTF8(line) << '\n';
+        f.AddComment(comment);
+        for (auto& line: e.extracted)
+            f.AddExtractedComment(FromUTF8(line));
+        wxArrayString references;
+        for (auto& ref: e.references)
+            references.push_back(FromUTF8(ref));
+        f.AddReferences(references);
+
+        std::vector<wxString> flags;
+        for (auto& flag: e.flags)
+            flags.push_back(FromUTF8(flag));
+        f.AddFlags(flags);
+
+        const bool wrap = std::find(flags.begin(), flags.end(), wxS("no-wrap")) == flags.end();
+        const auto format = POWriter::GetFormatSyntax(flags);
+
+        if (e.has_context)
+            f.AddString(wxS("msgctxt"), FromUTF8(e.context), wrap);
+        f.AddString(wxS("msgid"), FromUTF8(e.msgid), wrap, format);
+        if (e.has_plural)
+        {
+            f.AddString(wxS("msgid_plural"), FromUTF8(e.msgid_plural), wrap, format);
+            for (size_t i = 0; i < e.msgstr.size(); i++)
+                f.AddString(wxString::Format(wxS("msgstr[%u]"), unsigned(i)), FromUTF8(e.msgstr[i]), wrap, format);
+        }
+        else
+        {
+            f.AddString(wxS("msgstr"), FromUTF8(e.msgstr[0]), wrap, format);
+        }
+    }
+
+    const wxScopedCharBuffer utf8 = f.GetText().utf8_str();
+    return std::string(utf8.data(), utf8.length());
+}
+
+bool FormatWithMsgcat(const std::string& po_file, int width, std::string& output)
+{
+    const std::string out_file = "po_writer_test.po";
+    std::remove(out_file.c_str());
+    std::string cmd = "msgcat --force-po ";
+    cmd += width ? "--width=" + std::to_string(width) : std::string("--no-wrap");
+    cmd += " -o " + out_file + " '" + po_file + "'";
+    if (std::system(cmd.c_str()) != 0)
+        return false;
+    const bool ok = tests::ReadFile(out_file, output);
+    std::remove(out_file.c_str());
+    return ok;
+}
+
+} // anonymous namespace
+
+
+int main()
+{
+    if (!tests::HasTool("msgcat"))
+    {
+        std::cerr << "msgcat not available, skipping\n";
+        return 77;
+    }
+
+    int failures = 0;
+    for (auto name: GOLDEN_FILES)
+    {
+        const std::string po_file = tests::DataDir("po") + name;
+
+        std::vector<tests::POEntry> entries;
+        if (!tests::ReadPOFile(po_file, entries))
+        {
+            std::cerr << "FAIL: " << name << ": couldn't read the file\n";
+            failures++;
+            continue;
+        }
+
+        for (auto width: WIDTHS)
+        {
+            std::string expected;
+            if (!FormatWithMsgcat(po_file, width, expected))
+            {
+                std::cerr << "FAIL: " << name << ": msgcat failed\n";
+                failures++;
+                continue;
+            }
+
+            const std::string actual = FormatWithPOWriter(entries, width);
+            if (actual != expected)
+            {
+                // report the first differing line
+                size_t pos = 0;
+                while (pos < actual.size() && pos < expected.size() && actual[pos] == expected[pos])
+                    pos++;
+                const size_t line = std::count(expected.begin(), expected.begin() + pos, '\n') + 1;
+                std::cerr << "FAIL: " << name << " (width " << width << "): output differs from msgcat's on line " << line << "\n";
+                failures++;
+                continue;
+            }
+
+            std::cout << "PASS: " << name << " (width " << width << ")\n";
+        }
+    }
+
+    return failures ? 1 : 0;
+}
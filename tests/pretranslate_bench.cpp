@@ -0,0 +1,302 @@
+/*
+ *  This file is part of Poedit (https://poedit.net)
+ *
+ *  Copyright (C) 2025 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+// Compares peak memory use and time of the two ways of pre-translating a big
+// catalog: a future for every item, all created before any result is
+// consumed (as PreTranslateCatalogImpl used to do), and a bounded number of
+// workers passing batches of results through dispatch::bounded_pipeline.
+// The TM lookup is simulated, because TranslationMemory can't be linked here
+// without the rest of the app.
+//
+// Every variant runs in its own child process, so that its peak resident set
+// size can be measured in isolation.
+//
+// Usage: pretranslate_bench [number of items]
+
+#include "concurrency.h"
+
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+
+// the same as PreTranslateCatalogImpl uses
+const size_t BATCH_SIZE = 200;
+
+struct Item
+{
+    std::wstring source;
+    std::wstring translation;
+    bool fuzzy = false;
+};
+
+typedef std::shared_ptr<Item> ItemPtr;
+
+struct Suggestion
+{
+    std::wstring text;
+    double score;
+};
+
+enum class ResType { None, Fuzzy, Exact };
+
+std::vector<ItemPtr> GenerateCatalog(size_t count)
+{
+    std::vector<ItemPtr> items;
+    items.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        auto item = std::make_shared<Item>();
+        item->source = L"Source string number " + std::to_wstring(i) + L" with some more words in it";
+        items.push_back(item);
+    }
+    return items;
+}
+
+// Stands in for TranslationMemory::Search(): some work and a few allocated results
+std::vector<Suggestion> Lookup(const std::wstring& source)
+{
+    size_t hash = std::hash<std::wstring>()(source);
+    for (int round = 0; round < 20; round++)
+        for (auto c: source)
+            hash = hash * 31 + size_t(c);
+
+    std::vector<Suggestion> results;
+    switch (std::hash<size_t>()(hash) % 4)
+    {
+        case 0:
+            break;
+        case 1:
+            results.push_back({L"Exact translation of: " + source, 1.0});
+            break;
+        default:
+            results.push_back({L"Similar translation of: " + source, 0.9});
+            results.push_back({L"Another translation of: " + source, 0.8});
+            break;
+    }
+    return results;
+}
+
+ResType Apply(Item& item, const std::vector<Suggestion>& results)
+{
+    if (results.empty())
+        return ResType::None;
+    auto& res = results.front();
+    item.translation = res.text;
+    item.fuzzy = res.score < 1.0;
+    return item.fuzzy ? ResType::Fuzzy : ResType::Exact;
+}
+
+int PreTranslateWithFutures(const std::vector<ItemPtr>& items)
+{
+    const std::string srclang("en"), lang("cs");
+
+    std::vector<dispatch::future<ResType>> operations;
+    for (auto& item: items)
+    {
+        operations.push_back(dispatch::async([=]() -> ResType
+        {
+            if (srclang == lang)
+                return ResType::None;
+            return Apply(*item, Lookup(item->source));
+        }));
+    }
+
+    int matched = 0;
+    for (auto& op: operations)
+    {
+        if (op.get() != ResType::None)
+            matched++;
+    }
+    return matched;
+}
+
+int PreTranslateWithPipeline(const std::vector<ItemPtr>& items)
+{
+    const size_t batchesCount = (items.size() + BATCH_SIZE - 1) / BATCH_SIZE;
+    const size_t workersCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), batchesCount);
+
+    auto pipeline = std::make_shared<dispatch::bounded_pipeline<std::vector<ResType>>>(batchesCount, 2 * workersCount);
+    dispatch::cancellation_token cancellationToken;
+
+    std::vector<dispatch::future<void>> workers;
+    for (size_t w = 0; w < workersCount; w++)
+    {
+        workers.push_back(dispatch::async([=,&items]()
+        {
+            try
+            {
+                size_t batch;
+                while (pipeline->next_batch(batch))
+                {
+                    const size_t batchEnd = std::min(items.size(), (batch + 1) * BATCH_SIZE);
+                    std::vector<ResType> results;
+                    results.reserve(batchEnd - batch * BATCH_SIZE);
+                    for (size_t i = batch * BATCH_SIZE; i < batchEnd; i++)
+                        results.push_back(Apply(*items[i], Lookup(items[i]->source)));
+                    if (!pipeline->push(std::move(results)))
+                        return;
+                }
+            }
+            catch (...)
+            {
+                pipeline->fail(std::current_exception());
+            }
+        }));
+    }
+
+    int matched = 0;
+    std::vector<ResType> results;
+    for (size_t done = 0; done < batchesCount; done++)
+    {
+        if (!pipeline->pop(results, cancellationToken))
+            break;
+        for (auto rt: results)
+        {
+            if (rt != ResType::None)
+                matched++;
+        }
+    }
+    pipeline->stop();
+
+    for (auto& w: workers)
+        w.get();
+    return matched;
+}
+
+struct Result
+{
+    double seconds;
+    int matched;
+    long peakKB;
+};
+
+// Runs the variant in a child process and measures its peak memory use
+template<typename F>
+bool RunInChild(size_t count, F&& variant, Result& result)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+        return false;
+
+    const pid_t pid = fork();
+    if (pid < 0)
+        return false;
+
+    if (pid == 0)
+    {
+        close(fds[0]);
+        auto items = GenerateCatalog(count);
+        const auto start = std::chrono::steady_clock::now();
+        Result r;
+        r.matched = variant(items);
+        r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        r.peakKB = 0;
+        const bool ok = write(fds[1], &r, sizeof(r)) == sizeof(r);
+        // don't wait for the executor's threads
+        _exit(ok ? 0 : 1);
+    }
+
+    close(fds[1]);
+    const bool ok = read(fds[0], &result, sizeof(result)) == sizeof(result);
+    close(fds[0]);
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0 || !ok)
+        return false;
+    result.peakKB = usage.ru_maxrss; // in kilobytes on Linux
+    return true;
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char **argv)
+{
+    const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    std::cout << count << " items, " << std::thread::hardware_concurrency() << " hardware threads\n\n";
+
+    struct
+    {
+        const char *name;
+        int (*variant)(const std::vector<ItemPtr>&);
+    }
+    const VARIANTS[] =
+    {
+        { "catalog only",     [](const std::vector<ItemPtr>&) { return 0; } },
+        { "future per item",  PreTranslateWithFutures },
+        { "bounded pipeline", PreTranslateWithPipeline },
+    };
+
+    std::cout << std::left << std::setw(20) << "variant" << std::right
+              << std::setw(10) << "matched" << std::setw(10) << "time ms" << std::setw(14) << "peak RSS MB" << "\n";
+
+    int failures = 0, expectedMatches = -1;
+    for (auto& v: VARIANTS)
+    {
+        Result r;
+        if (!RunInChild(count, v.variant, r))
+        {
+            std::cerr << "FAIL: " << v.name << ": the child process failed\n";
+            failures++;
+            continue;
+        }
+
+        // the first variant only measures the catalog itself
+        if (&v != VARIANTS)
+        {
+            if (expectedMatches == -1)
+                expectedMatches = r.matched;
+            else if (r.matched != expectedMatches)
+            {
+                std::cerr << "FAIL: " << v.name << ": " << r.matched << " items matched instead of " << expectedMatches << "\n";
+                failures++;
+            }
+        }
+
+        std::cout << std::left << std::setw(20) << v.name << std::right
+                  << std::setw(10) << r.matched
+                  << std::setw(10) << std::fixed << std::setprecision(1) << r.seconds * 1000
+                  << std::setw(14) << r.peakKB / 1024.0 << "\n";
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,266 @@
+/*
+ *  This file is part of Poedit (https://poedit.net)
+ *
+ *  Copyright (C) 2025 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+// Measures how QAChecker::Check(items) scales when it checks a big catalog
+// in shards on the background executor instead of in a sequential loop.
+// Checks can't be linked here without the rest of the app, so the workload
+// mirrors them: placeholders are extracted with the same scanners
+// SyntaxHighlighter uses and compared as sets, followed by whitespace checks,
+// with a new checker instance for every shard like QAChecker::CreateFor().
+// Both runs must find exactly the same issues.
+//
+// Usage: qa_checks_bench [number of items]
+
+#include "concurrency.h"
+#include "syntax_scanners.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cwctype>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <regex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+
+// the same as QAChecker::Check(items) uses
+const size_t SHARD_SIZE = 256;
+
+struct Item
+{
+    std::wstring source;
+    std::wstring translation;
+    int issue = 0;
+};
+
+enum Issue
+{
+    NO_ISSUE = 0,
+    MISSING_PLACEHOLDER,
+    SUPERFLUOUS_PLACEHOLDER,
+    LEADING_SPACE,
+    TRAILING_NEWLINE,
+    TRAILING_SPACE
+};
+
+class Checker
+{
+public:
+    Checker() : m_positional(LR"(^%[0-9]\$(.*))", std::regex_constants::ECMAScript | std::regex_constants::optimize) {}
+
+    int Check(Item& item)
+    {
+        item.issue = CheckPlaceholders(item);
+        if (item.issue == NO_ISSUE)
+            item.issue = CheckWhitespace(item);
+        return item.issue != NO_ISSUE ? 1 : 0;
+    }
+
+private:
+    typedef std::set<std::wstring> PlaceholdersSet;
+
+    int CheckPlaceholders(const Item& item)
+    {
+        PlaceholdersSet phSource, phTrans;
+        ExtractPlaceholders(phSource, item.source);
+        ExtractPlaceholders(phTrans, item.translation);
+        for (auto& ph: phSource)
+        {
+            if (phTrans.find(ph) == phTrans.end())
+                return MISSING_PLACEHOLDER;
+        }
+        for (auto& ph: phTrans)
+        {
+            if (phSource.find(ph) == phSource.end())
+                return SUPERFLUOUS_PLACEHOLDER;
+        }
+        return NO_ISSUE;
+    }
+
+    void ExtractPlaceholders(PlaceholdersSet& ph, const std::wstring& text)
+    {
+        scanners::ForEachMatch(scanners::C_FORMAT, text, [&](size_t a, size_t b)
+        {
+            auto x = text.substr(a, b - a);
+            if (x == L"%%")
+                return true;
+            std::wsmatch m;
+            if (std::regex_match(x, m, m_positional))
+                x = std::wstring(L"%") + std::wstring(m[1]);
+            ph.insert(x);
+            return true;
+        });
+    }
+
+    int CheckWhitespace(const Item& item)
+    {
+        auto& s = item.source;
+        auto& t = item.translation;
+        if (s.empty() || t.empty())
+            return NO_ISSUE;
+        if (std::iswspace(s.front()) != std::iswspace(t.front()))
+            return LEADING_SPACE;
+        if ((s.back() == '\n') != (t.back() == '\n'))
+            return TRAILING_NEWLINE;
+        if (std::iswspace(s.back()) != std::iswspace(t.back()))
+            return TRAILING_SPACE;
+        return NO_ISSUE;
+    }
+
+    std::wregex m_positional;
+};
+
+
+const wchar_t *WORDS[] =
+{
+    L"Open", L"file", L"the", L"selected", L"items", L"could", L"not", L"be", L"saved", L"because",
+    L"translation", L"memory", L"Übersetzung", L"catalog", L"source", L"code", L"error", L"window",
+};
+
+const wchar_t *PLACEHOLDERS[] = { L"%s", L"%d", L"%1$s", L"%2$d", L"%5.2f", L"%lu", L"%%" };
+
+std::vector<Item> GenerateCatalog(size_t count)
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> word(0, sizeof(WORDS) / sizeof(WORDS[0]) - 1);
+    std::uniform_int_distribution<size_t> placeholder(0, sizeof(PLACEHOLDERS) / sizeof(PLACEHOLDERS[0]) - 1);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::geometric_distribution<size_t> length(0.1);
+
+    std::vector<Item> items(count);
+    for (auto& i: items)
+    {
+        std::wstring src, trans;
+        for (size_t n = length(rng) + 1; n > 0; n--)
+        {
+            if (percent(rng) < 15)
+            {
+                const wchar_t *ph = PLACEHOLDERS[placeholder(rng)];
+                src += ph;
+                // about every 50th placeholder is lost in translation:
+                if (percent(rng) >= 2)
+                    trans += ph;
+            }
+            else
+            {
+                src += WORDS[word(rng)];
+                trans += WORDS[word(rng)];
+            }
+            src += L' ';
+            trans += L' ';
+        }
+        if (percent(rng) < 3)
+            trans.pop_back();
+        i.source = std::move(src);
+        i.translation = std::move(trans);
+    }
+    return items;
+}
+
+int CheckSequentially(std::vector<Item>& items)
+{
+    Checker checker;
+    int issues = 0;
+    for (auto& i: items)
+        issues += checker.Check(i);
+    return issues;
+}
+
+int CheckInShards(std::vector<Item>& items)
+{
+    const size_t shards = (items.size() + SHARD_SIZE - 1) / SHARD_SIZE;
+    std::vector<int> issues(shards, 0);
+
+    dispatch::parallel_for(shards, [&](size_t shard)
+    {
+        Checker checker;
+        const size_t end = std::min(items.size(), (shard + 1) * SHARD_SIZE);
+        for (size_t i = shard * SHARD_SIZE; i < end; i++)
+            issues[shard] += checker.Check(items[i]);
+    }, /*chunkSize=*/1);
+
+    return std::accumulate(issues.begin(), issues.end(), 0);
+}
+
+template<typename F>
+double MeasureSeconds(F&& f)
+{
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char **argv)
+{
+    const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    std::cout << count << " items, " << std::thread::hardware_concurrency() << " hardware threads\n\n";
+
+    std::cout << std::left << std::setw(10) << "items" << std::right
+              << std::setw(10) << "issues" << std::setw(16) << "sequential ms" << std::setw(14) << "sharded ms"
+              << std::setw(10) << "speedup" << "\n";
+
+    int failures = 0;
+    for (size_t n = count / 100; n <= count; n *= 10)
+    {
+        if (n == 0)
+            continue;
+
+        auto sequential = GenerateCatalog(n);
+        auto sharded = sequential;
+
+        int expected = 0, actual = 0;
+        const double sequentialTime = MeasureSeconds([&]{ expected = CheckSequentially(sequential); });
+        const double shardedTime = MeasureSeconds([&]{ actual = CheckInShards(sharded); });
+
+        bool same = expected == actual;
+        for (size_t i = 0; same && i < n; i++)
+            same = sequential[i].issue == sharded[i].issue;
+        if (!same)
+        {
+            std::cerr << "FAIL: sharded check of " << n << " items found different issues than the sequential one\n";
+            failures++;
+        }
+
+        std::cout << std::left << std::setw(10) << n << std::right
+                  << std::setw(10) << expected
+                  << std::setw(16) << std::fixed << std::setprecision(1) << sequentialTime * 1000
+                  << std::setw(14) << shardedTime * 1000
+                  << std::setw(9) << sequentialTime / shardedTime << "x\n";
+    }
+
+    dispatch::cleanup();
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,214 @@
+/*
+ *  This file is part of Poedit (https://poedit.net)
+ *
+ *  Copyright (C) 2025 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+// Compares the hand-written scanners used by SyntaxHighlighter with the
+// std::wregex expressions they replaced: first checks that both find exactly
+// the same matches in a generated corpus of strings, then measures how long
+// each takes to find them.
+//
+// Usage: syntaxhighlighter_bench [number of strings]
+
+#include "syntax_scanners.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <regex>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace
+{
+
+typedef std::vector<std::pair<size_t, size_t>> Matches;
+
+const std::wregex::flag_type RE_FLAGS = std::regex_constants::ECMAScript | std::regex_constants::optimize;
+
+#define RE_C_FORMAT_BASE LR"(%(\d+\$)?[-+ #0]{0,5}(\d+|\*)?(\.(\d+|\*))?((hh|ll|[hljztL])?[%csdioxXufFeEaAgGnp]|<[A-Za-z0-9]+>))"
+#define RE_BRACES LR"(\{[\w.-:,]+\})"
+
+// The same expressions as RegexSyntaxHighlighter used
+struct
+{
+    const char *name;
+    const scanners::Syntax& syntax;
+    const wchar_t *regex;
+}
+const SYNTAXES[] =
+{
+    { "html",         scanners::HTML_MARKUP,         LR"((<\/?[a-zA-Z0-9:-]+(\s+[-:\w]+(=([-:\w+]|"[^"]*"|'[^']*'))?)*\s*\/?>)|(&[^ ;]+;))" },
+    { "placeholders", scanners::COMMON_PLACEHOLDERS, LR"(%[\w.-]+%|%?\{[\w.-]+\}|\{\{[\w.-]+\}\})" },
+    { "dollar",       scanners::DOLLAR_PLACEHOLDERS, LR"(\$[A-Za-z0-9_]+\$)" },
+    { "php",          scanners::PHP_FORMAT,          LR"(%(\d+\$)?[-+]{0,2}([ 0]|'.)?-?\d*(\..?\d+)?[%bcdeEfFgGosuxX])" },
+    { "c",            scanners::C_FORMAT,            RE_C_FORMAT_BASE },
+    { "objc",         scanners::OBJC_FORMAT,         L"%@|" RE_C_FORMAT_BASE },
+    { "c++",          scanners::CXX20_FORMAT,        LR"((\{\{)|(\}\})|(\{[^}]*\}))" },
+    { "python",       scanners::PYTHON_FORMAT,       LR"((%(\(\w+\))?[-+ #0]?(\d+|\*)?(\.(\d+|\*))?[hlL]?[diouxXeEfFgGcrs%]))" L"|" RE_BRACES },
+    { "ruby",         scanners::RUBY_FORMAT,         LR"(%(\d+\$)?[-+ #0]{0,5}(\d+|\*)?(\.(\d+|\*))?(hh|ll|[hljztL])?[%csdioxXufFeEaAgGnp])" },
+    { "qt",           scanners::QT_FORMAT,           LR"(%L?(\d\d?|n))" },
+    { "lua",          scanners::LUA_FORMAT,          LR"(%[- 0]*\d*(\.\d+)?[sqdiouXxAaEefGgc])" },
+    { "pascal",       scanners::PASCAL_FORMAT,       LR"(%(\*:|\d*:)?-?(\*|\d+)?(\.\*|\.\d+)?[dDuUxXeEfFgGnNmMsSpP])" },
+};
+
+// Fragments the generated strings are made of: plain words, valid and
+// broken directives of all the formats, markup and entities
+const wchar_t *FRAGMENTS[] =
+{
+    L"The", L"quick", L"brown", L"fox", L"jumps", L"over", L"lazy", L"dog", L"files", L"Übersetzung", L"文字列",
+    L" ", L" ", L" ", L"  ", L", ", L". ", L"\n", L"\t", L"100%", L"%", L"{", L"}", L"$", L"<", L">", L"&", L";",
+    L"%s", L"%d", L"%5.2f", L"%-10s", L"%1$s", L"%2$d", L"%+.*f", L"%lld", L"%hhx", L"%zu", L"%%", L"%<PRId64>",
+    L"%@", L"%L1", L"%1", L"%12", L"%n", L"%'.10d", L"%-+05.3e", L"%*:d", L"%3:s", L"%.*s", L"%q", L"% 0d",
+    L"%(name)s", L"%(count)5d", L"%(bad", L"{0}", L"{name}", L"{0:>10}", L"{{", L"}}", L"{{var}}", L"%{var}",
+    L"%var%", L"$NAME$", L"$1", L"{a.b-c}", L"{}", L"{:x}",
+    L"<b>", L"</b>", L"<br/>", L"<a href=\"https://poedit.net\">", L"</a>", L"<span class='x' id=y>",
+    L"<img src=x />", L"<not a tag", L"&amp;", L"&nbsp;", L"& ", L"&lt;", L"&#x1F600;",
+};
+
+std::vector<std::wstring> GenerateCorpus(size_t count)
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> fragment(0, sizeof(FRAGMENTS) / sizeof(FRAGMENTS[0]) - 1);
+    std::geometric_distribution<size_t> length(0.05);
+
+    std::vector<std::wstring> corpus;
+    corpus.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        std::wstring s;
+        for (size_t n = length(rng) + 1; n > 0; n--)
+            s += FRAGMENTS[fragment(rng)];
+        corpus.push_back(std::move(s));
+    }
+
+    // a few huge strings, such as those that made std::regex fail with error_stack:
+    for (int i = 0; i < 3; i++)
+    {
+        std::wstring s;
+        while (s.length() < 200000)
+            s += FRAGMENTS[fragment(rng)];
+        corpus.push_back(std::move(s));
+    }
+
+    return corpus;
+}
+
+bool MatchWithRegex(const std::wregex& re, const std::wstring& s, Matches& out)
+{
+    out.clear();
+    try
+    {
+        for (std::wsregex_iterator i(s.begin(), s.end(), re), end; i != end; ++i)
+        {
+            if (i->empty())
+                continue;
+            const size_t pos = size_t(i->position());
+            out.emplace_back(pos, pos + size_t(i->length()));
+        }
+        return true;
+    }
+    catch (std::regex_error&)
+    {
+        return false; // e.g. error_complexity or error_stack
+    }
+}
+
+void MatchWithScanner(const scanners::Syntax& syntax, const std::wstring& s, Matches& out)
+{
+    out.clear();
+    scanners::ForEachMatch(syntax, s, [&out](size_t start, size_t end)
+    {
+        out.emplace_back(start, end);
+        return true;
+    });
+}
+
+template<typename F>
+double MeasureSeconds(F&& f)
+{
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char **argv)
+{
+    const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    const auto corpus = GenerateCorpus(count);
+
+    size_t totalChars = 0;
+    for (auto& s: corpus)
+        totalChars += s.length();
+    std::cout << corpus.size() << " strings, " << totalChars << " characters\n\n";
+
+    std::cout << std::left << std::setw(14) << "syntax" << std::right
+              << std::setw(10) << "matches" << std::setw(12) << "regex ms" << std::setw(12) << "scanner ms"
+              << std::setw(10) << "speedup" << "\n";
+
+    int failures = 0;
+    Matches expected, actual;
+    for (auto& syn: SYNTAXES)
+    {
+        const std::wregex re(syn.regex, RE_FLAGS);
+
+        size_t matches = 0, regexFailures = 0;
+        for (auto& s: corpus)
+        {
+            if (!MatchWithRegex(re, s, expected))
+            {
+                regexFailures++;
+                continue;
+            }
+            MatchWithScanner(syn.syntax, s, actual);
+            if (actual != expected)
+            {
+                std::cerr << "FAIL: " << syn.name << ": scanner and regex differ for a string of length " << s.length() << "\n";
+                failures++;
+                break;
+            }
+            matches += expected.size();
+        }
+
+        const double regexTime = MeasureSeconds([&]{ for (auto& s: corpus) MatchWithRegex(re, s, expected); });
+        const double scannerTime = MeasureSeconds([&]{ for (auto& s: corpus) MatchWithScanner(syn.syntax, s, actual); });
+
+        std::cout << std::left << std::setw(14) << syn.name << std::right
+                  << std::setw(10) << matches
+                  << std::setw(12) << std::fixed << std::setprecision(1) << regexTime * 1000
+                  << std::setw(12) << scannerTime * 1000
+                  << std::setw(9) << std::setprecision(1) << regexTime / scannerTime << "x";
+        if (regexFailures)
+            std::cout << "  (regex failed on " << regexFailures << " strings)";
+        std::cout << "\n";
+    }
+
+    return failures ? 1 : 0;
+}
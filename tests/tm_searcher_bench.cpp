@@ -0,0 +1,256 @@
+/*
+ *  This file is part of Poedit (https://poedit.net)
+ *
+ *  Copyright (C) 2025 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+// Measures throughput of many threads searching the translation memory
+// concurrently while it is being modified, with the two ways SearcherManager
+// can provide searchers:
+//
+//  - "locked": the reader is checked with isCurrent() and possibly reopened
+//    under a mutex on every query, as SearcherManager used to do;
+//
+//  - "snapshot": an immutable snapshot is loaded atomically and only
+//    replaced after commits, as SearcherManager does now.
+//
+// Lucene can't be linked here, so the index is simulated: isCurrent() takes
+// the writer's lock like Lucene's near-real-time readers do and a search
+// scans the documents of the reader's snapshot. Both schemes must never
+// return an older snapshot than a thread already saw.
+//
+// Usage: tm_searcher_bench [queries per thread]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+
+// Simulated index of a fixed number of documents that the writer updates
+class Index
+{
+public:
+    struct Reader
+    {
+        unsigned version;
+        std::shared_ptr<const std::vector<std::wstring>> docs;
+    };
+    typedef std::shared_ptr<const Reader> ReaderPtr;
+
+    Index()
+    {
+        auto docs = std::make_shared<std::vector<std::wstring>>();
+        for (int i = 0; i < 200; i++)
+            docs->push_back(L"Translation memory entry " + std::to_wstring(i));
+        m_docs = docs;
+    }
+
+    ReaderPtr GetReader()
+    {
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        return std::make_shared<Reader>(Reader{m_version, m_docs});
+    }
+
+    bool IsCurrent(const Reader& r)
+    {
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        return r.version == m_version;
+    }
+
+    void UpdateDocument(size_t i, const std::wstring& doc)
+    {
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        auto docs = std::make_shared<std::vector<std::wstring>>(*m_docs);
+        (*docs)[i % docs->size()] = doc;
+        m_docs = docs;
+        m_version++;
+    }
+
+private:
+    std::mutex m_writerMutex;
+    unsigned m_version = 0;
+    std::shared_ptr<const std::vector<std::wstring>> m_docs;
+};
+
+
+// Searcher provided the way SearcherManager did before
+class LockedSearcherManager
+{
+public:
+    explicit LockedSearcherManager(Index& index) : m_index(index), m_reader(index.GetReader()) {}
+
+    Index::ReaderPtr Searcher()
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        if (!m_index.IsCurrent(*m_reader))
+            m_reader = m_index.GetReader();
+        return m_reader;
+    }
+
+    void NotifyCommitted() {}
+
+private:
+    Index& m_index;
+    Index::ReaderPtr m_reader;
+    std::mutex m_mutex;
+};
+
+
+// Searcher provided the way SearcherManager does now
+class SnapshotSearcherManager
+{
+public:
+    explicit SnapshotSearcherManager(Index& index) : m_index(index), m_current(index.GetReader()) {}
+
+    Index::ReaderPtr Searcher()
+    {
+        return std::atomic_load(&m_current);
+    }
+
+    // Called by the refresher thread after commit
+    void NotifyCommitted()
+    {
+        std::lock_guard<std::mutex> guard(m_refreshMutex);
+        auto snapshot = std::atomic_load(&m_current);
+        if (!m_index.IsCurrent(*snapshot))
+            std::atomic_store(&m_current, m_index.GetReader());
+    }
+
+private:
+    Index& m_index;
+    Index::ReaderPtr m_current;
+    std::mutex m_refreshMutex;
+};
+
+
+// Stands in for running a query with the searcher
+size_t Search(const Index::Reader& reader, const std::wstring& text)
+{
+    size_t hits = 0;
+    for (auto& doc: *reader.docs)
+    {
+        if (doc.find(text) != std::wstring::npos)
+            hits++;
+    }
+    return hits;
+}
+
+struct Result
+{
+    double queriesPerSecond;
+    bool consistent;
+};
+
+template<typename Manager>
+Result RunSearches(unsigned threadsCount, size_t queriesPerThread)
+{
+    Index index;
+    Manager manager(index);
+
+    std::atomic<bool> stop(false);
+    std::atomic<bool> consistent(true);
+
+    // the writer updates an entry and commits every millisecond; entries
+    // searched for by the threads are left alone
+    std::thread writer([&]
+    {
+        for (size_t i = 0; !stop.load(); i++)
+        {
+            index.UpdateDocument(100 + i % 100, L"Updated entry " + std::to_wstring(i));
+            manager.NotifyCommitted();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> searchers;
+    for (unsigned t = 0; t < threadsCount; t++)
+    {
+        searchers.emplace_back([&, t]
+        {
+            const std::wstring text = L"entry " + std::to_wstring(t);
+            unsigned lastVersion = 0;
+            size_t hits = 0;
+            for (size_t q = 0; q < queriesPerThread; q++)
+            {
+                auto reader = manager.Searcher();
+                if (reader->version < lastVersion)
+                    consistent = false;
+                lastVersion = reader->version;
+                hits += Search(*reader, text);
+            }
+            if (hits == 0)
+                consistent = false; // every thread's text is in the initial documents
+        });
+    }
+    for (auto& t: searchers)
+        t.join();
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stop = true;
+    writer.join();
+
+    return { threadsCount * queriesPerThread / seconds, consistent.load() };
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char **argv)
+{
+    const size_t queries = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    std::cout << queries << " queries per thread, " << std::thread::hardware_concurrency() << " hardware threads\n\n";
+
+    std::cout << std::right << std::setw(8) << "threads"
+              << std::setw(16) << "locked q/s" << std::setw(16) << "snapshot q/s" << std::setw(10) << "speedup" << "\n";
+
+    int failures = 0;
+    for (unsigned threads = 1; threads <= 16; threads *= 2)
+    {
+        const auto locked = RunSearches<LockedSearcherManager>(threads, queries);
+        const auto snapshot = RunSearches<SnapshotSearcherManager>(threads, queries);
+        if (!locked.consistent || !snapshot.consistent)
+        {
+            std::cerr << "FAIL: searches with " << threads << " threads saw an older snapshot or no results\n";
+            failures++;
+        }
+
+        std::cout << std::setw(8) << threads
+                  << std::setw(16) << std::fixed << std::setprecision(0) << locked.queriesPerSecond
+                  << std::setw(16) << snapshot.queriesPerSecond
+                  << std::setw(9) << std::setprecision(1) << snapshot.queriesPerSecond / locked.queriesPerSecond << "x\n";
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,275 @@
+/*
+ *  This file is part of Poedit (https://poedit.net)
+ *
+ *  Copyright (C) 2025 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+// Measures how much running xgettext on contiguous shards of a large
+// synthetic source tree concurrently, as GettextExtractorBase::Extract()
+// does, speeds up extraction compared to a single xgettext process. Shards
+// are split by size the same way and their outputs are merged like
+// POCatalog::Concatenate() merges them; the merged messages must be the same
+// as the single process' ones, in the same order.
+//
+// Usage: xgettext_bench [number of source files]
+
+#include "po_reader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+
+namespace
+{
+
+const char *TREE_DIR = "xgettext_bench.tmp";
+
+const char *COMMON_STRINGS[] =
+{
+    "Cancel", "OK", "Open", "Save", "Save As", "Close", "Error", "Warning", "Settings", "Help",
+    "Couldn't open file %s.", "Couldn't save file %s.", "%d files", "Unknown error", "Retry",
+};
+
+// Generates C sources of varying sizes that use both unique strings and
+// strings shared by many files, which have to be merged.
+std::vector<std::string> GenerateTree(size_t count)
+{
+    std::mt19937 rng(42);
+    std::geometric_distribution<int> stringsCount(0.03);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::uniform_int_distribution<size_t> common(0, sizeof(COMMON_STRINGS) / sizeof(COMMON_STRINGS[0]) - 1);
+
+    fs::remove_all(TREE_DIR);
+
+    std::vector<std::string> files;
+    for (size_t f = 0; f < count; f++)
+    {
+        const std::string dir = "module" + std::to_string(f / 100);
+        const std::string name = dir + "/file" + std::to_string(f) + ".c";
+        fs::create_directories(fs::path(TREE_DIR) / dir);
+
+        std::ofstream out(fs::path(TREE_DIR) / name);
+        out << "#include <libintl.h>\n#define _(s) gettext(s)\n\n";
+        out << "void function" << f << "(int n, const char *path)\n{\n";
+        for (int s = stringsCount(rng) + 1; s > 0; s--)
+        {
+            const int kind = percent(rng);
+            if (kind < 30)
+                out << "    show(_(\"" << COMMON_STRINGS[common(rng)] << "\"), path);\n";
+            else if (kind < 40)
+                out << "    show(ngettext(\"%d item in file " << f << "\", \"%d items in file " << f << "\", n), n);\n";
+            else if (kind < 50)
+                out << "    /* TRANSLATORS: message " << s << " of file " << f << " */\n"
+                    << "    show(_(\"Commented message " << s << " of file " << f << "\"), path);\n";
+            else
+                out << "    show(_(\"Message " << s << " of file " << f << " with some more words\"), path);\n";
+        }
+        out << "}\n";
+        files.push_back(name);
+    }
+    return files;
+}
+
+// The same splitting as in extractor_gettext.cpp, for given number of shards
+std::vector<std::vector<std::string>> SplitIntoShards(const std::vector<std::string>& files, size_t count)
+{
+    std::vector<uint64_t> sizes;
+    uint64_t total = 0;
+    for (auto& fn: files)
+    {
+        const uint64_t size = 1024 + fs::file_size(fs::path(TREE_DIR) / fn);
+        sizes.push_back(size);
+        total += size;
+    }
+
+    std::vector<std::vector<std::string>> shards(1);
+    uint64_t accumulated = 0;
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        if (!shards.back().empty() && shards.size() < count && accumulated >= total * shards.size() / count)
+            shards.emplace_back();
+        shards.back().push_back(files[i]);
+        accumulated += sizes[i];
+    }
+    return shards;
+}
+
+bool RunXgettext(const std::vector<std::string>& files, const std::string& name)
+{
+    const std::string list = std::string(TREE_DIR) + "/" + name + ".files";
+    const std::string pot = std::string(TREE_DIR) + "/" + name + ".pot";
+    {
+        std::ofstream out(list);
+        for (auto& f: files)
+            out << f << "\n";
+    }
+    const std::string cmd = "xgettext --force-po -o " + pot + " --directory=" + TREE_DIR + " --files-from=" + list +
+                            " --from-code=UTF-8 -k_ --add-comments=TRANSLATORS:";
+    return std::system(cmd.c_str()) == 0;
+}
+
+void AddUnique(std::vector<std::string>& to, const std::vector<std::string>& from)
+{
+    for (auto& x: from)
+    {
+        if (std::find(to.begin(), to.end(), x) == to.end())
+            to.push_back(x);
+    }
+}
+
+// Merges the shards' outputs in order like POCatalog::Concatenate() does
+bool ReadMerged(size_t shardsCount, std::vector<tests::POEntry>& merged)
+{
+    std::unordered_map<std::string, size_t> seen;
+    for (size_t i = 0; i < shardsCount; i++)
+    {
+        std::vector<tests::POEntry> entries;
+        if (!tests::ReadPOFile(std::string(TREE_DIR) + "/shard" + std::to_string(i) + ".pot", entries))
+            return false;
+        for (auto& e: entries)
+        {
+            const std::string key = e.has_context ? e.context + '\x04' + e.msgid : e.msgid;
+            auto inserted = seen.emplace(key, merged.size());
+            if (inserted.second)
+            {
+                merged.push_back(e);
+                continue;
+            }
+            auto& first = merged[inserted.first->second];
+            AddUnique(first.references, e.references);
+            AddUnique(first.extracted, e.extracted);
+            AddUnique(first.flags, e.flags);
+        }
+    }
+    return true;
+}
+
+bool SameMessages(const std::vector<tests::POEntry>& a, const std::vector<tests::POEntry>& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        // headers differ in creation dates
+        if (a[i].msgid.empty() && b[i].msgid.empty())
+            continue;
+        auto flagsA = a[i].flags, flagsB = b[i].flags;
+        std::sort(flagsA.begin(), flagsA.end());
+        std::sort(flagsB.begin(), flagsB.end());
+        if (a[i].has_context != b[i].has_context || a[i].context != b[i].context ||
+            a[i].msgid != b[i].msgid || a[i].msgid_plural != b[i].msgid_plural ||
+            a[i].references != b[i].references || a[i].extracted != b[i].extracted || flagsA != flagsB)
+        {
+            std::cerr << "first difference: \"" << a[i].msgid << "\" and \"" << b[i].msgid << "\"\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename F>
+double MeasureSeconds(F&& f)
+{
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // anonymous namespace
+
+
+int main(int argc, char **argv)
+{
+    if (!tests::HasTool("xgettext"))
+    {
+        std::cout << "xgettext not available, skipping\n";
+        return 0;
+    }
+
+    const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000;
+    const auto files = GenerateTree(count);
+
+    uint64_t totalSize = 0;
+    for (auto& f: files)
+        totalSize += fs::file_size(fs::path(TREE_DIR) / f);
+    std::cout << files.size() << " files, " << totalSize / 1024 << " KB, "
+              << std::thread::hardware_concurrency() << " hardware threads\n\n";
+
+    bool ok = true;
+    const double serialTime = MeasureSeconds([&]{ ok = RunXgettext(files, "serial"); });
+    std::vector<tests::POEntry> expected;
+    if (!ok || !tests::ReadPOFile(std::string(TREE_DIR) + "/serial.pot", expected))
+    {
+        std::cerr << "FAIL: xgettext failed\n";
+        return 1;
+    }
+
+    std::cout << std::right << std::setw(8) << "shards" << std::setw(10) << "messages"
+              << std::setw(10) << "time ms" << std::setw(10) << "speedup" << "\n";
+    std::cout << std::setw(8) << 1 << std::setw(10) << expected.size() - 1
+              << std::setw(10) << std::fixed << std::setprecision(1) << serialTime * 1000 << std::setw(9) << 1.0 << "x\n";
+
+    int failures = 0;
+    for (size_t shardsCount: { 2, 4, 8 })
+    {
+        const auto shards = SplitIntoShards(files, shardsCount);
+
+        std::vector<tests::POEntry> merged;
+        const double time = MeasureSeconds([&]
+        {
+            std::vector<std::thread> runners;
+            std::vector<char> succeeded(shards.size(), 0);
+            for (size_t i = 0; i < shards.size(); i++)
+            {
+                runners.emplace_back([&, i]{ succeeded[i] = RunXgettext(shards[i], "shard" + std::to_string(i)); });
+            }
+            for (auto& t: runners)
+                t.join();
+            ok = std::find(succeeded.begin(), succeeded.end(), 0) == succeeded.end() && ReadMerged(shards.size(), merged);
+        });
+
+        if (!ok || !SameMessages(expected, merged))
+        {
+            std::cerr << "FAIL: " << shardsCount << " shards: " << (ok ? "merged messages differ from serial run" : "xgettext failed") << "\n";
+            failures++;
+            continue;
+        }
+
+        std::cout << std::setw(8) << shards.size() << std::setw(10) << merged.size() - 1
+                  << std::setw(10) << time * 1000 << std::setw(9) << serialTime / time << "x\n";
+    }
+
+    fs::remove_all(TREE_DIR);
+    return failures ? 1 : 0;
+}